@@ -0,0 +1,405 @@
+/*  _______________________________________________________________________
+
+    Surfpack: A Software Library of Multidimensional Surface Fitting Methods
+    Copyright (c) 2006, Sandia National Laboratories.
+    This software is distributed under the GNU Lesser General Public License.
+    For more information, see the README file in the top Surfpack directory.
+    _______________________________________________________________________ */
+
+/* Micro-benchmarks for Surfpack: model build time, single-point and
+   batch evaluation, gradient and variance throughput, cross validation
+   and PRESS fitness, and SurfData file I/O, over a grid of sample sizes
+   N and dimensions d.  Results are written as JSON, one record per
+   measurement, for comparison between builds.
+
+   Usage: surfpack_bench [options]
+     --n N1,N2,...         sample sizes (default 50,100,200)
+     --d d1,d2,...         dimensions (default 2,4,8)
+     --models m1,m2,...    model types (default all the ModelFactory types)
+     --eval-points M       points per evaluation measurement (default 1000)
+     --min-time S          repeat each measurement for at least S
+                           seconds (default 0.2)
+     --seed K              random seed for the samples (default 1)
+     --output FILE         write the JSON to FILE instead of stdout
+     --quick               a small grid (N 50,100; d 2), e.g., for a
+                           smoke test
+*/
+
+#include "surfpack.h"
+#include "SurfData.h"
+#include "SurfpackModel.h"
+#include "ModelFactory.h"
+#include "ModelFitness.h"
+#include "SurfpackInterface.h"
+#include "AxesBounds.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+using std::cerr;
+using std::endl;
+using std::ostream;
+using std::ostringstream;
+using std::string;
+using std::vector;
+
+namespace {
+
+/// One measurement, as a JSON record
+struct BenchResult
+{
+  string benchmark;
+  string subject;
+  unsigned n;
+  unsigned d;
+  /// operations (evaluations, builds, files) per repetition
+  unsigned ops;
+  unsigned reps;
+  /// wall clock seconds per repetition
+  double seconds;
+};
+
+/// Run op until min_time has passed (at least once), returning the
+/// mean seconds per run and the number of runs in reps
+template<typename Op>
+double timeOp(Op op, double min_time, unsigned& reps)
+{
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  double elapsed = 0.0;
+  reps = 0;
+  do {
+    op();
+    ++reps;
+    elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  } while (elapsed < min_time);
+  return elapsed/reps;
+}
+
+/// Factory arguments for each benchmarked model type; Kriging's
+/// correlation lengths are fixed so its build time measures the
+/// factorization rather than the path of the optimizer
+ParamMap modelArgs(const string& type, unsigned d)
+{
+  ParamMap args;
+  args["type"] = type;
+  args["verbosity"] = surfpack::toString<short>(surfpack::SILENT_OUTPUT);
+  if (type == "polynomial") {
+    args["order"] = "2";
+  } else if (type == "kriging") {
+    args["optimization_method"] = "none";
+    args["correlation_lengths"] = surfpack::fromVec<double>(VecDbl(d, 1.0));
+  }
+  return args;
+}
+
+/// Sample n points uniformly in [-2,2]^d, with the Rosenbrock response
+SurfData* createData(unsigned n, unsigned d, unsigned seed)
+{
+  ostringstream bounds;
+  for (unsigned i = 0; i < d; i++) {
+    bounds << (i ? " | " : "") << "-2 2";
+  }
+  AxesBounds ab(bounds.str());
+  surfpack::shared_rng().seed(seed);
+  SurfData* sd = SurfpackInterface::CreateSample(&ab, n);
+  VecDbl responses(sd->size());
+  for (unsigned i = 0; i < sd->size(); i++) {
+    responses[i] = surfpack::testFunction("rosenbrock", (*sd)(i));
+  }
+  sd->addResponse(responses);
+  return sd;
+}
+
+vector<unsigned> parseUnsigneds(const string& list)
+{
+  vector<unsigned> values;
+  std::istringstream is(list);
+  string item;
+  while (std::getline(is, item, ',')) {
+    values.push_back(std::atoi(item.c_str()));
+  }
+  return values;
+}
+
+vector<string> parseStrings(const string& list)
+{
+  vector<string> values;
+  std::istringstream is(list);
+  string item;
+  while (std::getline(is, item, ',')) {
+    values.push_back(item);
+  }
+  return values;
+}
+
+/// Write s as a JSON string
+string jsonString(const string& s)
+{
+  ostringstream os;
+  os << '"';
+  for (string::const_iterator c = s.begin(); c != s.end(); ++c) {
+    if (*c == '"' || *c == '\\') os << '\\';
+    os << *c;
+  }
+  os << '"';
+  return os.str();
+}
+
+template<typename T>
+string jsonArray(const vector<T>& values)
+{
+  ostringstream os;
+  os << '[';
+  for (unsigned i = 0; i < values.size(); i++) {
+    os << (i ? "," : "") << values[i];
+  }
+  os << ']';
+  return os.str();
+}
+
+/// Time building, evaluating, and scoring one model type on sd
+void benchModel(const string& type, const SurfData& sd, const MtxDbl& xs,
+		double min_time, vector<BenchResult>& results)
+{
+  unsigned n = sd.size(), d = sd.xSize(), m = xs.getNRows();
+  ParamMap args = modelArgs(type, d);
+  SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+  SurfpackModel* model = factory->Build(sd);
+  BenchResult r = { "", type, n, d, 1, 0, 0.0 };
+
+  r.benchmark = "build";
+  r.ops = 1;
+  r.seconds = timeOp([&]() { delete factory->Build(sd); }, min_time, r.reps);
+  results.push_back(r);
+
+  vector<VecDbl> points(m, VecDbl(d));
+  for (unsigned i = 0; i < m; i++) {
+    for (unsigned j = 0; j < d; j++) {
+      points[i][j] = xs(i,j);
+    }
+  }
+  VecDbl ys(m);
+  r.ops = m;
+
+  r.benchmark = "eval_single";
+  r.seconds = timeOp([&]() {
+      for (unsigned i = 0; i < m; i++) ys[i] = (*model)(points[i]);
+    }, min_time, r.reps);
+  results.push_back(r);
+
+  r.benchmark = "eval_batch";
+  r.seconds = timeOp([&]() { (*model)(xs, &ys[0]); }, min_time, r.reps);
+  results.push_back(r);
+
+  // models without gradients or variance throw on the first call
+  try {
+    model->gradient(points[0]);
+    r.benchmark = "gradient";
+    r.seconds = timeOp([&]() {
+	for (unsigned i = 0; i < m; i++) model->gradient(points[i]);
+      }, min_time, r.reps);
+    results.push_back(r);
+  }
+  catch (...) { }
+  try {
+    model->variance(points[0]);
+    r.benchmark = "variance";
+    r.seconds = timeOp([&]() {
+	for (unsigned i = 0; i < m; i++) model->variance(points[i]);
+      }, min_time, r.reps);
+    results.push_back(r);
+  }
+  catch (...) { }
+
+  r.ops = 1;
+  const char* metrics[] = { "press", "cv" };
+  for (unsigned k = 0; k < 2; k++) {
+    ModelFitness* fitness = ModelFitness::Create(metrics[k], 10);
+    r.benchmark = string("fitness_") + metrics[k];
+    r.seconds = timeOp([&]() { (*fitness)(*model, sd); }, min_time, r.reps);
+    results.push_back(r);
+    delete fitness;
+  }
+
+  delete model;
+  delete factory;
+}
+
+/// A path for the scratch file name in the temporary directory named
+/// by TMPDIR, TMP, or TEMP (else the system's), tagged with the process
+/// id so concurrent runs don't collide
+string tempPath(const string& name)
+{
+  const char* vars[] = { "TMPDIR", "TMP", "TEMP" };
+  string dir;
+  for (unsigned i = 0; i < 3 && dir.empty(); i++) {
+    const char* value = std::getenv(vars[i]);
+    if (value) dir = value;
+  }
+#if !defined(_WIN32) && !defined(_WIN64)
+  if (dir.empty()) dir = "/tmp";
+  const char separator = '/';
+  long pid = getpid();
+#else
+  if (dir.empty()) dir = ".";
+  const char separator = '\\';
+  long pid = _getpid();
+#endif
+  if (dir[dir.size()-1] != '/' && dir[dir.size()-1] != separator) {
+    dir += separator;
+  }
+  ostringstream path;
+  path << dir << "surfpack_bench_" << pid << "_" << name;
+  return path.str();
+}
+
+/// Time writing and reading sd in each SurfData file format
+void benchIO(const SurfData& sd, double min_time,
+	     vector<BenchResult>& results)
+{
+  BenchResult r = { "", "", sd.size(), sd.xSize(), 1, 0, 0.0 };
+  const char* extensions[] = { "spd", "bspd", "cbspd" };
+  for (unsigned k = 0; k < 3; k++) {
+    string filename = tempPath(string("data.") + extensions[k]);
+    r.subject = extensions[k];
+    r.benchmark = "data_write";
+    r.seconds = timeOp([&]() { sd.write(filename); }, min_time, r.reps);
+    results.push_back(r);
+    r.benchmark = "data_read";
+    // text files carry no header, so are read given their shape, as
+    // the interpreter's load command does
+    if (k == 0) {
+      r.seconds = timeOp([&]() { SurfData loaded(filename, sd.xSize(),
+						 sd.fSize(), 0); },
+			 min_time, r.reps);
+    } else {
+      r.seconds = timeOp([&]() { SurfData loaded(filename); },
+			 min_time, r.reps);
+    }
+    results.push_back(r);
+    std::remove(filename.c_str());
+  }
+}
+
+void writeJSON(ostream& os, const vector<unsigned>& ns,
+	       const vector<unsigned>& ds, unsigned eval_points,
+	       unsigned seed, const vector<BenchResult>& results)
+{
+  os << "{\n"
+     << "  \"format\": \"surfpack_bench\",\n"
+     << "  \"version\": 1,\n"
+     << "  \"config\": {\"n\": " << jsonArray(ns)
+     << ", \"d\": " << jsonArray(ds)
+     << ", \"eval_points\": " << eval_points
+     << ", \"seed\": " << seed << "},\n"
+     << "  \"results\": [";
+  os.precision(6);
+  for (unsigned i = 0; i < results.size(); i++) {
+    const BenchResult& r = results[i];
+    os << (i ? ",\n" : "\n")
+       << "    {\"benchmark\": " << jsonString(r.benchmark)
+       << ", \"subject\": " << jsonString(r.subject)
+       << ", \"n\": " << r.n << ", \"d\": " << r.d
+       << ", \"ops\": " << r.ops << ", \"reps\": " << r.reps
+       << ", \"seconds\": " << r.seconds
+       << ", \"ops_per_second\": ";
+    // a run too quick for the clock has no finite rate; JSON has no inf
+    if (r.seconds > 0.0) os << r.ops/r.seconds;
+    else os << "null";
+    os << "}";
+  }
+  os << "\n  ]\n}\n";
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+  vector<unsigned> ns = parseUnsigneds("50,100,200");
+  vector<unsigned> ds = parseUnsigneds("2,4,8");
+  vector<string> models = parseStrings("polynomial,mls,rbf,kriging,ann,mars");
+  unsigned eval_points = 1000;
+  double min_time = 0.2;
+  unsigned seed = 1;
+  string output;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "--quick") {
+      ns = parseUnsigneds("50,100");
+      ds = parseUnsigneds("2");
+      continue;
+    }
+    if (i + 1 == argc) {
+      cerr << "surfpack_bench: unknown option or missing value: " << arg
+	   << endl;
+      return 1;
+    }
+    string value = argv[++i];
+    if (arg == "--n") ns = parseUnsigneds(value);
+    else if (arg == "--d") ds = parseUnsigneds(value);
+    else if (arg == "--models") models = parseStrings(value);
+    else if (arg == "--eval-points") eval_points = std::atoi(value.c_str());
+    else if (arg == "--min-time") min_time = std::atof(value.c_str());
+    else if (arg == "--seed") seed = std::atoi(value.c_str());
+    else if (arg == "--output") output = value;
+    else {
+      cerr << "surfpack_bench: unknown option: " << arg << endl;
+      return 1;
+    }
+  }
+
+  vector<BenchResult> results;
+  for (unsigned id = 0; id < ds.size(); id++) {
+    unsigned d = ds[id];
+    // the same evaluation points for every model and sample size
+    SurfData* eval_sd = createData(eval_points, d, seed + 1);
+    MtxDbl xs(eval_sd->size(), d);
+    for (unsigned i = 0; i < eval_sd->size(); i++) {
+      for (unsigned j = 0; j < d; j++) {
+	xs(i,j) = (*eval_sd)(i)[j];
+      }
+    }
+    delete eval_sd;
+    for (unsigned in = 0; in < ns.size(); in++) {
+      SurfData* sd = createData(ns[in], d, seed);
+      benchIO(*sd, min_time, results);
+      for (unsigned im = 0; im < models.size(); im++) {
+	cerr << "surfpack_bench: " << models[im] << " N = " << ns[in]
+	     << " d = " << d << endl;
+	try {
+	  benchModel(models[im], *sd, xs, min_time, results);
+	}
+	catch (const std::exception& e) {
+	  cerr << "surfpack_bench: " << models[im] << " failed: " << e.what()
+	       << endl;
+	}
+	catch (const string& s) {
+	  cerr << "surfpack_bench: " << models[im] << " failed: " << s << endl;
+	}
+      }
+      delete sd;
+    }
+  }
+
+  if (output.empty()) {
+    writeJSON(std::cout, ns, ds, eval_points, seed, results);
+  } else {
+    std::ofstream os(output.c_str());
+    if (!os) {
+      cerr << "surfpack_bench: could not open " << output << endl;
+      return 1;
+    }
+    writeJSON(os, ns, ds, eval_points, seed, results);
+  }
+  return 0;
+}
@@ -1,5 +1,6 @@
 /* Example of loading a Surfpack model from a surface file (.sps or
-   .bsps) and evaluating it at a number of points. */
+   .bsps) and evaluating it at a number of points, one at a time and
+   in a batch. */
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -10,32 +11,44 @@ int main()
 {
   const char* const model_name = "sp_gp_model.sps";
   const int num_vars = 2;
+  surfpack_model* model = NULL;
 
-  if (!surfpack_load_model(model_name)) {
+  if (!surfpack_model_load(model_name, &model)) {
 
     // evaluate the model at the point, with a perturbation
     double base_pt[2] = {0.97, 0.94};
     double eval_pt[num_vars];
 
-    // perform one million trials
+    // perform a few trials
     int num_trials = 5;
+    double batch_pts[num_trials*num_vars];
+    double batch_resp[num_trials];
     int i;
     for (i=0; i<num_trials; ++i) {
 
       int j;
       // add +/-1% random perturbation to all components
       for (j=0; j<num_vars; ++j) {
-	eval_pt[j] = base_pt[j] + 
+	eval_pt[j] = base_pt[j] +
 	  -0.01 + 0.02 * (double) rand() / (double) RAND_MAX;
+	batch_pts[i*num_vars + j] = eval_pt[j];
       }
 
       // evaluate the surfpack model
-      double resp = surfpack_eval_model(eval_pt, num_vars);
-      printf("Response is: %g\n", resp);
+      double resp;
+      if (!surfpack_model_eval(model, eval_pt, num_vars, &resp))
+	printf("Response is: %g\n", resp);
 
     }
 
-    surfpack_free_model();
+    // evaluate the same points in one call; they are stored one after
+    // another, so the point stride is num_vars and the variable stride 1
+    if (!surfpack_model_eval_batch(model, batch_pts, num_trials, num_vars,
+				   num_vars, 1, batch_resp))
+      for (i=0; i<num_trials; ++i)
+	printf("Batch response is: %g\n", batch_resp[i]);
+
+    surfpack_model_free(model);
     return 0;
 
   }
@@ -0,0 +1,140 @@
+/*  _______________________________________________________________________
+
+    Surfpack: A Software Library of Multidimensional Surface Fitting Methods
+    Copyright (c) 2006, Sandia National Laboratories.
+    This software is distributed under the GNU Lesser General Public License.
+    For more information, see the README file in the top Surfpack directory.
+    _______________________________________________________________________ */
+
+#include "surfpack.h"
+#include "SurfData.h"
+#include "KDTree.h"
+
+using std::vector;
+
+
+KDTree::KDTree()
+  : root(-1)
+{
+  /* empty ctor */
+}
+
+KDTree::KDTree(const VecVecDbl& points_in)
+  : points(points_in), root(-1)
+{
+  indexPoints();
+}
+
+KDTree::KDTree(const SurfData& sd)
+  : root(-1)
+{
+  points.reserve(sd.size());
+  for (unsigned i = 0; i < sd.size(); i++) points.push_back(sd(i));
+  indexPoints();
+}
+
+unsigned KDTree::size() const
+{
+  return points.size();
+}
+
+void KDTree::indexPoints()
+{
+  VecUns order(points.size());
+  for (unsigned i = 0; i < order.size(); i++) order[i] = i;
+  nodes.reserve(points.size());
+  root = build(order, 0, order.size());
+}
+
+/// Split at the median of the dimension with the widest spread
+int KDTree::build(VecUns& order, unsigned first, unsigned last)
+{
+  if (first >= last) return -1;
+  unsigned ndims = points[order[first]].size();
+  unsigned split_dim = 0;
+  double widest = -1.0;
+  for (unsigned dim = 0; dim < ndims; dim++) {
+    double lo = points[order[first]][dim];
+    double hi = lo;
+    for (unsigned i = first + 1; i < last; i++) {
+      lo = std::min(lo, points[order[i]][dim]);
+      hi = std::max(hi, points[order[i]][dim]);
+    }
+    if (hi - lo > widest) {
+      widest = hi - lo;
+      split_dim = dim;
+    }
+  }
+  unsigned mid = first + (last - first)/2;
+  const VecVecDbl& pts = points;
+  std::nth_element(order.begin() + first, order.begin() + mid,
+    order.begin() + last, [&pts, split_dim](unsigned a, unsigned b) {
+      if (pts[a][split_dim] != pts[b][split_dim])
+	return pts[a][split_dim] < pts[b][split_dim];
+      return a < b;
+    });
+  Node node;
+  node.point = order[mid];
+  node.splitDim = split_dim;
+  node.left = node.right = -1;
+  int index = nodes.size();
+  nodes.push_back(node);
+  int left = build(order, first, mid);
+  int right = build(order, mid + 1, last);
+  nodes[index].left = left;
+  nodes[index].right = right;
+  return index;
+}
+
+unsigned KDTree::nearest(const VecDbl& x) const
+{
+  assert(root >= 0);
+  unsigned best = nodes[root].point;
+  double best_dist = std::numeric_limits<double>::max();
+  search(root, x, best, best_dist);
+  return best;
+}
+
+void KDTree::search(int node, const VecDbl& x, unsigned& best,
+  double& best_dist) const
+{
+  const Node& here = nodes[node];
+  double distance = surfpack::euclideanDistance(points[here.point], x);
+  if (distance < best_dist || (distance == best_dist && here.point < best)) {
+    best_dist = distance;
+    best = here.point;
+  }
+  double diff = x[here.splitDim] - points[here.point][here.splitDim];
+  int near_child = (diff < 0.0) ? here.left : here.right;
+  int far_child = (diff < 0.0) ? here.right : here.left;
+  if (near_child >= 0) search(near_child, x, best, best_dist);
+  // points across the splitting plane are at least |diff| away; the
+  // slack keeps equally distant points (lower index wins) from being
+  // pruned by rounding in the distance computation
+  if (far_child >= 0 &&
+      std::fabs(diff) <= best_dist*(1.0 + 4.0*DBL_EPSILON))
+    search(far_child, x, best, best_dist);
+}
+
+void KDTree::withinRadius(const VecDbl& x, double radius, 
+  VecUns& indices) const
+{
+  indices.clear();
+  if (root >= 0) collect(root, x, radius, indices);
+  std::sort(indices.begin(), indices.end());
+}
+
+void KDTree::collect(int node, const VecDbl& x, double radius,
+  VecUns& indices) const
+{
+  const Node& here = nodes[node];
+  if (surfpack::euclideanDistance(points[here.point], x) <= radius)
+    indices.push_back(here.point);
+  double diff = x[here.splitDim] - points[here.point][here.splitDim];
+  // as in search(), the slack only errs toward visiting a subtree
+  double reach = radius*(1.0 + 4.0*DBL_EPSILON);
+  if (here.left >= 0 && diff <= reach)
+    collect(here.left, x, radius, indices);
+  if (here.right >= 0 && -diff <= reach)
+    collect(here.right, x, radius, indices);
+}
@@ -0,0 +1,72 @@
+/*  _______________________________________________________________________
+
+    Surfpack: A Software Library of Multidimensional Surface Fitting Methods
+    Copyright (c) 2006, Sandia National Laboratories.
+    This software is distributed under the GNU Lesser General Public License.
+    For more information, see the README file in the top Surfpack directory.
+    _______________________________________________________________________ */
+
+#ifndef KD_TREE_H
+#define KD_TREE_H
+
+#include "surfpack_system_headers.h"
+
+class SurfData;
+
+/// Static k-d tree over a set of points for Euclidean nearest neighbor
+/// queries.  Answers agree exactly with a linear scan using
+/// surfpack::euclideanDistance: among equally distant points the one
+/// with the lowest index is returned.  Queries don't modify the tree,
+/// so one tree may be shared by concurrent callers.
+class KDTree
+{
+public:
+  /// Empty tree, e.g., for a model awaiting its data from an archive
+  KDTree();
+
+  /// Index the points (the rows of the passed list)
+  KDTree(const VecVecDbl& points_in);
+
+  /// Index the points of sd
+  KDTree(const SurfData& sd);
+
+  /// Number of indexed points
+  unsigned size() const;
+
+  /// Index of the point closest to x
+  unsigned nearest(const VecDbl& x) const;
+
+  /// Indices (ascending) of the points no further than radius from x
+  void withinRadius(const VecDbl& x, double radius, VecUns& indices) const;
+
+private:
+
+  /// Interior nodes split on one dimension at the coordinate of their
+  /// own point; children are indices into nodes (or -1 for none)
+  struct Node {
+    unsigned point;
+    unsigned splitDim;
+    int left;
+    int right;
+  };
+
+  /// Build the tree over all of points
+  void indexPoints();
+
+  /// Build the subtree over order[first,last), returning its root
+  int build(VecUns& order, unsigned first, unsigned last);
+
+  /// Descend from node, updating best/best_dist with any closer point
+  void search(int node, const VecDbl& x, unsigned& best,
+    double& best_dist) const;
+
+  /// Append the points under node no further than radius from x
+  void collect(int node, const VecDbl& x, double radius,
+    VecUns& indices) const;
+
+  VecVecDbl points;
+  std::vector<Node> nodes;
+  int root;
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include "SurfpackModel.h"
 #include "ModelFitness.h"
 #include "ModelFactory.h"
+#include "SurfpackParallel.h"
 
 using std::cout;
 using std::endl;
@@ -76,7 +77,8 @@ double ModelFitness::operator()(const VecDbl& obs, const VecDbl& pred) const
   throw string("Not implemented for abstract ModelFitness class");
 }
 
-ModelFitness* ModelFitness::Create(const std::string& metric, unsigned n)
+ModelFitness* ModelFitness::Create(const std::string& metric, unsigned n,
+				   unsigned n_threads)
 {
   if (metric == "sum_squared") {
     return new StandardFitness(Residual(DT_SQUARED),VecSummary(MT_SUM));
@@ -99,9 +101,9 @@ ModelFitness* ModelFitness::Create(const std::string& metric, unsigned n)
   } else if (metric == "max_abs") {
     return new StandardFitness(Residual(DT_ABSOLUTE),VecSummary(MT_MAXIMUM));
   } else if (metric == "press") {
-    return new PRESSFitness();
+    return new PRESSFitness(n_threads);
   } else if (metric == "cv") {
-    return new CrossValidationFitness(n);
+    return new CrossValidationFitness(n, n_threads);
   } else if (metric == "rsquared") {
     return new R2Fitness();
   }
@@ -161,13 +163,16 @@ double StandardFitness::operator()(const SurfpackModel& sm,
 
 // BMA TODO: consider moving to root_mean_squared for default metric
 CrossValidationFitness::CrossValidationFitness()
-  : ModelFitness(), num_partitions(10), default_metric("mean_squared")
+  : ModelFitness(), num_partitions(10), num_threads(0),
+    default_metric("mean_squared")
 { /* empty ctor */ }
 
 
 // BMA TODO: consider moving to root_mean_squared for default metric
-CrossValidationFitness::CrossValidationFitness(unsigned n_in)
-  : ModelFitness(), num_partitions(n_in), default_metric("mean_squared")
+CrossValidationFitness::
+CrossValidationFitness(unsigned n_in, unsigned num_threads_in)
+  : ModelFitness(), num_partitions(n_in), num_threads(num_threads_in),
+    default_metric("mean_squared")
 { /* empty ctor */ }
 
 
@@ -258,35 +263,85 @@ leaveout_estimates(VecDbl& estimates, const SurfpackModel& sm,
   */
 
   //cout << "CV Fitness: " << n << endl;
-  SurfData my_data = sd; // Get non const copy
   ParamMap args = sm.parameters();
 
   // silence model output for cross-validation
   args["verbosity"] = surfpack::toString<short>(surfpack::SILENT_OUTPUT);
 
-  VecUns indices(my_data.size()); 
+  VecUns indices(sd.size()); 
   for (unsigned i = 0; i < indices.size(); i++) indices[i] = i;
   surfpack::rand_shuffle(indices.begin(),indices.end(),shared_rng().mtrand);
-  estimates.resize(my_data.size());
+
+  VecVecUns partitions(n_final);
   for (unsigned partition = 0; partition < n_final; partition++) {
-    //cout << "part: " << partition << endl;
-    SetUns excludedPoints;
-    unsigned low = surfpack::block_low(partition, n_final, my_data.size());
-    unsigned high = surfpack::block_high(partition, n_final, my_data.size());
+    unsigned low = surfpack::block_low(partition, n_final, indices.size());
+    unsigned high = surfpack::block_high(partition, n_final, indices.size());
     //cout << "low/high: " << low << " " << high << endl;
-    for (unsigned k = low; k <= high; k++) excludedPoints.insert(indices[k]);
-    my_data.setExcludedPoints(excludedPoints);
-    //cout << " excludes: " << excludedPoints.size() << endl;
-    SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
-    SurfpackModel* model = factory->Build(my_data);
-    my_data.setExcludedPoints(SetUns());
-    for (unsigned k = low; k <= high; k++) {
-      estimates[indices[k]] = (*model)(my_data(indices[k]));
-      //cout << "for k = " << k << ": " << estimates[indices[k]] << endl;
-    }
-    delete model;
+    for (unsigned k = low; k <= high; k++)
+      partitions[partition].push_back(indices[k]);
+  }
+
+  // Draw each fold's seed up front; its builds then see the same random
+  // stream whether the folds run serially or concurrently, in any order
+  VecUns fold_seeds(n_final);
+  for (unsigned partition = 0; partition < n_final; partition++)
+    fold_seeds[partition] = shared_rng().mtrand();
+
+  // some models give the leave-out estimates in closed form, saving the
+  // rebuilds entirely
+  if (sm.leaveoutEstimates(sd, partitions, estimates))
+    return;
+
+  estimates.resize(sd.size());
+
+  // Each worker claims folds in turn, writing the estimates for the
+  // points it left out; these are disjoint across folds.  Folds of a
+  // model whose builds can't overlap are built here one at a time, so
+  // that each build may use the threads itself.
+  unsigned n_threads = sm.concurrentBuilds() ?
+    surfpack::parallel_threads(num_threads, n_final) : 1;
+  std::vector<SurfData> my_data(n_threads, sd); // non const copy per worker
+  surfpack::parallel_for(n_final, n_threads,
+    [&](unsigned partition, unsigned worker) {
+      leaveout_fold(estimates, my_data[worker], args, partitions[partition],
+		    fold_seeds[partition]);
+    });
+}
+
+
+/** Build the model leaving out the points in partition and estimate
+    them.  my_data is scratch, a copy of the full data owned by the
+    calling thread. */
+void CrossValidationFitness::
+leaveout_fold(VecDbl& estimates, SurfData& my_data, const ParamMap& args,
+	      const VecUns& partition, unsigned fold_seed) const
+{
+  // draw all of this fold's random numbers from its own stream
+  surfpack::MyRandomNumberGenerator fold_rng;
+  fold_rng.mtrand.seed(fold_seed);
+  surfpack::ThreadRngScope rng_scope(fold_rng);
+
+  SetUns excludedPoints(partition.begin(), partition.end());
+  my_data.setExcludedPoints(excludedPoints);
+  //cout << " excludes: " << excludedPoints.size() << endl;
+  ParamMap fold_args = args;
+  SurfpackModelFactory* factory = ModelFactory::createModelFactory(fold_args);
+  SurfpackModel* model = NULL;
+  try {
+    model = factory->Build(my_data);
+  }
+  catch (...) {
     delete factory;
+    my_data.setExcludedPoints(SetUns());
+    throw;
+  }
+  my_data.setExcludedPoints(SetUns());
+  for (unsigned k = 0; k < partition.size(); k++) {
+    estimates[partition[k]] = (*model)(my_data(partition[k]));
+    //cout << "for k = " << k << ": " << estimates[partition[k]] << endl;
   }
+  delete model;
+  delete factory;
 }
 
 
@@ -308,7 +363,8 @@ calc_one_metric(const VecDbl& observed, const VecDbl& predicted,
 // implementation of PRESSFitness
 // ------------------------------
 
-PRESSFitness::PRESSFitness()
+PRESSFitness::PRESSFitness(unsigned num_threads_in)
+  : num_threads(num_threads_in)
 { /* empty ctor */ }
 
 
@@ -321,7 +377,7 @@ double PRESSFitness::operator()(const SurfpackModel& sm,
   // want to just reimplement instead of calling CV fitness; for now,
   // assume model construction dominates bookeeping arithmetic
   // overhead
-  ModelFitness* cvmf = ModelFitness::Create("cv", sd.size());
+  ModelFitness* cvmf = ModelFitness::Create("cv", sd.size(), num_threads);
   double fitness = (*cvmf)(sm, sd);
   delete cvmf;
   return fitness;
@@ -73,8 +73,10 @@ public:
   virtual double operator()(const VecDbl& obs, const VecDbl& pred) const;
 
   /// factory to return a derived ModelFitness type by name
-  /// n is used to configure CrossValidationFitness folds
-  static ModelFitness* Create(const std::string& metric, unsigned n = 0);
+  /// n is used to configure CrossValidationFitness folds, and n_threads
+  /// the threads cv and press build them on (0 for the default)
+  static ModelFitness* Create(const std::string& metric, unsigned n = 0,
+			      unsigned n_threads = 0);
 
   /// get residuals, transformed by the passed Residual modifier resid
   static VecDbl getResiduals(const Residual& resid, 
@@ -113,7 +115,16 @@ protected:
 /// k-fold cross validation fitness
 /** Partition data into num_partitions partitions.  For each, rebuild
     the model leaving out the partition, compute residuals against the
-    leave out data. */
+    leave out data.  Models with a closed form for the leave-out
+    estimates (SurfpackModel::leaveoutEstimates) skip the rebuilds;
+    otherwise the folds are built concurrently on up to
+    num_threads threads (or one at a time, each build threading its own
+    work, for a model whose builds can't overlap, see
+    SurfpackModel::concurrentBuilds), each fold drawing from its own
+    random number stream seeded from shared_rng(), so results for a
+    given seed do not depend on the number of threads.  (Before the folds were threaded, every
+    fold drew from shared_rng() in turn, so a given seed gives
+    different, equally valid, fold models than it did then.) */
 class CrossValidationFitness : public ModelFitness
 {
 public:
@@ -121,8 +132,9 @@ public:
   /// default constructor, setting up default folds = 10
   CrossValidationFitness();
 
-  /// constructor accepting number of cross-validation partitions
-  CrossValidationFitness(unsigned n_in);
+  /// constructor accepting number of cross-validation partitions and
+  /// threads on which to build them (0 = surfpack::default_num_threads())
+  CrossValidationFitness(unsigned n_in, unsigned num_threads_in = 0);
 
   /// compute the fitness for the passed model and active response in sd
   virtual double operator()(const SurfpackModel& sm, const SurfData& sd) const;
@@ -137,6 +149,11 @@ protected:
   void leaveout_estimates(VecDbl& estimates, const SurfpackModel& sm,
 			  const SurfData& sd) const;
 
+  /// rebuild leaving out one partition and estimate the left out points
+  void leaveout_fold(VecDbl& estimates, SurfData& my_data,
+		     const ParamMap& args, const VecUns& partition,
+		     unsigned fold_seed) const;
+
   /// calculate a single fitness metric for the cross validation data
   double calc_one_metric(const VecDbl& observed, const VecDbl& predicted,
 			 const std::string& metric_name) const;
@@ -144,6 +161,9 @@ protected:
   /// number of partitions (folds) for cross-validation
   unsigned num_partitions;
 
+  /// maximum number of threads building folds; 0 = the default
+  unsigned num_threads;
+
   /// default metric to use in operator(); historically mean_squared
   std::string default_metric;
   
@@ -154,8 +174,15 @@ protected:
 class PRESSFitness: public ModelFitness
 {
 public:
-  PRESSFitness();
+  /// leave one out fitness, building the models on up to num_threads_in
+  /// threads (0 = surfpack::default_num_threads())
+  PRESSFitness(unsigned num_threads_in = 0);
   virtual double operator()(const SurfpackModel& sm, const SurfData& sd) const;
+
+protected:
+
+  /// maximum number of threads building the leave one out models
+  unsigned num_threads;
 };
 
 
@@ -8,6 +8,19 @@
 
 #include "surfpack.h"
 #include "SurfData.h"
+#include "SurfpackParallel.h"
+
+#include <cstdint>
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using std::cerr;
 using std::cout;
@@ -33,6 +46,352 @@ BOOST_CLASS_EXPORT(SurfData)
 #endif
 
 
+// ____________________________________________________________________________
+// Columnar binary format 
+// ____________________________________________________________________________
+
+namespace {
+
+/// The columnar binary (.cbspd) file starts with this header, followed
+/// by the x labels and then the f labels, each terminated by a NUL.
+/// The x, f, gradient, and Hessian blocks follow in the layout of
+/// SurfData::xData() and friends, each starting at a multiple of
+/// columnar_alignment bytes from the start of the file (zero padded).
+/// All values are in the byte order of the writing machine, which
+/// byteOrder records.
+struct ColumnarHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byteOrder;
+  std::uint64_t points;
+  std::uint32_t xsize;
+  std::uint32_t fsize;
+  std::uint32_t gradsize;
+  std::uint32_t hesssize;
+  std::uint64_t labelBytes;
+};
+
+const char columnar_magic[8] = { 'S','U','R','F','C','O','L','\0' };
+const std::uint32_t columnar_version = 1;
+const std::uint32_t columnar_byte_order = 0x01020304;
+const std::uint64_t columnar_alignment = 64;
+
+/// Round offset up to the next block boundary
+std::uint64_t columnarAlign(std::uint64_t offset)
+{
+  return (offset + columnar_alignment - 1)/columnar_alignment*
+    columnar_alignment;
+}
+
+/// Byte offsets of the x, f, gradient, and Hessian blocks, and of the
+/// end of the file, for the data described by header
+void columnarLayout(const ColumnarHeader& header, std::uint64_t offsets[5])
+{
+  std::uint64_t n = header.points;
+  std::uint64_t xsize = header.xsize;
+  std::uint64_t block_sizes[4] = { 
+    n*xsize, n*header.fsize, n*header.gradsize*xsize,
+    n*header.hesssize*xsize*xsize 
+  };
+  std::uint64_t offset = sizeof(ColumnarHeader) + header.labelBytes;
+  for (unsigned b = 0; b < 4; b++) {
+    offsets[b] = columnarAlign(offset);
+    offset = offsets[b] + block_sizes[b]*sizeof(double);
+  }
+  offsets[4] = offset;
+}
+
+
+// ____________________________________________________________________________
+// Text format 
+// ____________________________________________________________________________
+
+/// Text is parsed in blocks of about this many bytes per thread
+const std::size_t text_block_bytes = 1 << 20;
+
+/// Points are formatted for output this many at a time
+const unsigned text_batch_points = 1 << 16;
+
+/// Skip spaces and tabs, and the carriage return of DOS line ends
+inline const char* skipBlanks(const char* p, const char* end)
+{
+  while (p != end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+  return p;
+}
+
+/// Parse the number at p (not a blank), advancing p past it, but not
+/// past end; return false if there is no number there
+bool parseDouble(const char*& p, const char* end, double& value)
+{
+  // the stream extraction this replaces accepts an explicit plus sign,
+  // but not one followed by a blank or a second sign
+  if (*p == '+') {
+    ++p;
+    if (p == end || *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' ||
+	*p == '+' || *p == '-') {
+      return false;
+    }
+  }
+#ifdef __cpp_lib_to_chars
+  std::from_chars_result result = std::from_chars(p, end, value);
+  if (result.ec == std::errc()) {
+    p = result.ptr;
+    return true;
+  } else if (result.ec != std::errc::result_out_of_range) {
+    return false;
+  }
+  // let strtod produce the subnormal or infinite value
+#endif
+  // the text ends with a NUL; p isn't a blank, so strtod doesn't skip
+  // ahead to the next line, but make sure it stopped by end
+  char* last;
+  value = std::strtod(p, &last);
+  if (last == p || last > end) return false;
+  p = last;
+  return true;
+}
+
+/// Parse the points on the lines of [begin,end), which starts at a
+/// line boundary, appending one record per point to values: x, f, the
+/// gradients, and the Hessians (row by row in the text; column-major
+/// in the record, as in the SurfData blocks).  Lines that are blank or
+/// start with '%' are skipped, as are the first skip_columns fields of
+/// the others.
+void parseTextPoints(const char* begin, const char* end, unsigned xsize,
+  unsigned fsize, unsigned gradsize, unsigned hesssize, 
+  unsigned skip_columns, VecDbl& values)
+{
+  const unsigned hess_start = xsize + fsize + gradsize*xsize;
+  const unsigned record_size = hess_start + hesssize*xsize*xsize;
+  const char* line = begin;
+  while (line != end) {
+    const char* eol = std::find(line, end, '\n');
+    const char* p = skipBlanks(line, eol);
+    if (p != eol && *line != '%') {
+      unsigned found = 0;
+      for (unsigned i = 0; i < skip_columns && p != eol; i++) {
+	while (p != eol && *p != ' ' && *p != '\t' && *p != '\r') ++p;
+	p = skipBlanks(p, eol);
+      }
+      values.resize(values.size() + record_size);
+      double* record = &values[values.size() - record_size];
+      for (; found < record_size; found++) {
+	p = skipBlanks(p, eol);
+	double value;
+	if (p == eol || !parseDouble(p, eol, value)) break;
+	unsigned dest = found;
+	if (found >= hess_start) {
+	  unsigned h = found - hess_start;
+	  unsigned k = h/(xsize*xsize);
+	  unsigned r = h/xsize % xsize;
+	  unsigned c = h % xsize;
+	  dest = hess_start + (k*xsize + c)*xsize + r;
+	}
+	record[dest] = value;
+      }
+      if (found < record_size) {
+	ostringstream errormsg;
+	errormsg << "Bad SurfPoint: " << string(line, eol)
+		 << "\nExpected on this line: " << xsize 
+		 << " domain value(s) and " << fsize << " response value(s)";
+	if (gradsize || hesssize) {
+	  errormsg << ", " << gradsize << " gradient(s) and " << hesssize
+		   << " Hessian(s)";
+	}
+	errormsg << ";\nFound: " << found << " value(s).";
+	throw surfpack::io_exception(errormsg.str());
+      }
+    }
+    line = (eol == end) ? end : eol + 1;
+  }
+}
+
+/// Append value as a stream in scientific format with precision
+/// surfpack::output_precision writes it, right-aligned in a field of
+/// surfpack::field_width
+void appendTextField(string& text, double value)
+{
+  char buffer[64];
+#ifdef __cpp_lib_to_chars
+  unsigned length = std::to_chars(buffer, buffer + sizeof(buffer), value,
+    std::chars_format::scientific, surfpack::output_precision).ptr - buffer;
+#else
+  unsigned length = std::snprintf(buffer, sizeof(buffer), "%.*e", 
+    static_cast<int>(surfpack::output_precision), value);
+#endif
+  if (length < surfpack::field_width) {
+    text.append(surfpack::field_width - length, ' ');
+  }
+  text.append(buffer, length);
+}
+
+} // namespace
+
+/// Read-only contents of a columnar binary file: mapped into memory
+/// where the platform supports it, otherwise read into a buffer
+struct SurfData::ColumnarFile
+{
+  /// Open filename and validate its header
+  ColumnarFile(const string& filename);
+
+  ~ColumnarFile();
+
+  ColumnarHeader header;
+  VecStr xLabels;
+  VecStr fLabels;
+  /// The blocks, as from SurfData::xData() and friends
+  const double* x;
+  const double* f;
+  const double* gradients;
+  const double* hessians;
+
+private:
+  /// Interpret the first length bytes of contents
+  void parse(const string& filename);
+
+  /// Release the file contents
+  void release();
+
+  const char* contents;
+  std::uint64_t length;
+  /// Storage for contents when the file is not mapped
+  VecDbl buffer;
+
+  ColumnarFile(const ColumnarFile&);
+  ColumnarFile& operator=(const ColumnarFile&);
+};
+
+SurfData::ColumnarFile::ColumnarFile(const string& filename)
+  : x(NULL), f(NULL), gradients(NULL), hessians(NULL), contents(NULL),
+    length(0)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw surfpack::file_open_failure(filename);
+  }
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    close(fd);
+    throw surfpack::file_open_failure(filename);
+  }
+  length = status.st_size;
+  if (length > 0) {
+    // pages are read in as the data are touched, and shared with any
+    // other process mapping the same file
+    void* address = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+      close(fd);
+      throw surfpack::io_exception("Could not map " + filename);
+    }
+    contents = static_cast<const char*>(address);
+  }
+  close(fd);
+#else
+  ifstream infile(filename.c_str(), ios::in|ios::binary);
+  if (!infile) {
+    throw surfpack::file_open_failure(filename);
+  }
+  infile.seekg(0, ios::end);
+  length = infile.tellg();
+  infile.seekg(0, ios::beg);
+  buffer.resize((length + sizeof(double) - 1)/sizeof(double));
+  if (length > 0) {
+    infile.read(reinterpret_cast<char*>(&buffer[0]), length);
+    contents = reinterpret_cast<const char*>(&buffer[0]);
+  }
+#endif
+  try {
+    parse(filename);
+  } catch (...) {
+    release();
+    throw;
+  }
+}
+
+SurfData::ColumnarFile::~ColumnarFile()
+{
+  release();
+}
+
+void SurfData::ColumnarFile::release()
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+  if (contents) {
+    munmap(const_cast<char*>(contents), length);
+  }
+#endif
+  contents = NULL;
+  buffer.clear();
+}
+
+void SurfData::ColumnarFile::parse(const string& filename)
+{
+  if (length < sizeof(ColumnarHeader)) {
+    throw surfpack::io_exception(filename + 
+      " is too short to be a columnar binary data file");
+  }
+  std::memcpy(&header, contents, sizeof(ColumnarHeader));
+  if (std::memcmp(header.magic, columnar_magic, sizeof(columnar_magic))) {
+    throw surfpack::io_exception(filename + 
+      " is not a columnar binary data file");
+  }
+  if (header.byteOrder != columnar_byte_order) {
+    throw surfpack::io_exception(filename + 
+      " was written on a machine with a different byte order");
+  }
+  if (header.version != columnar_version) {
+    ostringstream errormsg;
+    errormsg << filename << " has columnar format version "
+	     << header.version << "; only version " << columnar_version
+	     << " is supported";
+    throw surfpack::io_exception(errormsg.str());
+  }
+  if (header.points > std::numeric_limits<unsigned>::max() ||
+      header.xsize == 0 ||
+      (header.gradsize != 0 && header.gradsize != header.fsize) ||
+      (header.hesssize != 0 && header.hesssize != header.fsize)) {
+    throw surfpack::io_exception(filename + 
+      " has an invalid columnar header");
+  }
+  std::uint64_t offsets[5];
+  columnarLayout(header, offsets);
+  if (length < offsets[4]) {
+    ostringstream errormsg;
+    errormsg << filename << " is truncated: expected " << offsets[4] 
+	     << " bytes, found " << length;
+    throw surfpack::io_exception(errormsg.str());
+  }
+  // labels
+  const char* label = contents + sizeof(ColumnarHeader);
+  const char* labels_end = label + header.labelBytes;
+  VecStr labels;
+  while (label < labels_end && labels.size() < header.xsize + header.fsize) {
+    const char* end = std::find(label, labels_end, '\0');
+    if (end == labels_end) break;
+    labels.push_back(string(label, end));
+    label = end + 1;
+  }
+  if (labels.size() != header.xsize + header.fsize) {
+    throw surfpack::io_exception(filename + 
+      " has too few variable labels");
+  }
+  xLabels.assign(labels.begin(), labels.begin() + header.xsize);
+  fLabels.assign(labels.begin() + header.xsize, labels.end());
+  // empty blocks are NULL, as in SurfData::xData() and friends
+  bool has_points = header.points > 0;
+  const double* block[4];
+  for (unsigned b = 0; b < 4; b++) {
+    block[b] = reinterpret_cast<const double*>(contents + offsets[b]);
+  }
+  x = has_points ? block[0] : NULL;
+  f = (has_points && header.fsize) ? block[1] : NULL;
+  gradients = (has_points && header.gradsize) ? block[2] : NULL;
+  hessians = (has_points && header.hesssize) ? block[3] : NULL;
+}
+
+
 // ____________________________________________________________________________
 // Creation, Destruction, Initialization 
 // ____________________________________________________________________________
@@ -51,9 +410,7 @@ SurfData::SurfData(const vector<SurfPoint>& points_)
     this->gradsize = points_[0].fGradientsSize();
     this->hesssize = points_[0].fHessiansSize();
     defaultLabels();
-    for (unsigned i = 0; i < points_.size(); i++) {
-      this->addPoint(points_[i]);
-    }
+    addPoints(points_);
   }
   init();
   // Check to make sure data points all have the same number of dimensions
@@ -113,11 +470,8 @@ SurfData::SurfData(const SurfData& other):
   excludedPoints(other.excludedPoints), defaultIndex(other.defaultIndex),
   xLabels(other.xLabels), fLabels(other.fLabels)
 {
-  for (unsigned i = 0; i < other.points.size(); i++) {
-    this->addPoint(*other.points[i]);
-  }
+  copyPoints(other);
   mapping = other.mapping;
-  buildOrderedPoints();
 }
 
 /// First SurfPoint added will determine the dimensions of the data set 
@@ -150,8 +504,10 @@ SurfData SurfData::copyActive()
   // are most likely copied again.  If this is a bottleneck, it would not be
   // terribly difficult to eliminate at least two of the three copies.
   vector<SurfPoint> activePoints;
+  activePoints.reserve(mapping.size());
   for (unsigned i = 0; i < mapping.size(); i++) {
-    activePoints.push_back(*points[mapping[i]]);
+    std::unique_ptr<SurfPoint> sp(newPoint(mapping[i]));
+    activePoints.push_back(*sp);
   }
   SurfData newSD(activePoints);
   if (!activePoints.empty()) {
@@ -164,13 +520,19 @@ SurfData SurfData::copyActive()
 void SurfData::cleanup()
 {
   mapping.clear();
-  orderedPoints.clear();
+  pointIndex.clear();
   for (unsigned j = 0; j < points.size(); j++) {
     delete points[j];
     points[j] =0;
   }
   points.clear();
   excludedPoints.clear();
+  xBlock.clear();
+  fBlock.clear();
+  gradientBlock.clear();
+  hessianBlock.clear();
+  mapped.reset();
+  pointsBuilt = false;
 }
 
 // ____________________________________________________________________________
@@ -188,14 +550,11 @@ SurfData& SurfData::operator=(const SurfData& other)
     this->fsize = other.fsize;
     this->gradsize = other.gradsize;
     this->hesssize = other.hesssize;
-    for (unsigned i = 0; i < other.points.size(); i++) {
-      this->addPoint(*other.points[i]);
-    }
+    copyPoints(other);
     this->excludedPoints = other.excludedPoints;
     this->mapping = other.mapping;
     this->defaultIndex = other.defaultIndex;
   }
-  buildOrderedPoints();
   return (*this);
 }
 
@@ -207,9 +566,22 @@ bool SurfData::operator==(const SurfData& other) const
       this->gradsize == other.gradsize &&
       this->hesssize == other.hesssize &&
       this->size() == other.size()) { 
-    for (unsigned i = 0; i < points.size(); i++) {
-      if (*this->points[i] != *other.points[i]) {
-        return false;
+    if (this->physicalSize() != other.physicalSize()) {
+      return false;
+    }
+    // block by block, with the tolerance of SurfPoint::operator==
+    unsigned n = physicalSize();
+    const double* blocks[4] = 
+      { xData(), fData(), gradientData(), hessianData() };
+    const double* other_blocks[4] = { other.xData(), other.fData(), 
+      other.gradientData(), other.hessianData() };
+    const unsigned strides[4] = 
+      { xsize, fsize, gradsize*xsize, hesssize*xsize*xsize };
+    for (unsigned b = 0; b < 4; b++) {
+      for (std::size_t i = 0; i < std::size_t(n)*strides[b]; i++) {
+	if (!doubles_match(blocks[b][i], other_blocks[b][i])) {
+	  return false;
+	}
       }
     }
     return true;
@@ -229,6 +601,7 @@ const SurfPoint& SurfData::operator[](unsigned index) const
 {
   static string header("Indexing error in SurfData::operator[] const.");
   checkRangeNumPoints(header, index);
+  materialize();
   return *points[mapping[index]];
 }
 
@@ -237,7 +610,7 @@ double SurfData::operator()(unsigned pt, unsigned dim) const
 {
   assert(pt < size());
   assert(dim < xSize());
-  return points[mapping[pt]]->X()[dim];
+  return xData()[mapping[pt]*xsize + dim];
 }
 
 /// Return the vector of predictor vars for point index 
@@ -247,6 +620,7 @@ const vector<double>& SurfData::operator()(unsigned pt) const
     cout << "Assertion failure.  Pt: " << pt << " size: " << size() << endl;
   }
   assert(pt < size());
+  materialize();
   return points[mapping[pt]]->X();
 }
 
@@ -278,6 +652,16 @@ unsigned SurfData::fSize() const
   return fsize; 
 }
 
+unsigned SurfData::fGradientsSize() const 
+{ 
+  return gradsize; 
+}
+
+unsigned SurfData::fHessiansSize() const 
+{ 
+  return hesssize; 
+}
+
 /// Return the set of excluded points (the indices)
 const set<unsigned>& SurfData::getExcludedPoints() const 
 {
@@ -290,7 +674,7 @@ double SurfData::getResponse(unsigned index) const
 {
   static string header("Indexing error in SurfData::getResponse.");
   checkRangeNumPoints(header, index);
-  return points[mapping[index]]->F(defaultIndex);
+  return fData()[mapping[index]*fsize + defaultIndex];
 }
 
 // const std::vector<double>& SurfData::getGradient(unsigned index) const
@@ -311,8 +695,9 @@ double SurfData::getResponse(unsigned index) const
 std::vector< double > SurfData::getResponses() const
 {
   vector< double > result(mapping.size());
+  const double* f = fData();
   for (unsigned i = 0; i < mapping.size(); i++) {
-    result[i] = points[mapping[i]]->F(defaultIndex);
+    result[i] = f[mapping[i]*fsize + defaultIndex];
   }
   return result;
 }
@@ -322,8 +707,9 @@ std::vector< double > SurfData::getPredictor(unsigned index) const
 {
   assert(index < xSize());
   vector< double > result(mapping.size());
+  const double* x = xData();
   for (unsigned i = 0; i < mapping.size(); i++) {
-    result[i] = (*this)(i,index);
+    result[i] = x[mapping[i]*xsize + index];
   }
   return result;
 }
@@ -400,6 +786,40 @@ bool SurfData::varIndex(const string& name, unsigned& index,
   }
 }
 
+// ____________________________________________________________________________
+// Columnar views 
+// ____________________________________________________________________________
+
+unsigned SurfData::physicalIndex(unsigned index) const
+{
+  assert(index < mapping.size());
+  return mapping[index];
+}
+
+const double* SurfData::xData() const
+{
+  if (mapped) return mapped->x;
+  return xBlock.empty() ? NULL : &xBlock[0];
+}
+
+const double* SurfData::fData() const
+{
+  if (mapped) return mapped->f;
+  return fBlock.empty() ? NULL : &fBlock[0];
+}
+
+const double* SurfData::gradientData() const
+{
+  if (mapped) return mapped->gradients;
+  return gradientBlock.empty() ? NULL : &gradientBlock[0];
+}
+
+const double* SurfData::hessianData() const
+{
+  if (mapped) return mapped->hessians;
+  return hessianBlock.empty() ? NULL : &hessianBlock[0];
+}
+
 // ____________________________________________________________________________
 // Commands 
 // ____________________________________________________________________________
@@ -422,13 +842,18 @@ void SurfData::setResponse(unsigned index, double value)
 {
   static string header("Indexing error in SurfData::setResponse.");
   checkRangeNumPoints(header, index);
-  points[mapping[index]]->F(defaultIndex, value);
+  detach();
+  fBlock[mapping[index]*fsize + defaultIndex] = value;
+  if (pointsBuilt) {
+    points[mapping[index]]->F(defaultIndex, value);
+  }
 }
   
 /// Add a point to the data set. The parameter point will be copied.
 void SurfData::addPoint(const SurfPoint& sp) 
 {
-  if (points.empty()) {
+  detach();
+  if (physicalSize() == 0) {
     xsize = sp.xSize();
     fsize = sp.fSize();
     gradsize = sp.fGradientsSize();
@@ -449,22 +874,36 @@ void SurfData::addPoint(const SurfPoint& sp)
       throw bad_surf_data(errormsg.str());
     }
   }
-  SurfPointSet::iterator iter;
-  // This should be a safe const cast.  All that's happening is a check
-  // to see if another data point at the same location in the space has already
-  // been added.
-  iter = orderedPoints.find(const_cast<SurfPoint*>(&sp));
-  if (iter == orderedPoints.end()) {
+  std::size_t hash = hashPoint(&sp.X()[0]);
+  unsigned p = findPoint(&sp.X()[0], hash);
+  if (p == physicalSize()) {
     // This SurfPoint is not already in the data set.  Add it.
-    points.push_back(new SurfPoint(sp));
-    orderedPoints.insert(points[points.size()-1]);
-    mapping.push_back(points.size()-1);
+    storePoint(p, sp);
+    if (pointsBuilt) {
+      points.push_back(new SurfPoint(sp));
+    }
+    pointIndex.insert(std::make_pair(hash, p));
+    mapping.push_back(p);
   } else {
     // Another SurfPoint in this SurfData object has the same location and
     // may have different response value(s).  Replace the old point with 
     // this new one.
-    SurfPoint* spPtr = *iter;
-    *spPtr = sp;
+    storePoint(p, sp);
+    if (pointsBuilt) {
+      *points[p] = sp;
+    }
+  }
+}
+
+void SurfData::addPoints(const vector<SurfPoint>& new_points)
+{
+  if (new_points.empty()) return;
+  // the first point sets the sizes of an empty data set
+  addPoint(new_points[0]);
+  reservePoints(physicalSize() + new_points.size() - 1);
+  mapping.reserve(mapping.size() + new_points.size() - 1);
+  for (unsigned i = 1; i < new_points.size(); i++) {
+    addPoint(new_points[i]);
   }
 }
 
@@ -475,27 +914,39 @@ unsigned SurfData::addResponse(const vector<double>& newValues,
 {
   unsigned new_index;
   ostringstream errormsg;
-  if (points.empty()) {
+  detach();
+  unsigned n = physicalSize();
+  if (n == 0) {
     throw bad_surf_data(
              "Cannot add response because there are no data points"
           );
-  } else if (points.size() != mapping.size()) {
+  } else if (n != mapping.size()) {
     errormsg << "Cannot add response because physical set size is different "
 	     << "than logical set size.\nBefore adding another response, "
              << "clear \"excluded points\" or create a new data set by using " 
 	     << "the SurfData::copyActive method." << endl;
     throw bad_surf_data(errormsg.str());
-  } else if (newValues.size() != points.size()) {
+  } else if (newValues.size() != n) {
     errormsg << "Cannot add another response: the number of new response"
              << " values does not match the size of the physical data set." 
              << endl;
     throw bad_surf_data(errormsg.str());
   } else {
-    new_index = points[mapping[0]]->addResponse(newValues[0]);
+    // the response stride changes, so fBlock is laid out afresh
+    new_index = fsize;
+    VecDbl new_block(n*(fsize+1));
+    for (unsigned p = 0; p < n; p++) {
+      std::copy(fBlock.begin() + p*fsize, fBlock.begin() + (p+1)*fsize,
+		new_block.begin() + p*(fsize+1));
+      new_block[p*(fsize+1) + fsize] = newValues[p];
+    }
+    fBlock.swap(new_block);
     fsize++;
-    for (unsigned i = 1; i < points.size(); i++) {
-      new_index = points[mapping[i]]->addResponse(newValues[i]);
-      assert(new_index == fsize - 1);
+    if (pointsBuilt) {
+      for (unsigned p = 0; p < n; p++) {
+	unsigned added = points[p]->addResponse(newValues[p]);
+	assert(added == new_index);
+      }
     }
   }
   if (label != "") {
@@ -511,7 +962,7 @@ unsigned SurfData::addResponse(const vector<double>& newValues,
 void SurfData::setConstraintPoint(const SurfPoint& sp)
 {
   // handle the case of this being the first point in the data set
-  if (points.empty()) { 
+  if (physicalSize() == 0) { 
     xsize = sp.xSize();
     fsize = sp.fSize();
     gradsize = sp.fGradientsSize();
@@ -539,7 +990,7 @@ void SurfData::setConstraintPoint(const SurfPoint& sp)
 /// subset of the SurfPoints should be used for some computation.
 void SurfData::setExcludedPoints(const set<unsigned>& excluded_points)
 {
-  if (excluded_points.size() > points.size()) {
+  if (excluded_points.size() > physicalSize()) {
     throw bad_surf_data(
       "Size of set of excluded points exceeds size of SurfPoint set"
     );
@@ -549,11 +1000,11 @@ void SurfData::setExcludedPoints(const set<unsigned>& excluded_points)
   } else {
     // The size of the logical data set is the size of the physical
     // data set less the number of excluded points    
-    mapping.resize(points.size() - excluded_points.size());
+    mapping.resize(physicalSize() - excluded_points.size());
     unsigned mappingIndex = 0;
     unsigned sdIndex = 0;
     // map the valid indices to the physical points in points
-    while (sdIndex < points.size()) {
+    while (sdIndex < physicalSize()) {
       if (excluded_points.find(sdIndex) == excluded_points.end()) {
         mapping[mappingIndex++] = sdIndex;
       }
@@ -569,17 +1020,167 @@ void SurfData::setExcludedPoints(const set<unsigned>& excluded_points)
 /// duplication when other points are added in the future
 void SurfData::buildOrderedPoints()
 {
-  orderedPoints.clear();
-  for (unsigned i = 0; i < points.size(); i++) {
-    orderedPoints.insert(points[i]);
+  pointIndex.clear();
+  if (mapped) return;
+  pointIndex.reserve(physicalSize());
+  for (unsigned p = 0; p < physicalSize(); p++) {
+    pointIndex.insert(std::make_pair(hashPoint(&xBlock[p*xsize]), p));
   }
 }
 
+/// Each block is point-major, so a new point is appended to each
+void SurfData::storePoint(unsigned p, const SurfPoint& sp)
+{
+  assert(xBlock.size() >= p*xsize);
+  if (xBlock.size() == p*xsize) {
+    xBlock.resize((p+1)*xsize);
+    fBlock.resize((p+1)*fsize);
+    gradientBlock.resize((p+1)*gradsize*xsize);
+    hessianBlock.resize((p+1)*hesssize*xsize*xsize);
+  }
+  std::copy(sp.X().begin(), sp.X().end(), xBlock.begin() + p*xsize);
+  for (unsigned k = 0; k < fsize; k++) {
+    fBlock[p*fsize + k] = sp.F(k);
+  }
+  for (unsigned k = 0; k < gradsize; k++) {
+    const VecDbl& gradient = sp.fGradient(k);
+    std::copy(gradient.begin(), gradient.end(), 
+	      gradientBlock.begin() + (p*gradsize + k)*xsize);
+  }
+  for (unsigned k = 0; k < hesssize; k++) {
+    const MtxDbl& hessian = sp.fHessian(k);
+    double* block = &hessianBlock[(p*hesssize + k)*xsize*xsize];
+    for (unsigned c = 0; c < xsize; c++) {
+      for (unsigned r = 0; r < xsize; r++) {
+	block[c*xsize + r] = hessian(r,c);
+      }
+    }
+  }
+}
+
+void SurfData::rebuildBlocks()
+{
+  xBlock.clear();
+  fBlock.clear();
+  gradientBlock.clear();
+  hessianBlock.clear();
+  xBlock.reserve(points.size()*xsize);
+  fBlock.reserve(points.size()*fsize);
+  for (unsigned p = 0; p < points.size(); p++) {
+    storePoint(p, *points[p]);
+  }
+}
+
+SurfPoint* SurfData::newPoint(unsigned p) const
+{
+  assert(p < physicalSize());
+  return new SurfPoint(xsize, fsize, gradsize, hesssize,
+    xData() + p*xsize, 
+    fsize ? fData() + p*fsize : NULL,
+    gradsize ? gradientData() + p*gradsize*xsize : NULL,
+    hesssize ? hessianData() + p*hesssize*xsize*xsize : NULL);
+}
+
+void SurfData::reservePoints(unsigned n)
+{
+  if (pointsBuilt) {
+    points.reserve(n);
+  }
+  xBlock.reserve(n*xsize);
+  fBlock.reserve(n*fsize);
+  gradientBlock.reserve(n*gradsize*xsize);
+  hessianBlock.reserve(n*hesssize*xsize*xsize);
+  pointIndex.reserve(n);
+}
+
+void SurfData::copyPoints(const SurfData& other)
+{
+  // the SurfPoints are views, built again on demand
+  if (other.mapped) {
+    // share the read-only mapping
+    mapped = other.mapped;
+    return;
+  }
+  xBlock = other.xBlock;
+  fBlock = other.fBlock;
+  gradientBlock = other.gradientBlock;
+  hessianBlock = other.hessianBlock;
+  pointIndex = other.pointIndex;
+}
+
+/// Coordinates that compare equal hash alike: -0.0 is hashed as 0.0
+std::size_t SurfData::hashPoint(const double* x) const
+{
+  std::size_t hash = xsize;
+  for (unsigned j = 0; j < xsize; j++) {
+    double coord = (x[j] == 0.0) ? 0.0 : x[j];
+    std::uint64_t bits;
+    std::memcpy(&bits, &coord, sizeof(bits));
+    hash ^= std::hash<std::uint64_t>()(bits) + 0x9e3779b97f4a7c15ULL + 
+      (hash << 6) + (hash >> 2);
+  }
+  return hash;
+}
+
+/// Locations match when all coordinates compare equal, as for
+/// SurfPoint::SurfPointPtrLessThan
+unsigned SurfData::findPoint(const double* x, std::size_t hash) const
+{
+  typedef std::unordered_multimap<std::size_t, unsigned>::const_iterator
+    IndexIt;
+  std::pair<IndexIt, IndexIt> candidates = pointIndex.equal_range(hash);
+  for (IndexIt it = candidates.first; it != candidates.second; ++it) {
+    if (std::equal(x, x + xsize, &xBlock[it->second*xsize])) {
+      return it->second;
+    }
+  }
+  return physicalSize();
+}
+
+unsigned SurfData::findPoint(const double* x) const
+{
+  return findPoint(x, hashPoint(x));
+}
+
+unsigned SurfData::physicalSize() const
+{
+  if (mapped) return mapped->header.points;
+  return xsize ? xBlock.size()/xsize : 0;
+}
+
+void SurfData::materialize() const
+{
+  if (pointsBuilt.load(std::memory_order_acquire)) return;
+  std::lock_guard<std::mutex> lock(pointsMutex);
+  if (pointsBuilt.load(std::memory_order_relaxed)) return;
+  unsigned n = physicalSize();
+  points.reserve(n);
+  for (unsigned p = 0; p < n; p++) {
+    points.push_back(newPoint(p));
+  }
+  pointsBuilt.store(true, std::memory_order_release);
+}
+
+void SurfData::detach()
+{
+  if (!mapped) return;
+  // any SurfPoints already built hold their own copies
+  unsigned n = physicalSize();
+  const ColumnarFile& file = *mapped;
+  xBlock.assign(file.x, file.x + n*xsize);
+  fBlock.assign(file.f, file.f + n*fsize);
+  gradientBlock.assign(file.gradients, file.gradients + n*gradsize*xsize);
+  hessianBlock.assign(file.hessians, 
+		      file.hessians + n*hesssize*xsize*xsize);
+  mapped.reset();
+  buildOrderedPoints();
+}
+
 /// Maps all indices to themselves in the mapping data member
 void SurfData::defaultMapping()
 {
-  mapping.resize(points.size());
-  for (unsigned i = 0; i < points.size(); i++) {
+  mapping.resize(physicalSize());
+  for (unsigned i = 0; i < mapping.size(); i++) {
     mapping[i] = i;
   }
 }
@@ -626,6 +1227,14 @@ void SurfData::write(const string& filename) const
 	     << "  No active data points." << endl;
     throw bad_surf_data(errormsg.str());
   }
+  if (surfpack::hasExtension(filename,".cbspd")) {
+    ofstream outfile(filename.c_str(), ios::out|ios::binary);
+    if (!outfile) {
+      throw surfpack::file_open_failure(filename);
+    }
+    writeColumnar(outfile);
+    return;
+  }
   bool binary = hasBinaryFileExtension(filename);
   ofstream outfile(filename.c_str(), 
     (binary ? ios::out|ios::binary : ios::out));
@@ -645,6 +1254,10 @@ void SurfData::write(const string& filename) const
 /// Read a set of SurfPoints from a file.  Opens file and calls other version.
 void SurfData::read(const string& filename)
 {
+  if (surfpack::hasExtension(filename,".cbspd")) {
+    readColumnar(filename);
+    return;
+  }
   // Open file in binary or text mode based on filename extension (.bspd or .spd)
   bool binary = hasBinaryFileExtension(filename);
   ifstream infile(filename.c_str(), (binary ? ios::in|ios::binary : ios::in));
@@ -668,10 +1281,41 @@ void SurfData::writeBinary(ostream& os) const
   os.write((char*)&fsize,sizeof(fsize));
   os.write((char*)&gradsize,sizeof(gradsize));
   os.write((char*)&hesssize,sizeof(hesssize));
-  ///\todo accumulate all the writes into one big chunk of data
-  /// and write it out all at once.
-  for (unsigned i = 0; i < mapping.size(); i++) {
-    points[mapping[i]]->writeBinary(os);
+  // Each point is written as by SurfPoint::writeBinary: x, f, the
+  // gradients, then the Hessians row by row.  The records are gathered
+  // from the columnar blocks and written a chunk of points at a time.
+  const unsigned record_size = 
+    xsize + fsize + gradsize*xsize + hesssize*xsize*xsize;
+  const unsigned chunk_points = 4096;
+  VecDbl chunk;
+  chunk.reserve(std::min<std::size_t>(chunk_points, s)*record_size);
+  const double* x = xData();
+  const double* f = fData();
+  const double* gradients = gradientData();
+  const double* hessians = hessianData();
+  for (unsigned i = 0; i < s; i++) {
+    unsigned p = mapping[i];
+    chunk.insert(chunk.end(), x + p*xsize, x + (p+1)*xsize);
+    if (fsize) {
+      chunk.insert(chunk.end(), f + p*fsize, f + (p+1)*fsize);
+    }
+    if (gradsize) {
+      chunk.insert(chunk.end(), gradients + p*gradsize*xsize, 
+		   gradients + (p+1)*gradsize*xsize);
+    }
+    for (unsigned k = 0; k < hesssize; k++) {
+      const double* hessian = hessians + (p*hesssize + k)*xsize*xsize;
+      for (unsigned r = 0; r < xsize; r++) {
+	for (unsigned c = 0; c < xsize; c++) {
+	  chunk.push_back(hessian[c*xsize + r]);
+	}
+      }
+    }
+    if ((i+1) % chunk_points == 0 || i+1 == s) {
+      os.write(reinterpret_cast<const char*>(&chunk[0]), 
+	       chunk.size()*sizeof(double));
+      chunk.clear();
+    }
   }
 }
 
@@ -697,11 +1341,48 @@ void SurfData::writeText(ostream& os,
       }
       os << endl;
     }
-    for (unsigned i = 0; i < mapping.size(); i++) {
-      //if (!write_header) {
-      //  os << setw((int)log10((double)(mapping.size())+2)) << (i+1);
-      //}
-      points[mapping[i]]->writeText(os);
+    // Each point is written as by SurfPoint::writeText: x, f, the
+    // gradients, then the Hessians row by row.  Batches of points are
+    // formatted from the columnar blocks in parallel, then written in
+    // order.
+    const double* x = xData();
+    const double* f = fData();
+    const double* gradients = gradientData();
+    const double* hessians = hessianData();
+    for (unsigned first = 0; first < mapping.size(); 
+	 first += text_batch_points) {
+      unsigned count = std::min<unsigned>(text_batch_points, 
+					  mapping.size() - first);
+      unsigned n_blocks = surfpack::parallel_threads(0, count/1024 + 1);
+      vector<string> text(n_blocks);
+      surfpack::parallel_for(n_blocks, n_blocks, [&](unsigned id, unsigned) {
+	unsigned last = first + surfpack::block_low(id+1, n_blocks, count);
+	for (unsigned i = first + surfpack::block_low(id, n_blocks, count);
+	     i < last; i++) {
+	  unsigned p = mapping[i];
+	  for (unsigned j = 0; j < xsize; j++) {
+	    appendTextField(text[id], x[p*xsize + j]);
+	  }
+	  for (unsigned k = 0; k < fsize; k++) {
+	    appendTextField(text[id], f[p*fsize + k]);
+	  }
+	  for (unsigned j = 0; j < gradsize*xsize; j++) {
+	    appendTextField(text[id], gradients[p*gradsize*xsize + j]);
+	  }
+	  for (unsigned k = 0; k < hesssize; k++) {
+	    const double* hessian = hessians + (p*hesssize + k)*xsize*xsize;
+	    for (unsigned r = 0; r < xsize; r++) {
+	      for (unsigned c = 0; c < xsize; c++) {
+		appendTextField(text[id], hessian[c*xsize + r]);
+	      }
+	    }
+	  }
+	  text[id] += '\n';
+	}
+      });
+      for (unsigned id = 0; id < n_blocks; id++) {
+	os.write(text[id].data(), text[id].size());
+      }
     }
 }
 
@@ -721,7 +1402,6 @@ void SurfData::readBinary(istream& is)
     is.read((char*)&fsize,sizeof(fsize));
     is.read((char*)&gradsize,sizeof(gradsize));
     is.read((char*)&hesssize,sizeof(hesssize));
-    points.clear();
     for (n_points_read = 0; n_points_read < size; n_points_read++) {
       // Throw an exception if we hit the end-of-file before we've
       // read the number of points that were supposed to be there.
@@ -736,6 +1416,75 @@ void SurfData::readBinary(istream& is)
   } 
 }
 
+/// Writes the active points, so the blocks are gathered when some
+/// points are excluded
+void SurfData::writeColumnar(ostream& os) const
+{
+  ColumnarHeader header;
+  std::memcpy(header.magic, columnar_magic, sizeof(columnar_magic));
+  header.version = columnar_version;
+  header.byteOrder = columnar_byte_order;
+  header.points = mapping.size();
+  header.xsize = xsize;
+  header.fsize = fsize;
+  header.gradsize = gradsize;
+  header.hesssize = hesssize;
+  string labels;
+  for (unsigned i = 0; i < xLabels.size(); i++) {
+    labels += xLabels[i];
+    labels += '\0';
+  }
+  for (unsigned i = 0; i < fLabels.size(); i++) {
+    labels += fLabels[i];
+    labels += '\0';
+  }
+  header.labelBytes = labels.size();
+  std::uint64_t offsets[5];
+  columnarLayout(header, offsets);
+
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  os.write(labels.data(), labels.size());
+  std::uint64_t written = sizeof(header) + labels.size();
+  const char padding[columnar_alignment] = { 0 };
+  const double* blocks[4] = 
+    { xData(), fData(), gradientData(), hessianData() };
+  const unsigned strides[4] = 
+    { xsize, fsize, gradsize*xsize, hesssize*xsize*xsize };
+  for (unsigned b = 0; b < 4; b++) {
+    os.write(padding, offsets[b] - written);
+    if (strides[b] == 0 || mapping.empty()) {
+      written = offsets[b];
+      continue;
+    }
+    std::size_t row_bytes = strides[b]*sizeof(double);
+    const char* block = reinterpret_cast<const char*>(blocks[b]);
+    if (mapping.size() == physicalSize()) {
+      os.write(block, mapping.size()*row_bytes);
+    } else {
+      for (unsigned i = 0; i < mapping.size(); i++) {
+	os.write(block + mapping[i]*row_bytes, row_bytes);
+      }
+    }
+    written = offsets[b] + mapping.size()*row_bytes;
+  }
+  assert(written == offsets[4]);
+}
+
+void SurfData::readColumnar(const string& filename)
+{
+  std::shared_ptr<const ColumnarFile> file(new ColumnarFile(filename));
+  cleanup();
+  xsize = file->header.xsize;
+  fsize = file->header.fsize;
+  gradsize = file->header.gradsize;
+  hesssize = file->header.hesssize;
+  xLabels = file->xLabels;
+  fLabels = file->fLabels;
+  // the points are assumed distinct, as when written by writeColumnar
+  mapped = file;
+  defaultMapping();
+}
+
 unsigned SurfData::readHeaderInfo(istream& is)
 {
   string single_line;
@@ -772,28 +1521,55 @@ void SurfData::readText(istream& is, bool read_header, unsigned skip_columns)
   string single_line;
   try {
     cleanup();
-    points.clear();
     if (read_header) declared_size = readHeaderInfo(is);
 
+    // The first line may hold labels; otherwise it is parsed with the
+    // rest of the stream, which is read whole
     getline(is,single_line);
-    istringstream streamline(single_line);
+    string text;
     if (!readLabelsIfPresent(single_line)) {
-      if (single_line != "" && single_line != "\n" && single_line[0] != '%') {
-        this->addPoint(SurfPoint(single_line, xsize, 
-				 fsize, gradsize, hesssize, skip_columns));
-        n_points_read = 1;
-      }
+      text = single_line + '\n';
     }
-    while (!is.eof()) {
-      // Throw an exception if we hit the end-of-file before we've
-      // read the number of points that were supposed to be there.
-      //surfpack::checkForEOF(is);
-      getline(is,single_line);
-      if (single_line[0] == '%' || single_line == "") continue;
-      // False for last argument signals a text read
-      this->addPoint(SurfPoint(single_line, xsize, 
-			       fsize, gradsize, hesssize, skip_columns));  
-      n_points_read++;
+    char chunk[1 << 16];
+    while (is.read(chunk, sizeof(chunk)) || is.gcount() > 0) {
+      text.append(chunk, is.gcount());
+    }
+
+    // Parse blocks of whole lines in parallel, then add the points in
+    // file order, so duplicates replace earlier points as before
+    const char* begin = text.c_str();
+    const char* end = begin + text.size();
+    unsigned n_blocks = surfpack::parallel_threads(0, 
+      static_cast<unsigned>(text.size()/text_block_bytes + 1));
+    vector<const char*> starts(n_blocks + 1, end);
+    starts[0] = begin;
+    for (unsigned id = 1; id < n_blocks; id++) {
+      const char* guess = std::max(begin + text.size()/n_blocks*id, 
+				   starts[id-1]);
+      const char* eol = std::find(guess, end, '\n');
+      starts[id] = (eol == end) ? end : eol + 1;
+    }
+    vector<VecDbl> values(n_blocks);
+    surfpack::parallel_for(n_blocks, n_blocks, [&](unsigned id, unsigned) {
+      parseTextPoints(starts[id], starts[id+1], xsize, fsize, gradsize, 
+		      hesssize, skip_columns, values[id]);
+    });
+    const unsigned record_size = 
+      xsize + fsize + gradsize*xsize + hesssize*xsize*xsize;
+    std::size_t n_records = 0;
+    for (unsigned id = 0; id < n_blocks; id++) {
+      n_records += values[id].size()/std::max(record_size, 1u);
+    }
+    reservePoints(n_records);
+    for (unsigned id = 0; id < n_blocks; id++) {
+      for (std::size_t r = 0; r < values[id].size(); r += record_size) {
+	const double* record = &values[id][r];
+	this->addPoint(SurfPoint(xsize, fsize, gradsize, hesssize, record,
+	  record + xsize, record + xsize + fsize, 
+	  record + xsize + fsize + gradsize*xsize));
+	n_points_read++;
+      }
+      VecDbl().swap(values[id]);
     }
     defaultMapping();
   } catch(surfpack::io_exception& exception) {
@@ -831,7 +1607,7 @@ bool SurfData::hasBinaryFileExtension(const string& filename) const
     return false;
   } else {
     throw surfpack::io_exception(
-      "Unrecognized filename extension.  Use .bspd, or .spd"
+      "Unrecognized filename extension.  Use .bspd, .cbspd, or .spd"
     );
   }
 }
@@ -889,31 +1665,24 @@ bool SurfData::readLabelsIfPresent(string single_line)
 // Testing 
 // ____________________________________________________________________________
 
-// Throw an exception if there are any mismatches in the number of
-// dimensions or number of response values among points in the data set  
+// Throw an exception if the blocks don't hold whole points of the
+// data set's sizes (addPoint checks each point's sizes as it is added)
 void SurfData::sanityCheck() const
 {
-  if (!points.empty()) {
-    unsigned dimensionality = points[0]->xSize();
-    unsigned numResponses = points[0]->fSize();
-    unsigned numGrad = points[0]->fGradientsSize();
-    unsigned numHess = points[0]->fHessiansSize();
-    for (unsigned i = 1; i < points.size(); i++) {
-      if (points[i]->xSize() != dimensionality ||
-          points[i]->fSize() != numResponses || 
-          points[i]->fGradientsSize() != numGrad || 
-          points[i]->fHessiansSize() != numHess ) {
-        ostringstream errormsg;
-        errormsg << "Error in SurfData::sanityCheck." << endl
-		 << "Point 0 has " << dimensionality << " dimensions "
-                 << "and " << numResponses << " response values, " << endl
-                 << "but point " << i << " has " << points[i]->xSize()
- 		 << " dimensions and " << points[i]->fSize() << "response "
- 		 << " values. (Or gradient and Hessian sizes are wrong.)";
-	throw bad_surf_data(errormsg.str());
-      } // if mismatch
-    } // for each point
-  } // if !empty
+  if (mapped) return;
+  unsigned n = physicalSize();
+  if (xBlock.size() != std::size_t(n)*xsize ||
+      fBlock.size() != std::size_t(n)*fsize ||
+      gradientBlock.size() != std::size_t(n)*gradsize*xsize ||
+      hessianBlock.size() != std::size_t(n)*hesssize*xsize*xsize) {
+    ostringstream errormsg;
+    errormsg << "Error in SurfData::sanityCheck." << endl
+	     << "The data blocks don't hold " << n << " points of "
+	     << xsize << " dimensions and " << fsize << " response values"
+	     << " (with " << gradsize << " gradients and " << hesssize
+	     << " Hessians).";
+    throw bad_surf_data(errormsg.str());
+  }
 }
 
 /// Check that the index falls within acceptable boundaries (i.e., is
@@ -966,10 +1735,8 @@ VecVecDbl SurfData::asVecVecDbl(const SurfData& data)
 {
   VecVecDbl result(data.size());
   for (unsigned i = 0; i < data.size(); i++) {
-    result[i].resize(data.xSize());
-    for (unsigned j = 0; j < data.xSize(); j++) {
-      result[i][j] = data(i,j);
-    }
+    const double* x = data.xData() + data.physicalIndex(i)*data.xSize();
+    result[i].assign(x, x + data.xSize());
   }
   return result;
 }
@@ -17,6 +17,16 @@
 /// subset of the data if they so choose (e.g., in a cross-validation 
 /// algorithm).  Contains methods for I/O support.  Does not allow duplicate
 /// points.
+/// The numeric data are held only in columnar form, one contiguous
+/// point-major block each for x, f, gradients, and Hessians, which
+/// model builders can read without gathering them point by point.
+/// The SurfPoints that operator[] and operator()(pt) refer to are
+/// views built from the blocks when first requested; once built they
+/// are kept in step with later changes, and they are not copied.
+/// Data read from a columnar binary (.cbspd) file stay in the
+/// read-only file mapping, shared by copies of the object and by other
+/// processes reading the same file; the data are copied out of the
+/// mapping when the object is first modified.
 /// \todo Allow the points to be weighted differently, as would be needed
 /// in weighted regression.
 class SurfData
@@ -127,6 +137,12 @@ public:
   /// Return the number of response functions in the data set
   unsigned fSize() const;
 
+  /// Return the number of responses having gradients (0 or fSize())
+  unsigned fGradientsSize() const;
+
+  /// Return the number of responses having Hessians (0 or fSize())
+  unsigned fHessiansSize() const;
+
   /// Return the set of excluded points (the indices)
   const std::set<unsigned>& getExcludedPoints() const ; 
 
@@ -164,6 +180,33 @@ public:
   /// name.  Return false if not found
   bool varIndex(const std::string& name, unsigned& index, bool& isResponse) const;
 
+// ____________________________________________________________________________
+// Columnar views 
+// ____________________________________________________________________________
+
+  /// The blocks below cover every point physically present, including
+  /// any excluded ones, in the order added; the point at (active)
+  /// index i is physical point physicalIndex(i).  Pointers remain
+  /// valid until the data set is next modified, and are NULL when
+  /// there is no such data.
+  unsigned physicalIndex(unsigned index) const;
+
+  /// x values: coordinate j of physical point p is 
+  /// xData()[p*xSize() + j]
+  const double* xData() const;
+
+  /// responses: response k of physical point p is fData()[p*fSize() + k]
+  const double* fData() const;
+
+  /// gradients: component j of the gradient of response k at physical
+  /// point p is gradientData()[(p*fGradientsSize() + k)*xSize() + j]
+  const double* gradientData() const;
+
+  /// Hessians, each stored column-major: entry (r,c) of the Hessian of
+  /// response k at physical point p is
+  /// hessianData()[((p*fHessiansSize() + k)*xSize() + c)*xSize() + r]
+  const double* hessianData() const;
+
   
 
 // ____________________________________________________________________________
@@ -182,8 +225,13 @@ public:
   void setResponse(unsigned index, double value);
 
   /// Add a point to the data set. The passed point will be copied.
+  /// A point at the same location as one already present replaces it.
   void addPoint(const SurfPoint& sp);
 
+  /// Add each of the points in turn, as by addPoint, reserving space
+  /// for them all first
+  void addPoints(const std::vector<SurfPoint>& new_points);
+
   /// Add a new response variable to each point, possibly with label. 
   /// Return the index of the new variable.
   unsigned addResponse(const std::vector<double>& newValues, 
@@ -197,9 +245,8 @@ public:
   /// subset of the SurfPoints should be used for some computation.
   void setExcludedPoints(const std::set<unsigned>& excluded_points);
 
-  /// For use with copy constructor and assignment operator-- creates a list of
-  /// pointers to the points in the data set which is used to check for 
-  /// duplication when other points are added in the future
+  /// Rebuild from scratch the index used to check for duplication when
+  /// points are added; it is otherwise kept up to date incrementally
   void buildOrderedPoints();
 
   /// Set the labels for the predictor variables
@@ -219,6 +266,41 @@ private:
   /// Set x vars labels to 'x0' 'x1', etc.; resp. vars to 'f0' 'f1', etc.
   void defaultLabels();
 
+  /// Copy sp into the columnar blocks as physical point p, appending
+  /// it when p is one past their current end
+  void storePoint(unsigned p, const SurfPoint& sp);
+
+  /// Refill the columnar blocks from points
+  void rebuildBlocks();
+
+  /// A SurfPoint holding a copy of physical point p
+  SurfPoint* newPoint(unsigned p) const;
+
+  /// Make room for n physical points of the current sizes
+  void reservePoints(unsigned n);
+
+  /// Copy the blocks and index of other (not its SurfPoints)
+  void copyPoints(const SurfData& other);
+
+  /// Hash of the xsize coordinates at x, for pointIndex
+  std::size_t hashPoint(const double* x) const;
+
+  /// Physical index of the point located at x (whose hash is given),
+  /// or physicalSize() if there is none
+  unsigned findPoint(const double* x, std::size_t hash) const;
+  unsigned findPoint(const double* x) const;
+
+  /// Number of points physically present, including excluded ones
+  unsigned physicalSize() const;
+
+  /// Build the SurfPoints from the blocks if they haven't been; safe
+  /// to call from concurrent readers
+  void materialize() const;
+
+  /// Copy the data out of any file mapping, in preparation for a
+  /// modification
+  void detach();
+
 public:
    
 // ____________________________________________________________________________
@@ -227,6 +309,7 @@ public:
 
   /// Write the active SurfPoints to a file
   /// binary extension .bspd: includes header not labels
+  /// binary extension .cbspd: columnar, includes header and labels
   /// text extension    .spd: includes header and label info
   /// text extension    .dat: no header or labels
   void write(const std::string& filename) const;
@@ -245,6 +328,13 @@ public:
   /// Read the data in binary format
   void readBinary(std::istream& is); 
 
+  /// Write the data in columnar binary format, with header and labels
+  void writeColumnar(std::ostream& os) const;
+
+  /// Map a columnar binary file, which is read in place (see class
+  /// description); the file contents must not change while mapped
+  void readColumnar(const std::string& filename);
+
   /// Read the data in text format
   void readText(std::istream& is, bool read_header = true, 
     unsigned skip_columns = 0); 
@@ -267,8 +357,29 @@ private:
   /// Number of responses with Hessian data (must be 0 or fsize)
   unsigned hesssize;
 
-  /// The set of points in this data set
-  std::vector<SurfPoint*> points; 
+  /// SurfPoint views of the physical points, built by materialize()
+  /// and then kept in step with the blocks; empty until then
+  mutable std::vector<SurfPoint*> points; 
+
+  /// The x, f, gradient, and Hessian data of the points, laid out as
+  /// described with xData() and friends
+  std::vector<double> xBlock;
+  std::vector<double> fBlock;
+  std::vector<double> gradientBlock;
+  std::vector<double> hessianBlock;
+
+  /// Read-only view of a columnar binary file
+  struct ColumnarFile;
+
+  /// When set, the file holding the columnar blocks in place of the
+  /// vectors above
+  std::shared_ptr<const ColumnarFile> mapped;
+
+  /// True once points has been built
+  mutable std::atomic<bool> pointsBuilt{false};
+
+  /// Serializes materialize()
+  mutable std::mutex pointsMutex;
 
   /// The indices of points that are to be excluded in computation. This can
   /// be used in a cross-validation scheme to systematically ignore parts of
@@ -300,12 +411,12 @@ public:
   typedef std::set<SurfPoint*,SurfPoint::SurfPointPtrLessThan> SurfPointSet;
 
 private:
-  /// Stores the same set of SurfPoint* that points does, but because it is a 
-  /// set, membership tests can be done in O(log n) time.  When combined with
-  /// the SurfPointPtrLessThan functor object, it allows a SurfData object to
-  /// check all SurfPoints in the data set against all others for duplication.
-  /// This can be done in O(n log n) time instead of O(n^2).
-  SurfPointSet orderedPoints;
+  /// The physical indices of the points, keyed by hashPoint() of their
+  /// locations, so a point being added is checked for duplication in
+  /// expected constant time.  Being free of pointers, it is copied
+  /// along with the data rather than rebuilt.  Empty while the data
+  /// are held in a file mapping.
+  std::unordered_multimap<std::size_t, unsigned> pointIndex;
 
 // ____________________________________________________________________________
 // Helper methods 
@@ -366,10 +477,17 @@ template<class Archive>
 void SurfData::serialize(Archive & archive, 
 			 const unsigned int version)
 {  
+  // a data set loaded over holds none of its former points or mapping
+  if (Archive::is_loading::value)
+    cleanup();
   archive & xsize;
   archive & fsize;
   archive & gradsize;
   archive & hesssize;
+  // archives hold the points as SurfPoints; loaded ones are moved into
+  // the blocks
+  if (Archive::is_saving::value)
+    materialize();
   archive & points;
   archive & excludedPoints;
   archive & mapping;
@@ -377,7 +495,19 @@ void SurfData::serialize(Archive & archive,
   archive & constraintPoint;
   archive & xLabels;
   archive & fLabels;
-  archive & orderedPoints;
+  // archives hold the ordered set of points that preceded pointIndex;
+  // on loading, its pointers are to the objects already in points
+  SurfPointSet ordered_points;
+  if (Archive::is_saving::value)
+    ordered_points.insert(points.begin(), points.end());
+  archive & ordered_points;
+  if (Archive::is_loading::value) {
+    rebuildBlocks();
+    buildOrderedPoints();
+    for (unsigned p = 0; p < points.size(); p++)
+      delete points[p];
+    points.clear();
+  }
 }
 #endif
 
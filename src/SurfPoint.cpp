@@ -78,14 +78,39 @@ SurfPoint::SurfPoint(istream& is, unsigned xsize, unsigned fsize,
 		     unsigned grad_size, unsigned hess_size) 
   : x(xsize), f(fsize), fGradients(grad_size), fHessians(hess_size)
 {
-  for(unsigned i = 0; i < fsize; ++i) {
-    fGradients.resize(xsize);
-    fHessians.resize(xsize, xsize);
+  for (unsigned i = 0; i < grad_size; ++i) {
+    fGradients[i].resize(xsize);
+  }
+  for (unsigned i = 0; i < hess_size; ++i) {
+    fHessians[i].resize(xsize, xsize);
   }
   readBinary(is);
   init();
 }
 
+/// Initialize from raw arrays laid out as in the SurfData columnar blocks
+SurfPoint::SurfPoint(unsigned xsize, unsigned fsize, unsigned grad_size,
+		     unsigned hess_size, const double* x_in, 
+		     const double* f_in, const double* gradients, 
+		     const double* hessians)
+  : x(x_in, x_in + xsize), f(f_in, f_in + fsize), fGradients(grad_size),
+    fHessians(hess_size)
+{
+  for (unsigned k = 0; k < grad_size; k++) {
+    fGradients[k].assign(gradients + k*xsize, gradients + (k+1)*xsize);
+  }
+  for (unsigned k = 0; k < hess_size; k++) {
+    fHessians[k].resize(xsize, xsize);
+    const double* hessian = hessians + k*xsize*xsize;
+    for (unsigned c = 0; c < xsize; c++) {
+      for (unsigned r = 0; r < xsize; r++) {
+	fHessians[k](r,c) = hessian[c*xsize + r];
+      }
+    }
+  }
+  init();
+}
+
 /// Read point from string in text format
 SurfPoint::SurfPoint(const string& single_line, unsigned xsize, unsigned fsize, 
 		     unsigned grad_size, unsigned hess_size,
@@ -79,6 +79,13 @@ public:
   /// Initialize with zero or more response values
   SurfPoint(const std::vector<double>& x, const std::vector<double>& f);
   
+  /// Initialize from raw arrays laid out as in the SurfData columnar
+  /// blocks: grad_size gradients of xsize components each, then
+  /// hess_size Hessians, each stored column-major
+  SurfPoint(unsigned xsize, unsigned fsize, unsigned grad_size,
+	    unsigned hess_size, const double* x_in, const double* f_in,
+	    const double* gradients = 0, const double* hessians = 0);
+
   /// Read point from istream in binary format
   SurfPoint(std::istream& is, unsigned xsize, unsigned fsize, 
 	    unsigned grad_size = 0, unsigned hess_size = 0);
@@ -249,6 +256,10 @@ private:
 /// Write point to an output stream in text format
 std::ostream& operator<<(std::ostream& os, const SurfPoint& sp); 
 
+/// True if x and y agree to a relative 1e-10 (or are both within 1e-10
+/// of zero), the test SurfPoint::operator== applies to each value
+bool doubles_match(double x, double y);
+
 #ifdef SURFPACK_HAVE_BOOST_SERIALIZATION
 template<class Archive>
 void SurfPoint::serialize(Archive & archive, 
@@ -163,12 +163,12 @@ SurfData* SurfpackInterface::CreateSample(const AxesBounds* axes, unsigned n_sam
 }
 
 double SurfpackInterface::Fitness(const SurfpackModel* model, SurfData* sd, 
-const std::string& metric, unsigned response, unsigned n)
+const std::string& metric, unsigned response, unsigned n, unsigned n_threads)
 {
   assert(model);
   assert(sd);
   sd->setDefaultIndex(response);
-  ModelFitness* mf = ModelFitness::Create(metric,n);
+  ModelFitness* mf = ModelFitness::Create(metric,n,n_threads);
   double result = (*mf)(*model,*sd);
   delete mf;
   return result;
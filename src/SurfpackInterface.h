@@ -30,7 +30,8 @@ namespace SurfpackInterface
   SurfData* CreateSample(const AxesBounds* axes, const VecUns grid_points);
   SurfData* CreateSample(const AxesBounds* axes, unsigned n_samples);
   double Fitness(const SurfpackModel*, SurfData* sd, 
-    const std::string& metric, unsigned response = 0, unsigned n = 0);
+    const std::string& metric, unsigned response = 0, unsigned n = 0,
+    unsigned n_threads = 0);
   double Fitness(const SurfpackModel*, const std::string& metric, 
     unsigned response = 0, unsigned n = 0);
 
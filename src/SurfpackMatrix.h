@@ -10,6 +10,7 @@
 #define SURFPACK_MATRIX
 
 #include "surfpack_system_headers.h"
+#include "SurfpackProfile.h"
 
 /// A SurfpackMatrix uses an STL vector-- where all elements reside in a 
 /// contiguous block of memory-- to represent a two-dimensional matrix.
@@ -84,8 +85,9 @@ private:
   /// Number of columns in the matrix.
   unsigned nCols;
 
-  /// Contigous block of memory stores elements of the matrix.
-  std::vector< T > rawData;
+  /// Contigous block of memory stores elements of the matrix (counted
+  /// in the build profile, see SurfpackProfile.h)
+  std::vector< T, surfpack::ProfiledAllocator< T > > rawData;
 
   /// Row of matrix most recently references by operator[]
   //mutable SurfpackVector< T > oneRow;
@@ -153,13 +155,9 @@ void SurfpackMatrix< T >::resize(unsigned n_rows, unsigned n_cols)
   unsigned old_cols = nCols;
   nRows = n_rows;
   nCols = n_cols;
-  std::vector< T > old_data = rawData;
+  std::vector< T, surfpack::ProfiledAllocator< T > > old_data = rawData;
   // Now go back and make sure that all of the elements in the new
   // matrix that were also present in the old matrix retain their values
-  //unsigned row_max = min(old_rows,nRows);
-  unsigned row_max = (old_rows < nRows) ? old_rows : nRows;
-  //unsigned col_max = min(old_cols,nCols);
-  unsigned col_max = (old_cols < nCols) ? old_cols : nCols;
   rawData.resize(nRows*nCols);
   for (unsigned i = 0; i < nRows; i++) {
     for (unsigned j = 0; j < nCols; j++) {
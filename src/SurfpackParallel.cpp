@@ -0,0 +1,205 @@
+/*  _______________________________________________________________________
+
+    Surfpack: A Software Library of Multidimensional Surface Fitting Methods
+    Copyright (c) 2006, Sandia National Laboratories.
+    This software is distributed under the GNU Lesser General Public License.
+    For more information, see the README file in the top Surfpack directory.
+    _______________________________________________________________________ */
+
+#include "SurfpackParallel.h"
+#include "SurfpackProfile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// true on a thread while it works for a parallel_for
+static thread_local bool inParallelWorker = false;
+
+namespace {
+
+/// Marks the calling thread as a worker for its lifetime
+class WorkerScope
+{
+public:
+  WorkerScope() : prevInWorker(inParallelWorker) { inParallelWorker = true; }
+  ~WorkerScope() { inParallelWorker = prevInWorker; }
+private:
+  bool prevInWorker;
+};
+
+/// Threads kept for the life of the process to run parallel_for's
+/// workers, so a loop run once per optimizer iteration doesn't start
+/// and join threads every time.  A loop queues a job for each of its
+/// workers but the first, which is the calling thread; several loops
+/// (from different callers) may share the pool at once.
+class WorkerPool
+{
+public:
+  static WorkerPool& instance()
+  {
+    static WorkerPool pool;
+    return pool;
+  }
+
+  ~WorkerPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (unsigned t = 0; t < threads.size(); t++)
+      threads[t].join();
+  }
+
+  /// Call job(worker) for each worker in [0,n_workers), worker 0 on
+  /// the calling thread, returning once every call has finished.  A
+  /// job no pool thread has taken up by the time job(0) returns is
+  /// not run; job must not throw.
+  void run(unsigned n_workers, const std::function<void(unsigned)>& job)
+  {
+    Batch batch(job, n_workers - 1);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      // if no more threads can be started, the ones there are and the
+      // calling thread do the work
+      try {
+	while (threads.size() < n_workers - 1)
+	  threads.push_back(std::thread(&WorkerPool::serve, this));
+      }
+      catch (const std::system_error&) { }
+      for (unsigned worker = 1; worker < n_workers; worker++)
+	queue.push_back(Item(&batch, worker));
+    }
+    wake.notify_all();
+
+    job(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (std::deque<Item>::iterator it = queue.begin(); it != queue.end(); )
+      if (it->batch == &batch) {
+	it = queue.erase(it);
+	batch.pending--;
+      }
+      else
+	++it;
+    batch.done.wait(lock, [&batch]() { return batch.pending == 0; });
+  }
+
+private:
+  WorkerPool() : stopping(false) { }
+
+  /// the jobs of one run() and how many of them haven't finished
+  struct Batch
+  {
+    Batch(const std::function<void(unsigned)>& job_in, unsigned pending_in)
+      : job(job_in), pending(pending_in) { }
+    const std::function<void(unsigned)>& job;
+    unsigned pending;
+    std::condition_variable done;
+  };
+
+  struct Item
+  {
+    Item(Batch* batch_in, unsigned worker_in)
+      : batch(batch_in), worker(worker_in) { }
+    Batch* batch;
+    unsigned worker;
+  };
+
+  void serve()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+      if (stopping)
+	return;
+      Item item = queue.front();
+      queue.pop_front();
+      lock.unlock();
+      item.batch->job(item.worker);
+      lock.lock();
+      // run() can't return, and destroy the batch, before this unlocks
+      if (--item.batch->pending == 0)
+	item.batch->done.notify_all();
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<Item> queue;
+  std::vector<std::thread> threads;
+  bool stopping;
+};
+
+} // namespace
+
+
+unsigned surfpack::default_num_threads()
+{
+  static const unsigned n_default = []() {
+    const char* env = std::getenv("SURFPACK_NUM_THREADS");
+    if (env) {
+      int n = std::atoi(env);
+      if (n > 0) return static_cast<unsigned>(n);
+    }
+    unsigned n_hardware = std::max(std::thread::hardware_concurrency(), 1u);
+    return std::min(n_hardware, max_default_threads);
+  }();
+  return n_default;
+}
+
+unsigned surfpack::parallel_threads(unsigned n_threads, unsigned n_tasks)
+{
+  if (inParallelWorker) return 1;
+  if (n_threads == 0) n_threads = default_num_threads();
+  return std::max(std::min(n_threads, n_tasks), 1u);
+}
+
+void surfpack::parallel_for(unsigned n_tasks, unsigned n_threads,
+		  const std::function<void(unsigned, unsigned)>& body)
+{
+  unsigned p = parallel_threads(n_threads, n_tasks);
+  if (p == 1) {
+    for (unsigned task = 0; task < n_tasks; task++)
+      body(task, 0);
+    return;
+  }
+
+  std::atomic<unsigned> next_task(0);
+  std::vector<std::exception_ptr> errors(p);
+  // the other workers record into profiles of their own, merged into
+  // the caller's once they have finished
+  BuildProfile* profile = BuildProfileScope::active();
+  std::vector<BuildProfile> worker_profiles(profile ? p : 0);
+  auto work = [&](unsigned worker) {
+    WorkerScope worker_scope;
+    std::unique_ptr<BuildProfileScope> profile_scope;
+    try {
+      if (profile && worker > 0)
+	profile_scope.reset(new BuildProfileScope(worker_profiles[worker]));
+      unsigned task;
+      while ((task = next_task++) < n_tasks)
+	body(task, worker);
+    }
+    catch (...) {
+      errors[worker] = std::current_exception();
+      next_task = n_tasks;
+    }
+  };
+  WorkerPool::instance().run(p, work);
+  for (unsigned worker = 1; worker < worker_profiles.size(); worker++)
+    profile->merge(worker_profiles[worker]);
+  for (unsigned worker = 0; worker < p; worker++)
+    if (errors[worker])
+      std::rethrow_exception(errors[worker]);
+}
@@ -0,0 +1,56 @@
+/*  _______________________________________________________________________
+
+    Surfpack: A Software Library of Multidimensional Surface Fitting Methods
+    Copyright (c) 2006, Sandia National Laboratories.
+    This software is distributed under the GNU Lesser General Public License.
+    For more information, see the README file in the top Surfpack directory.
+    _______________________________________________________________________ */
+
+#ifndef SURFPACK_PARALLEL_H
+#define SURFPACK_PARALLEL_H
+
+#include <functional>
+
+// ____________________________________________________________________________
+// Thread parallel loops
+// ____________________________________________________________________________
+
+/// Every threaded loop in Surfpack (cross-validation folds, optimizer
+/// starts, correlation matrix tiles, RBF subsets and centers, SurfData
+/// text blocks) runs through parallel_for, so they share one default
+/// thread count and don't multiply when nested: a loop started from
+/// inside another loop's worker runs serially on that worker.  The
+/// workers other than the calling thread come from a pool of threads
+/// started on first use and kept until the process exits, so a loop
+/// run on every optimizer iteration doesn't pay to start threads.
+namespace surfpack {
+
+/// upper bound on the default thread count, so a build on a large
+/// node doesn't start a thread per core unasked
+const unsigned max_default_threads = 8;
+
+/// The thread count used when a caller passes 0: the value of the
+/// SURFPACK_NUM_THREADS environment variable if it is a positive
+/// integer, otherwise the number of hardware threads, at most
+/// max_default_threads
+unsigned default_num_threads();
+
+/// The number of threads parallel_for will use for n_tasks tasks when
+/// asked for n_threads (0 for the default): 1 inside another loop's
+/// worker, and never more than n_tasks
+unsigned parallel_threads(unsigned n_threads, unsigned n_tasks);
+
+/// Call body(task, worker) for each task in [0,n_tasks), spreading the
+/// tasks over parallel_threads(n_threads,n_tasks) workers that claim
+/// them in turn; worker 0 is the calling thread, and worker indexes
+/// are below parallel_threads(), e.g., to index per-worker scratch.
+/// The first exception a body throws stops the remaining tasks and is
+/// rethrown once all workers have finished.  Inside a build, what the
+/// workers record is merged into the calling thread's profile (see
+/// SurfpackProfile.h).
+void parallel_for(unsigned n_tasks, unsigned n_threads,
+		  const std::function<void(unsigned, unsigned)>& body);
+
+} // namespace surfpack
+
+#endif
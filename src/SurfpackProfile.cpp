@@ -0,0 +1,125 @@
+/*  _______________________________________________________________________
+
+    Surfpack: A Software Library of Multidimensional Surface Fitting Methods
+    Copyright (c) 2006, Sandia National Laboratories.
+    This software is distributed under the GNU Lesser General Public License.
+    For more information, see the README file in the top Surfpack directory.
+    _______________________________________________________________________ */
+
+#include "SurfpackProfile.h"
+
+#include <iomanip>
+#include <sstream>
+
+using std::setw;
+using std::string;
+
+// profile installed by the innermost BuildProfileScope on this thread
+static thread_local surfpack::BuildProfile* innermostProfile = NULL;
+
+std::atomic<unsigned> surfpack::BuildProfileScope::numActive(0);
+
+// a build has a handful of phases and counters, so a linear search by
+// name is as fast as anything
+void surfpack::BuildProfile::addPhase(const char* name, double seconds)
+{
+  for (std::size_t i = 0; i < phaseList.size(); i++) {
+    if (phaseList[i].name == name) {
+      phaseList[i].calls++;
+      phaseList[i].seconds += seconds;
+      return;
+    }
+  }
+  Phase phase = { name, 1, seconds };
+  phaseList.push_back(phase);
+}
+
+void surfpack::BuildProfile::addCount(const char* name, unsigned long long n)
+{
+  for (std::size_t i = 0; i < counterList.size(); i++) {
+    if (counterList[i].name == name) {
+      counterList[i].value += n;
+      return;
+    }
+  }
+  Counter counter = { name, n };
+  counterList.push_back(counter);
+}
+
+void surfpack::BuildProfile::merge(const BuildProfile& other)
+{
+  for (std::size_t i = 0; i < other.phaseList.size(); i++) {
+    const Phase& phase = other.phaseList[i];
+    std::size_t j = 0;
+    while (j < phaseList.size() && phaseList[j].name != phase.name) j++;
+    if (j == phaseList.size()) {
+      phaseList.push_back(phase);
+    } else {
+      phaseList[j].calls += phase.calls;
+      phaseList[j].seconds += phase.seconds;
+    }
+  }
+  for (std::size_t i = 0; i < other.counterList.size(); i++) {
+    addCount(other.counterList[i].name.c_str(), other.counterList[i].value);
+  }
+}
+
+double surfpack::BuildProfile::seconds(const string& phase) const
+{
+  for (std::size_t i = 0; i < phaseList.size(); i++) {
+    if (phaseList[i].name == phase) return phaseList[i].seconds;
+  }
+  return 0.0;
+}
+
+unsigned long long surfpack::BuildProfile::count(const string& counter) const
+{
+  for (std::size_t i = 0; i < counterList.size(); i++) {
+    if (counterList[i].name == counter) return counterList[i].value;
+  }
+  return 0;
+}
+
+void surfpack::BuildProfile::clear()
+{
+  phaseList.clear();
+  counterList.clear();
+}
+
+string surfpack::BuildProfile::asString() const
+{
+  std::ostringstream os;
+  os << std::left << setw(24) << "phase" << std::right << setw(10) << "calls"
+     << setw(14) << "seconds" << "\n";
+  for (std::size_t i = 0; i < phaseList.size(); i++) {
+    os << std::left << setw(24) << phaseList[i].name << std::right
+       << setw(10) << phaseList[i].calls << setw(14) << std::fixed
+       << std::setprecision(6) << phaseList[i].seconds << "\n";
+  }
+  os << std::left << setw(24) << "counter" << std::right << setw(24)
+     << "value" << "\n";
+  for (std::size_t i = 0; i < counterList.size(); i++) {
+    os << std::left << setw(24) << counterList[i].name << std::right
+       << setw(24) << counterList[i].value << "\n";
+  }
+  return os.str();
+}
+
+
+surfpack::BuildProfileScope::BuildProfileScope(BuildProfile& profile)
+  : prevProfile(innermostProfile)
+{
+  innermostProfile = &profile;
+  numActive++;
+}
+
+surfpack::BuildProfileScope::~BuildProfileScope()
+{
+  numActive--;
+  innermostProfile = prevProfile;
+}
+
+surfpack::BuildProfile* surfpack::BuildProfileScope::threadProfile()
+{
+  return innermostProfile;
+}
@@ -0,0 +1,153 @@
+/*  _______________________________________________________________________
+
+    Surfpack: A Software Library of Multidimensional Surface Fitting Methods
+    Copyright (c) 2006, Sandia National Laboratories.
+    This software is distributed under the GNU Lesser General Public License.
+    For more information, see the README file in the top Surfpack directory.
+    _______________________________________________________________________ */
+
+#ifndef SURFPACK_PROFILE_H
+#define SURFPACK_PROFILE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ____________________________________________________________________________
+// Build profiling
+// ____________________________________________________________________________
+
+/// A model build records where its time went into a BuildProfile: the
+/// wall clock time and number of calls of each instrumented phase
+/// (ScopedPhase), and counters such as factorizations or objective
+/// evaluations (profile_count).  Recording only happens on a thread
+/// with an active BuildProfileScope, which SurfpackModelFactory::Build
+/// sets up; parallel_for gives its workers scopes of their own and
+/// merges them into the caller's profile, so phase times run on
+/// workers add up across threads.  While no scope is active anywhere
+/// the instrumentation costs one relaxed atomic load.  Phases may
+/// nest, and their times are inclusive.
+namespace surfpack {
+
+class BuildProfile
+{
+public:
+  struct Phase
+  {
+    std::string name;
+    unsigned long calls;
+    double seconds;
+  };
+  struct Counter
+  {
+    std::string name;
+    unsigned long long value;
+  };
+
+  /// Add one call of the named phase, taking seconds
+  void addPhase(const char* name, double seconds);
+  /// Add n to the named counter
+  void addCount(const char* name, unsigned long long n);
+  /// Add the calls, seconds, and counts of other to this profile
+  void merge(const BuildProfile& other);
+
+  /// Phases and counters, in the order first recorded
+  const std::vector<Phase>& phases() const { return phaseList; }
+  const std::vector<Counter>& counters() const { return counterList; }
+  /// Total seconds in the named phase (0 if it never ran)
+  double seconds(const std::string& phase) const;
+  /// Value of the named counter (0 if never incremented)
+  unsigned long long count(const std::string& counter) const;
+  bool empty() const { return phaseList.empty() && counterList.empty(); }
+  void clear();
+
+  /// Phases and counters as a table, one per line
+  std::string asString() const;
+
+private:
+  std::vector<Phase> phaseList;
+  std::vector<Counter> counterList;
+};
+
+/// While in scope, the instrumentation on the constructing thread
+/// records into the passed profile.  Scopes may be nested; the
+/// innermost one is active.
+class BuildProfileScope
+{
+public:
+  BuildProfileScope(BuildProfile& profile);
+  ~BuildProfileScope();
+  /// the profile recording on the calling thread, or NULL
+  static BuildProfile* active()
+  { return numActive.load(std::memory_order_relaxed) ? threadProfile() : 0; }
+private:
+  /// the calling thread's innermost profile
+  static BuildProfile* threadProfile();
+  /// scopes alive on all threads, so threads outside a build skip the
+  /// thread-local lookup
+  static std::atomic<unsigned> numActive;
+  /// profile to restore on exit
+  BuildProfile* prevProfile;
+  BuildProfileScope(const BuildProfileScope&);
+  BuildProfileScope& operator=(const BuildProfileScope&);
+};
+
+/// Adds the wall clock time of its scope to the named phase of the
+/// active profile, if any; name must outlive the object (e.g., a
+/// string literal)
+class ScopedPhase
+{
+public:
+  ScopedPhase(const char* name_in)
+    : profile(BuildProfileScope::active()), name(name_in)
+  { if (profile) start = std::chrono::steady_clock::now(); }
+  ~ScopedPhase()
+  {
+    if (profile) profile->addPhase(name, std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count());
+  }
+private:
+  BuildProfile* profile;
+  const char* name;
+  std::chrono::steady_clock::time_point start;
+  ScopedPhase(const ScopedPhase&);
+  ScopedPhase& operator=(const ScopedPhase&);
+};
+
+/// Add n to the named counter of the active profile, if any
+inline void profile_count(const char* name, unsigned long long n = 1)
+{
+  if (BuildProfile* profile = BuildProfileScope::active())
+    profile->addCount(name, n);
+}
+
+/// Allocator for matrix storage, adding the bytes of each allocation
+/// to the "matrix_bytes" counter of the active profile
+template<typename T>
+class ProfiledAllocator : public std::allocator<T>
+{
+public:
+  typedef T value_type;
+  template<typename U> struct rebind { typedef ProfiledAllocator<U> other; };
+  ProfiledAllocator() { }
+  template<typename U> ProfiledAllocator(const ProfiledAllocator<U>&) { }
+  T* allocate(std::size_t n)
+  {
+    profile_count("matrix_bytes", n*sizeof(T));
+    return std::allocator<T>::allocate(n);
+  }
+};
+
+template<typename T, typename U>
+bool operator==(const ProfiledAllocator<T>&, const ProfiledAllocator<U>&)
+{ return true; }
+template<typename T, typename U>
+bool operator!=(const ProfiledAllocator<T>&, const ProfiledAllocator<U>&)
+{ return false; }
+
+} // namespace surfpack
+
+#endif
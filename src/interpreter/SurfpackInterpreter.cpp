@@ -133,11 +133,12 @@ void SurfpackInterpreter::execLoad(ParamMap& args)
     execLoadSurface(args);
   } else if (surfpack::hasExtension(filename,".spd") ||
 	     surfpack::hasExtension(filename,".bspd") ||
+	     surfpack::hasExtension(filename,".cbspd") ||
 	     surfpack::hasExtension(filename,".dat")) {
     execLoadData(args);
   } else {
     throw string("Expected file extension: .sps/.bsps (surface) or " 
-		 ".spd/.bspd/.dat (data)");
+		 ".spd/.bspd/.cbspd/.dat (data)");
   }
 }
 
@@ -271,6 +272,12 @@ void SurfpackInterpreter::execCreateSurface(ParamMap& args)
   SurfpackModel* model = smf->Build(*sd);
   delete smf;
   assert(model);
+  // profile = 1 prints where the time of the build went
+  int profile = asInt(args["profile"],valid);
+  if (valid && profile) {
+    cout << "Build profile for " << name << ":\n"
+	 << model->buildProfile().asString();
+  }
   symbolTable.modelVars.insert(SurfpackModelSymbol(name,model));
 }
 
@@ -336,12 +343,19 @@ void SurfpackInterpreter::execFitness(ParamMap& args)
   int response_index = asInt(args["response_index"],valid_response_index);
   bool valid_n;
   int n = asInt(args["n"],valid_n);
+  // Threads for the cv and press rebuilds; 0 (default) for the library default
+  bool valid_num_threads;
+  int num_threads = asInt(args["num_threads"],valid_num_threads);
   if (!valid_response_index) { // No response_index was specified, use 0
     response_index = 0;
   }
+  if (!valid_num_threads || num_threads < 0) {
+    num_threads = 0;
+  }
   double fitness;
   if (valid_data) {
-    fitness = SurfpackInterface::Fitness(model,sd,metric,response_index,n);
+    fitness = SurfpackInterface::Fitness(model,sd,metric,response_index,n,
+					 num_threads);
   } else {
     fitness = SurfpackInterface::Fitness(model,metric,response_index,n); 
   }
@@ -31,6 +31,48 @@ double DirectANNBasisSet::nodeSum(unsigned index, const VecDbl& x) const
   return sum;
 }
 
+void DirectANNBasisSet::nodeSums(const VecDbl& x, VecDbl& sums) const
+{
+  unsigned nodes = weights.getNRows();
+  assert(x.size() + 1 == weights.getNCols());
+  sums.assign(nodes, 0.0);
+  if (nodes == 0) return;
+  // same order of operations as nodeSum, with the bias weight last
+  for (unsigned i = 0; i < x.size(); i++) {
+    const double* column = &weights(0,i);
+    for (unsigned n = 0; n < nodes; n++) sums[n] += column[n]*x[i];
+  }
+  const double* bias = &weights(0,x.size());
+  for (unsigned n = 0; n < nodes; n++) sums[n] += bias[n];
+}
+
+void DirectANNBasisSet::evalBatch(const MtxDbl& xs, MtxDbl& hidden) const
+{
+  unsigned npts = xs.getNRows();
+  unsigned nvars = xs.getNCols();
+  unsigned nodes = weights.getNRows();
+  assert(nvars + 1 == weights.getNCols());
+  // augment the points with a column of ones to pick up the bias weights
+  MtxDbl xs_aug(npts, nvars + 1);
+  for (unsigned j = 0; j < nvars; j++) {
+    for (unsigned i = 0; i < npts; i++) {
+      xs_aug(i,j) = xs(i,j);
+    }
+  }
+  for (unsigned i = 0; i < npts; i++) {
+    xs_aug(i,nvars) = 1.0;
+  }
+  // hidden = tanh([ x | 1 ] * [ A0 | theta0 ]^T), (points x nodes);
+  // matrixMatrixMult does not modify its operands
+  surfpack::matrixMatrixMult(hidden, xs_aug, 
+			     const_cast<MtxDbl&>(weights), 'N', 'T');
+  if (npts*nodes == 0) return;
+  double* h = &hidden(0,0);
+  for (unsigned k = 0; k < npts*nodes; k++) {
+    h[k] = tanh(h[k]);
+  }
+}
+
 double DirectANNBasisSet::eval(unsigned index, const VecDbl& x) const
 {
   //printf("sum: %f tanh thereof: %f\n",nodeSum(index,x),tanh(nodeSum(index,x)));
@@ -52,51 +94,104 @@ std::string DirectANNBasisSet::asString() const
 }
 
 DirectANNModel::DirectANNModel(const DirectANNBasisSet& bs_in, const VecDbl& coeffs_in)
-  : SurfpackModel(bs_in.weights.getNCols()), bs(bs_in), coeffs(coeffs_in)
+  : SurfpackModel(bs_in.weights.getNCols() - 1), bs(bs_in), coeffs(coeffs_in)
 {
   assert(bs.weights.getNRows()+1 == coeffs.size());
 }
 
 double DirectANNModel::evaluate(const VecDbl& x) const
 {
-  assert(coeffs.size() == bs.weights.getNRows() + 1);
+  unsigned nodes = bs.weights.getNRows();
+  assert(coeffs.size() == nodes + 1);
+  VecDbl sums;
+  bs.nodeSums(x, sums);
   double sum = 0;
-  //cout << "-----> x: ";
-  //copy(x.begin(),x.end(),std::ostream_iterator<double>(cout," "));
-  //cout << "\n";
-  for (unsigned i = 0; i < bs.weights.getNRows(); i++) {
-    //printf("  i: %d coeff: %f node: %f\n",i,coeffs[i],bs.eval(i,x));
-    sum += coeffs[i]*bs.eval(i,x);
+  for (unsigned i = 0; i < nodes; i++) {
+    sum += coeffs[i]*tanh(sums[i]);
   }
   sum += coeffs.back(); // bias weight 
-  //printf("  sum: %f bias: %f tanh: %f\n",sum,coeffs.back(),tanh(sum));
   return tanh(sum);
 }
 
+void DirectANNModel::evaluateBatch(const MtxDbl& xs, VecDbl& ys) const
+{
+  unsigned npts = xs.getNRows();
+  assert(coeffs.size() == bs.weights.getNRows() + 1);
+  MtxDbl hidden;
+  bs.evalBatch(xs, hidden);
+  VecDbl node_coeffs(coeffs.begin(), coeffs.end() - 1);
+  surfpack::matrixVectorMult(ys, hidden, node_coeffs);
+  for (unsigned i = 0; i < npts; i++) {
+    ys[i] = tanh(ys[i] + coeffs.back()); // bias weight
+  }
+}
+
+/** The activations are computed once and reused for every variable;
+    each component is then a dot product with a contiguous column of
+    the weights */
 VecDbl DirectANNModel::gradient(const VecDbl& x) const
 {
   assert(!x.empty());
   assert(x.size() + 1 == bs.weights.getNCols());
-  VecUns diff_var(1,0); // variable with which to differentiate
-  VecDbl nodeSums(bs.weights.getNRows());
+  unsigned nodes = bs.weights.getNRows();
+  VecDbl nodeSums;
+  bs.nodeSums(x, nodeSums);
   double finalSum=0.0; // the unsigmoided value of the output node
-  for (unsigned r = 0; r < bs.weights.getNRows(); r++) {
-    nodeSums[r] = bs.nodeSum(r,x);
-    finalSum += coeffs[r]*tanh(nodeSums[r]);
+  // overwrite the node sums with the derivative of each node's
+  // contribution to finalSum with respect to its sum
+  for (unsigned r = 0; r < nodes; r++) {
+    double tanhNodeSum = tanh(nodeSums[r]);
+    finalSum += coeffs[r]*tanhNodeSum;
+    nodeSums[r] = coeffs[r]*(1-tanhNodeSum*tanhNodeSum);
   }
-  double tanhsum = tanh(finalSum+coeffs[bs.weights.getNRows()]);
+  double tanhsum = tanh(finalSum+coeffs[nodes]);
   double finalSumMultiplier = 1 - tanhsum*tanhsum;
   VecDbl result(x.size(),0.0);
-  for (unsigned v = 0; v < x.size(); v++) {
-    for (unsigned i = 0; i < bs.weights.getNRows(); i++) {
-      double tanhNodeSum = tanh(nodeSums[i]);
-      result[v] += coeffs[i]*(1-tanhNodeSum*tanhNodeSum)*bs.weights(i,v);
+  for (unsigned v = 0; v < x.size() && nodes > 0; v++) {
+    const double* column = &bs.weights(0,v);
+    for (unsigned i = 0; i < nodes; i++) {
+      result[v] += nodeSums[i]*column[i];
     }
     result[v] *= finalSumMultiplier;
   }
   return result;
 }
 
+/** With H the hidden layer (points x nodes) and y the outputs,
+    grads = diag(1 - y.^2) * (H' .* c) * A0, where H'(i,n) = 1 -
+    H(i,n)^2 */
+void DirectANNModel::gradientBatch(const MtxDbl& xs, MtxDbl& grads) const
+{
+  unsigned npts = xs.getNRows();
+  unsigned nvars = xs.getNCols();
+  unsigned nodes = bs.weights.getNRows();
+  assert(coeffs.size() == nodes + 1);
+  MtxDbl hidden;
+  bs.evalBatch(xs, hidden);
+  VecDbl node_coeffs(coeffs.begin(), coeffs.end() - 1);
+  VecDbl ys;
+  surfpack::matrixVectorMult(ys, hidden, node_coeffs);
+  for (unsigned n = 0; n < nodes; n++) {
+    for (unsigned i = 0; i < npts; i++) {
+      hidden(i,n) = coeffs[n]*(1 - hidden(i,n)*hidden(i,n));
+    }
+  }
+  // the product with the bias column of the weights is discarded
+  MtxDbl grads_aug;
+  surfpack::matrixMatrixMult(grads_aug, hidden, 
+			     const_cast<MtxDbl&>(bs.weights));
+  grads.reshape(npts, nvars);
+  for (unsigned i = 0; i < npts; i++) {
+    double tanhsum = tanh(ys[i] + coeffs.back());
+    ys[i] = 1 - tanhsum*tanhsum;
+  }
+  for (unsigned v = 0; v < nvars; v++) {
+    for (unsigned i = 0; i < npts; i++) {
+      grads(i,v) = grads_aug(i,v)*ys[i];
+    }
+  }
+}
+
 std::string DirectANNModel::asString() const
 {
   std::ostringstream os;
@@ -105,11 +200,17 @@ std::string DirectANNModel::asString() const
   // Variable scaling must be incorporated into bs.weights to 
   // print out the correct A0 and theta0.
   
-  // Get scale factors
-  VecDbl varB = dynamic_cast<NormalizingScaler *>(mScaler)->getScalerOffsets();
-  VecDbl varM = dynamic_cast<NormalizingScaler *>(mScaler)->getScalerScaleFactors();
-  double respB = dynamic_cast<NormalizingScaler *>(mScaler)->getDescalerOffset();
-  double respM = dynamic_cast<NormalizingScaler *>(mScaler)->getDescalerScaleFactor();
+  // Get scale factors (identity for a model built without a factory,
+  // which keeps the default NonScaler)
+  VecDbl varB(num_vars, 0.0), varM(num_vars, 1.0);
+  double respB = 0.0, respM = 1.0;
+  NormalizingScaler* ns = dynamic_cast<NormalizingScaler *>(mScaler);
+  if (ns) {
+    varB = ns->getScalerOffsets();
+    varM = ns->getScalerScaleFactors();
+    respB = ns->getDescalerOffset();
+    respM = ns->getDescalerScaleFactor();
+  }
 
   // Create a deep copy of bs.weights, chop off the last column using a 
   // "feature" of its resize function, and divide its elements by m.
@@ -229,9 +330,11 @@ SurfpackModel* DirectANNModelFactory::Create(const SurfData& sd)
   // Solve linear system to compute weights for second layer
   MtxDbl A(ssd.size(),nodes+1,true);
   VecDbl b(ssd.size(),0.0);
+  VecDbl sums;
   for (unsigned samp = 0; samp < ssd.size(); samp++) {
+    bs.nodeSums(ssd(samp), sums);
     for (unsigned n = 0; n < nodes; n++) { 
-      A(samp,n) = bs.eval(n,ssd(samp));
+      A(samp,n) = tanh(sums[n]);
       //cout << "A(" << samp << "," << n << "): " << A(samp,n) << endl;
     }
     A(samp,nodes) = 1.0; // for hidden layer bias
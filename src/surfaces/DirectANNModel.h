@@ -38,6 +38,14 @@ public:
   /// compute the contribution due to the index-th basis function at the point x
   double nodeSum(unsigned index, const VecDbl& x) const;
 
+  /// compute the contributions of all basis functions at the point x,
+  /// accumulating one (contiguous) column of weights at a time
+  void nodeSums(const VecDbl& x, VecDbl& sums) const;
+
+  /// evaluate all basis functions at each row of xs, (points x nodes),
+  /// with a single matrix-matrix multiply
+  void evalBatch(const MtxDbl& xs, MtxDbl& hidden) const;
+
   /// write the basis set as a string
   std::string asString() const;
 
@@ -64,6 +72,7 @@ public:
 
   DirectANNModel(const DirectANNBasisSet& bs_in, const VecDbl& coeffs_in);
   virtual VecDbl gradient(const VecDbl& x) const;
+  using SurfpackModel::gradient;
   virtual std::string asString() const;
 
 protected:
@@ -74,6 +83,14 @@ protected:
   /// evaluate the model at the point x
   virtual double evaluate(const VecDbl& x) const;
 
+  /// evaluate the model at each row of xs; the hidden layer for all
+  /// points is formed with a single matrix-matrix multiply
+  virtual void evaluateBatch(const MtxDbl& xs, VecDbl& ys) const;
+
+  /// gradients at each row of xs from the batch hidden layer, reduced
+  /// to the inputs with a second matrix-matrix multiply
+  virtual void gradientBatch(const MtxDbl& xs, MtxDbl& grads) const;
+
   /// basis set mapping the input layer to the hidden layer
   DirectANNBasisSet bs;
 
@@ -165,6 +182,9 @@ void DirectANNModel::serialize(Archive & archive,
   archive & boost::serialization::base_object<SurfpackModel>(*this);
   archive & bs;
   archive & coeffs;
+  // archives written by older versions counted the bias column in ndims
+  if (Archive::is_loading::value)
+    ndims = bs.weights.getNCols() - 1;
 }
 
 #endif
@@ -41,14 +41,17 @@ surfdata_to_nkm_surfdata(const SurfData& sd, nkm::SurfData& nkm_sd)
   nkm::MtxInt der_order(f_size,1); 
   der_order.zero(); //set contents to zero
 
+  // read the columnar views of sd; per point, the x block is a column
+  // of XR and the gradient and Hessian blocks hold f_active's data
+  unsigned grad_size = sd.fGradientsSize();
+  unsigned hess_size = sd.fHessiansSize();
   if(num_points>0) {
     //could increment der_order independently for each dimension but old surfdata/surfpoint does not support this, nkm::SurfData supports arbitrarily high order derivatives.
 
-    const SurfPoint& point=sd[0];
-    if(point.fGradientsSize() > 0) {
+    if(grad_size > 0) {
       for(unsigned f_index=0; f_index<f_size; ++f_index)
 	++der_order(f_index,0);
-      if(point.fHessiansSize() > 0)
+      if(hess_size > 0)
 	for(unsigned f_index=0; f_index<f_size; ++f_index)
 	  ++der_order(f_index,0);
     }
@@ -60,33 +63,23 @@ surfdata_to_nkm_surfdata(const SurfData& sd, nkm::SurfData& nkm_sd)
     }
   }
 
-
   for (unsigned point_index=0; point_index<num_points; ++point_index) {
-    const SurfPoint& point = sd[point_index];
-    const VecDbl x = point.X();
+    unsigned p = sd.physicalIndex(point_index);
+    const double* x = sd.xData() + p*x_size;
     for (unsigned x_index=0; x_index<x_size; ++x_index)
       XR(x_index,point_index) = x[x_index];
     for (unsigned f_index=0; f_index<f_size; ++f_index) 
-      Y(f_index,point_index) = point.F(f_active);
-
-
-    // given NKM ordering of derY, probably need to loop differently
-    // to populate the matrices; this just for demo
+      Y(f_index,point_index) = sd.fData()[p*sd.fSize() + f_active];
 
-    // example of mapping first derivatives
     // there should be 0 or f_size gradients (could throw error)
-    if (point.fGradientsSize() > 0) {
+    if (grad_size > 0) {
+      const double* sd_gradient = 
+	sd.gradientData() + (p*grad_size + f_active)*x_size;
       for (unsigned f_index=0; f_index < f_size; ++f_index) {
 	assert(der_order(f_index,0)>=1);  //could change this to a throw
-	const vector<double>& sd_gradient = point.fGradient(f_active);
-	//cout << "Surfpack gradient for point " << point_index << ", function "
-	//     << f_index << ": [ ";
 	for (unsigned x_index=0; x_index < x_size; ++x_index) {
-	  // accessing each gradient element
-	  //cout << sd_gradient[x_index] << " ";
 	  derY[f_index][1](x_index,point_index) =sd_gradient[x_index];
 	}
-	//cout << "]" << endl;
       }
     }
     else{
@@ -94,29 +87,18 @@ surfdata_to_nkm_surfdata(const SurfData& sd, nkm::SurfData& nkm_sd)
 	assert(der_order(f_index,0)==0);  //could change this to a throw
     }
 
-    // example of mapping second derivatives
-    // there should be 0 or f_size Hessians (could throw error)
-    if (point.fHessiansSize() > 0) {
+    // there should be 0 or f_size Hessians (could throw error); the
+    // upper triangle is taken row by row
+    if (hess_size > 0) {
+      const double* sd_hessian = 
+	sd.hessianData() + (p*hess_size + f_active)*x_size*x_size;
       for (unsigned f_index=0; f_index<f_size; ++f_index) {
 	assert(der_order(f_index,0)>=2);  //could change this to a throw
-
-	const SurfpackMatrix<double>& sd_hessian = point.fHessian(f_active);
-	//cout << "Surfpack Hessian for point " << point_index << ", function "
-	//     << f_index << " is:\n";
 	unsigned der_index=0;
 	for (unsigned xj_index=0; xj_index < x_size; ++xj_index) 
 	  for (unsigned xk_index=xj_index; xk_index < x_size; ++xk_index, ++der_index)
 	    derY[f_index][2](der_index,point_index)=
-	      sd_hessian(xj_index,xk_index);
-
-	//for (unsigned xj_index=0; xj_index < x_size; ++xj_index) {
-	//  for (unsigned xk_index=0; xk_index < x_size; ++xk_index) {
-	//    // accessing each Hessian element
-	//    cout << sd_hessian(xj_index, xk_index) << " ";
-	//  }
-	//  cout << "\n";
-	//}
-	//cout << endl;
+	      sd_hessian[xk_index*x_size + xj_index];
       }
     }
     else{
@@ -189,6 +171,24 @@ double KrigingModel::evaluate(const VecDbl& x) const
 }
 
 
+void KrigingModel::evaluateBatch(const MtxDbl& xs, VecDbl& ys) const
+{
+  int npts = xs.getNRows();
+  // nkm stores one point per column
+  nkm::MtxDbl nkm_x(ndims,npts);
+  for(int ipt=0; ipt<npts; ++ipt)
+    for(size_t i=0; i<ndims; ++i)
+      nkm_x(i,ipt) = xs(ipt,i);
+
+  nkm::MtxDbl nkm_y(1,npts);
+  nkmKrigingModel->evaluate(nkm_y, nkm_x);
+
+  ys.resize(npts);
+  for(int ipt=0; ipt<npts; ++ipt)
+    ys[ipt] = nkm_y(0,ipt);
+}
+
+
 double KrigingModel::variance(const VecDbl& x) const
 {
   nkm::MtxDbl nkm_x(ndims,1);
@@ -243,6 +243,76 @@ MtxDbl KrigingModel::hessian(const VecDbl& x) const
 }
 
 
+/** With the correlation lengths fixed, every leave-out model shares the
+    correlation matrix of one model fit on all of data, so refit once
+    and let nkm apply the Dubrule formula.  Otherwise the leave-out
+    models would each choose their own lengths and must be rebuilt. */
+bool KrigingModel::leaveoutEstimates(const SurfData& data,
+				     const VecVecUns& partitions,
+				     VecDbl& estimates) const
+{
+  ParamMap::const_iterator param_it = args.find("correlation_lengths");
+  if (param_it == args.end() || param_it->second.empty())
+    return false;
+  // user correlation lengths are only the initial iterate unless the
+  // optimization is switched off
+  param_it = args.find("optimization_method");
+  if (param_it == args.end() || param_it->second != "none")
+    return false;
+  if (data.size() == 0 || data[0].fGradientsSize() > 0)
+    return false;
+
+  ParamMap refit_args = args;
+  refit_args["verbosity"] =
+    surfpack::toString<short>(surfpack::SILENT_OUTPUT);
+  KrigingModel refit(data, refit_args);
+  return refit.nkmKrigingModel->leaveout_estimates(estimates, partitions);
+}
+
+
+/** DIRECT and CONMIN keep their state in Fortran static data for the
+    whole optimization (see nkm::OptimizationProblem), so concurrent
+    builds that use them would just queue for it.  Built one at a time,
+    each can evaluate its batches of trial correlation lengths on all
+    the threads. */
+bool KrigingModel::concurrentBuilds() const
+{
+  ParamMap::const_iterator param_it = args.find("optimization_method");
+  std::string method =
+    (param_it == args.end()) ? std::string("global") : param_it->second;
+  return !(method == "global" || method == "local" ||
+	   method == "global_local");
+}
+
+
+/** The nkm model extends its factorization by the new points; see
+    nkm::KrigingModel::update() */
+void KrigingModel::update(const SurfData& new_points)
+{
+  nkm::SurfData nkm_new_points;
+  surfdata_to_nkm_surfdata(new_points, nkm_new_points);
+  nkmKrigingModel->update(nkm_new_points);
+}
+
+
+void KrigingModel::makePredictionOnly()
+{
+  nkmKrigingModel->make_prediction_only();
+}
+
+
+std::size_t KrigingModel::memoryBytes() const
+{
+  return (nkmKrigingModel->memory_bytes());
+}
+
+
+std::string KrigingModel::memoryReport() const
+{
+  return (nkmKrigingModel->memory_report());
+}
+
+
 std::string KrigingModel::asString() const
 {
 
@@ -308,6 +378,22 @@ SurfpackModel* KrigingModelFactory::Create(const SurfData& sd)
   this->add("ndims",surfpack::toString(sd.xSize()));
   this->config();
 
-  return new KrigingModel(sd, params);
+  // when this thread draws from its own stream (e.g., a cross-validation
+  // fold), seed the nkm random guesses from it too, so the build is
+  // reproducible regardless of what other threads are doing
+  if (!surfpack::ThreadRngScope::active())
+    return new KrigingModel(sd, params);
+
+  nkm::nkm_rand_seed_thread(surfpack::shared_rng().mtrand());
+  SurfpackModel* model = NULL;
+  try {
+    model = new KrigingModel(sd, params);
+  }
+  catch (...) {
+    nkm::nkm_rand_clear_thread();
+    throw;
+  }
+  nkm::nkm_rand_clear_thread();
+  return model;
 
 }
@@ -25,14 +25,38 @@ public:
   KrigingModel(const SurfData& sd, const ParamMap& args);
   ~KrigingModel();
   virtual double variance(const VecDbl& x) const;
+  using SurfpackModel::variance;
   virtual VecDbl gradient(const VecDbl& x) const;
+  using SurfpackModel::gradient;
   virtual MtxDbl hessian(const VecDbl& x) const;
   virtual std::string asString() const;
+  /// leave-out estimates by the Dubrule formula, available when the
+  /// correlation lengths are fixed by the parameters (optimization_method
+  /// none)
+  virtual bool leaveoutEstimates(const SurfData& data,
+				 const VecVecUns& partitions,
+				 VecDbl& estimates) const;
+  /// false when the correlation lengths are optimized by DIRECT or
+  /// CONMIN (optimization_method global, local, or global_local, the
+  /// default being global), which run one at a time per process
+  virtual bool concurrentBuilds() const;
+  /// add the points in new_points, which must hold the response the
+  /// model was built on as their default response, without reoptimizing
+  /// the correlation lengths (but see the reoptimize_every parameter)
+  void update(const SurfData& new_points);
+  /// drop the matrices only the variance needs (see the prediction_only
+  /// parameter); they are recomputed on the first variance request
+  void makePredictionOnly();
+  /// bytes held by the wrapped model, in total and by matrix
+  std::size_t memoryBytes() const;
+  std::string memoryReport() const;
 
 protected:
 
   MtxDbl getMatrix(const ScaledSurfData& ssd, const VecDbl& correlations);
   virtual double evaluate(const VecDbl& x) const;
+  /// evaluate all rows of xs with one call to the nkm matrix evaluator
+  virtual void evaluateBatch(const MtxDbl& xs, VecDbl& ys) const;
 
 friend class KrigingModelTest;
 
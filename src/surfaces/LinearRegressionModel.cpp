@@ -28,37 +28,148 @@ double LRMBasisSet::eval(unsigned index, const VecDbl& x) const
   return result;
 }
 
+/** Differentiating x[v]^c m times gives c*(c-1)*...*(c-m+1)*x[v]^(c-m);
+    counts are taken by scanning the (short) lists, so nothing is
+    allocated */
 double LRMBasisSet::deriv(unsigned index, const VecDbl& x, const VecUns& vars) const
 {
-  VecUns counts(x.size(),0);
-  for(VecUnsIt it = bases[index].begin(); it != bases[index].end(); ++it) {
-    assert(*it < x.size());
-    counts[*it]++;
-  } 
+  const VecUns& basis = bases[index];
   double coeff = 1.0;
-  for(VecUns::const_iterator it = vars.begin(); it != vars.end(); ++it) {
-    assert(*it < x.size());
-    unsigned index = *it;
+  for (unsigned a = 0; a < vars.size(); a++) {
+    assert(vars[a] < x.size());
+    if (std::find(vars.begin(), vars.begin() + a, vars[a]) != 
+	vars.begin() + a) continue; // already accounted for
+    unsigned m = std::count(vars.begin(), vars.end(), vars[a]);
+    unsigned c = std::count(basis.begin(), basis.end(), vars[a]);
     // Taken derivative with respect to this variable too many times
-    if (!counts[index]) return 0.0; 
-    coeff *= counts[index]--;
+    if (m > c) return 0.0;
+    for (unsigned k = 0; k < m; k++) coeff *= c - k;
   }
-  unsigned sum = accumulate(counts.begin(),counts.end(),0);
-  if (sum == 0) return coeff; // no vars left
+  // the remaining factors, in ascending order of variable
   double term = 1.0;
-  for(unsigned v = 0; v < counts.size(); v++) {
-    for (unsigned c = 0; c < counts[v]; c++) {
-      term *= x[v];
+  bool first = true;
+  unsigned prev = 0;
+  while (true) {
+    bool found = false;
+    unsigned v = 0;
+    for (VecUnsIt it = basis.begin(); it != basis.end(); ++it) {
+      assert(*it < x.size());
+      if ((first || *it > prev) && (!found || *it < v)) {
+	v = *it;
+	found = true;
+      }
     }
+    if (!found) break;
+    unsigned c = std::count(basis.begin(), basis.end(), v) - 
+      std::count(vars.begin(), vars.end(), v);
+    for (unsigned k = 0; k < c; k++) term *= x[v];
+    first = false;
+    prev = v;
   }
-  //cout << "Deriv: " << index << " X: ";
-  //copy(x.begin(),x.end(),std::ostream_iterator<double>(cout," "));
-  //cout << " Vars: " ;
-  //copy(vars.begin(),vars.end(),std::ostream_iterator<double>(cout," "));
-  //cout << " Val: " << coeff*term << endl;
   return coeff*term;
 }
 
+void LRMBasisSet::compile()
+{
+  nodeParent.assign(1, 0);
+  nodeVar.assign(1, 0);
+  basisNode.resize(bases.size());
+  std::map<VecUns, unsigned> prefix_node;
+  VecUns prefix;
+  for (unsigned i = 0; i < bases.size(); i++) {
+    unsigned node = 0;
+    prefix.clear();
+    for (VecUnsIt it = bases[i].begin(); it != bases[i].end(); ++it) {
+      prefix.push_back(*it);
+      std::map<VecUns, unsigned>::const_iterator found = 
+	prefix_node.find(prefix);
+      if (found != prefix_node.end()) {
+	node = found->second;
+      } else {
+	nodeParent.push_back(node);
+	nodeVar.push_back(*it);
+	node = nodeParent.size() - 1;
+	prefix_node[prefix] = node;
+      }
+    }
+    basisNode[i] = node;
+  }
+}
+
+void LRMBasisSet::evalNodes(const VecDbl& x, VecDbl& work) const
+{
+  unsigned nnodes = nodeParent.size();
+  work.resize(nnodes);
+  work[0] = 1.0;
+  for (unsigned n = 1; n < nnodes; n++) {
+    assert(nodeVar[n] < x.size());
+    work[n] = work[nodeParent[n]]*x[nodeVar[n]];
+  }
+}
+
+VecDbl& LRMBasisSet::threadWork()
+{
+  static thread_local VecDbl work;
+  return work;
+}
+
+void LRMBasisSet::evalAll(const VecDbl& x, VecDbl& values) const
+{
+  values.resize(bases.size());
+  if (!compiled()) {
+    for (unsigned i = 0; i < bases.size(); i++) values[i] = eval(i,x);
+    return;
+  }
+  VecDbl& work = threadWork();
+  evalNodes(x, work);
+  for (unsigned i = 0; i < bases.size(); i++) values[i] = work[basisNode[i]];
+}
+
+double LRMBasisSet::evalSum(const VecDbl& x, const VecDbl& coeffs) const
+{
+  assert(coeffs.size() == bases.size());
+  double sum = 0.0;
+  if (!compiled()) {
+    for (unsigned i = 0; i < bases.size(); i++) sum += coeffs[i]*eval(i,x);
+    return sum;
+  }
+  VecDbl& work = threadWork();
+  evalNodes(x, work);
+  for (unsigned i = 0; i < bases.size(); i++) 
+    sum += coeffs[i]*work[basisNode[i]];
+  return sum;
+}
+
+void LRMBasisSet::gradientSum(const VecDbl& x, const VecDbl& coeffs, 
+			      VecDbl& grad) const
+{
+  assert(coeffs.size() == bases.size());
+  grad.assign(x.size(), 0.0);
+  if (!compiled()) {
+    VecUns diff_var(1,0); // variable with which to differentiate
+    for (unsigned i = 0; i < x.size(); i++) {
+      diff_var[0] = i;
+      for (unsigned j = 0; j < bases.size(); j++) {
+	grad[i] += coeffs[j]*deriv(j,x,diff_var);
+      }
+    }
+    return;
+  }
+  // node values in the first half of work, their adjoints in the second
+  unsigned nnodes = nodeParent.size();
+  VecDbl& work = threadWork();
+  evalNodes(x, work);
+  work.resize(2*nnodes);
+  double* adjoint = &work[nnodes];
+  std::fill(adjoint, adjoint + nnodes, 0.0);
+  for (unsigned i = 0; i < bases.size(); i++) 
+    adjoint[basisNode[i]] += coeffs[i];
+  for (unsigned n = nnodes - 1; n > 0; n--) {
+    grad[nodeVar[n]] += adjoint[n]*work[nodeParent[n]];
+    adjoint[nodeParent[n]] += adjoint[n]*x[nodeVar[n]];
+  }
+}
+
 std::string LRMBasisSet::asString() const
 {
   std::ostringstream os;
@@ -73,59 +184,157 @@ std::string LRMBasisSet::asString() const
 void LRMBasisSet::add(const std::string& s_basis)
 {
   bases.push_back(surfpack::toVec<unsigned>(s_basis));
+  compile();
+}
+
+void LRMBasisSet::add(const VecUns& vars)
+{
+  bases.push_back(vars);
 }
 
 LinearRegressionModel::LinearRegressionModel(const unsigned dims, 
   const LRMBasisSet& bs_in, const VecDbl& coeffs_in, const MtxDbl& Xtmp)
-  : SurfpackModel(dims), bs(bs_in), coeffs(coeffs_in), Xbasis(Xtmp)
+  : SurfpackModel(dims), bs(bs_in), coeffs(coeffs_in)
 {
-  assert(bs.bases.size() == coeffs.size());
+  assert(bs.size() == coeffs.size());
+  unsigned nbases = bs.size();
+  assert(Xtmp.getNCols() == nbases);
+  // a constrained fit may have fewer points than bases, leaving no
+  // square factor
+  if (Xtmp.getNRows() < nbases) return;
+  packedR.reserve(nbases*(nbases+1)/2);
+  for (unsigned j = 0; j < nbases; j++) {
+    for (unsigned i = 0; i <= j; i++) {
+      packedR.push_back(Xtmp(i,j));
+    }
+  }
 }
 
 double LinearRegressionModel::evaluate(const VecDbl& x) const
 {
-  static int times_called = 0;
-  assert(coeffs.size() == bs.bases.size());
-  double sum = 0;
-  for (unsigned i = 0; i < coeffs.size(); i++) {
-    sum += coeffs[i]*bs.eval(i,x);
+  assert(coeffs.size() == bs.size());
+  return bs.evalSum(x,coeffs);
+}
+
+/** Form the (points x bases) basis matrix one basis (column) at a
+    time, then apply the coefficients to all points with a single
+    matrix-vector multiply */
+void LinearRegressionModel::evaluateBatch(const MtxDbl& xs, VecDbl& ys) const
+{
+  assert(coeffs.size() == bs.size());
+  MtxDbl basis;
+  basisMatrix(xs, basis);
+  // matrixVectorMult does not modify the vector operand
+  surfpack::matrixVectorMult(ys, basis, const_cast<VecDbl&>(coeffs));
+}
+
+void LinearRegressionModel::basisMatrix(const MtxDbl& xs, MtxDbl& basis) const
+{
+  unsigned npts = xs.getNRows();
+  basis.reshape(npts, bs.size());
+  for (unsigned b = 0; b < bs.size(); b++) {
+    for (unsigned i = 0; i < npts; i++) {
+      basis(i,b) = 1.0;
+    }
+    for (VecUnsIt it = bs.getBases()[b].begin();
+	 it != bs.getBases()[b].end(); ++it) {
+      assert(*it < xs.getNCols());
+      for (unsigned i = 0; i < npts; i++) {
+	basis(i,b) *= xs(i,*it);
+      }
+    }
   }
-  //cout << "LinearRegression: times called: " << ++times_called << endl;
-  return sum;
 }
 
+/** The rebuilt models share this basis, so their predictions follow
+    from the least squares hat matrix; equality constraints are not
+    accounted for, so leave those to the rebuilds */
+bool LinearRegressionModel::leaveoutEstimates(const SurfData& data,
+					      const VecVecUns& partitions,
+					      VecDbl& estimates) const
+{
+  if (data.numConstraints() > 0) return false;
+  MtxDbl A(data.size(), bs.size());
+  VecDbl scaled_x, values;
+  for (unsigned i = 0; i < data.size(); i++) {
+    bs.evalAll(mScaler->scale(data(i), scaled_x), values);
+    for (unsigned j = 0; j < bs.size(); j++) {
+      A(i,j) = values[j];
+    }
+  }
+  return surfpack::leastSquaresLeaveout(A, data.getResponses(), partitions,
+					estimates);
+}
+
+/** var = MSE(1 + x'inv(R'R)x) = MSE(1 + z'z), where R'z = x holds the
+    basis values at the point */
 double LinearRegressionModel::variance(const VecDbl& x) const
 {
-  VecDbl xnew(bs.size());
-  //for (unsigned i = 0; i < x.size(); i++)  //assuming x is scalar
-  for (unsigned j = 0; j < bs.size(); j++) 
-    xnew[j] = bs.eval(j,x);
+  if (packedR.empty()) 
+    throw std::string("This polynomial model has no least squares "
+		      "factor for variance eval (fewer points than bases, "
+		      "or read from an older model file)");
+  VecDbl z;
+  bs.evalAll(x, z);
+  surfpack::packedTriangularSolve(packedR, z, 'U', 'T');
+  return meanSquaredError*(1+surfpack::dot_product(z, z));
+}
 
-  // var = MSE(1 + x_new'inv(Xbasis'Xbasis)x_new)
-  VecDbl x_tmp(xnew);
-  VecDbl x_tmp1 = surfpack::inverseAfterQRFact(Xbasis, x_tmp, 'U', 'T'); 
-  		  //inv(Xbasis')*x_new
-  VecDbl x_tmp2 = surfpack::inverseAfterQRFact(Xbasis, x_tmp1, 'U', 'N'); 
-                  //inv(Xbasis)*tmp1
-  // matmult = x_new'inv(Xbasis'Xbasis)x_new
-  double matmult = surfpack::dot_product(xnew, x_tmp2); 
-  double var = meanSquaredError*(1+matmult);
-  return var;
+/** The basis matrix X for the block (points x bases) holds x' in each
+    row, so Z = X inv(R) holds the z' of each point, found by one
+    triangular solve with the unpacked R */
+void LinearRegressionModel::varianceBatch(const MtxDbl& xs, 
+					  VecDbl& vars) const
+{
+  if (packedR.empty()) 
+    throw std::string("This polynomial model has no least squares "
+		      "factor for variance eval (fewer points than bases, "
+		      "or read from an older model file)");
+  unsigned nbases = bs.size();
+  MtxDbl R;
+  unpackR(R);
+  MtxDbl Z;
+  basisMatrix(xs, Z);
+  surfpack::triangularSolve(R, Z, 'R', 'U');
+  unsigned npts = xs.getNRows();
+  vars.assign(npts, 0.0);
+  for (unsigned b = 0; b < nbases; b++) {
+    for (unsigned i = 0; i < npts; i++) {
+      vars[i] += Z(i,b)*Z(i,b);
+    }
+  }
+  for (unsigned i = 0; i < npts; i++) {
+    vars[i] = meanSquaredError*(1+vars[i]);
+  }
+}
+
+void LinearRegressionModel::unpackR(MtxDbl& R) const
+{
+  unsigned nbases = bs.size();
+  R = MtxDbl(nbases, nbases);
+  VecDbl::const_iterator packed = packedR.begin();
+  for (unsigned j = 0; j < nbases; j++) {
+    for (unsigned i = 0; i <= j; i++) {
+      R(i,j) = *packed++;
+    }
+  }
+}
+
+MtxDbl LinearRegressionModel::Xbasis() const
+{
+  if (packedR.empty()) return MtxDbl(0, 0);
+  MtxDbl R;
+  unpackR(R);
+  return R;
 }
 
 VecDbl LinearRegressionModel::gradient(const VecDbl& x) const
 {
   assert(!x.empty());
   //cout << "IN gradient x[0] = " << x[0] << endl;
-  assert(coeffs.size() == bs.bases.size());
-  VecUns diff_var(1,0); // variable with which to differentiate
-  VecDbl result(x.size(),0.0);
-  for (unsigned i = 0; i < x.size(); i++) {
-    diff_var[0] = i;
-    for (unsigned j = 0; j < bs.bases.size(); j++) {
-      result[i] += coeffs[j]*bs.deriv(j,x,diff_var);
-    }
-  }
+  assert(coeffs.size() == bs.size());
+  VecDbl result;
+  bs.gradientSum(x,coeffs,result);
   return result;
 }
 
@@ -145,7 +354,8 @@ std::string LinearRegressionModel::asString() const
     os << std::setw(23) << coeffs[i] << " ";
   os << "\n\np (bases x inputs) = \n";
   os << std::fixed << std::setprecision(0);
-  for(VecVecUns::const_iterator it = bs.bases.begin(); it != bs.bases.end(); ++it) {
+  for(VecVecUns::const_iterator it = bs.getBases().begin();
+      it != bs.getBases().end(); ++it) {
     for(unsigned i = 0; i < num_vars; i++)
        os << std::setw(3) << std::count(it->begin(), it->end(), i) << " ";
     os << "\n";
@@ -163,9 +373,11 @@ VecDbl LinearRegressionModelFactory::lrmSolve(const LRMBasisSet& bs, const Scale
 {
   //MtxDbl A(ssd.size(),bs.size(),true);
   A.resize(ssd.size(),bs.size());
+  VecDbl values;
   for (unsigned i = 0; i < ssd.size(); i++) {
+    bs.evalAll(ssd(i), values);
     for (unsigned j = 0; j < bs.size(); j++) {
-      A(i,j) = bs.eval(j,ssd(i));
+      A(i,j) = values[j];
     }
   }
   VecDbl b = ssd.getResponses();
@@ -193,16 +405,17 @@ LRMBasisSet LinearRegressionModelFactory::CreateLRM(unsigned order,
       Term new_term = Term(v);
       if (v.empty()) new_term.vars.push_back(0);
       else new_term.vars.push_back(v.back());
-      bs.bases.push_back(new_term.vars);
+      bs.add(new_term.vars);
       q.push_front(new_term);
     } else if (!v.empty() && v.back() < dims-1) {
       v.back()++;
-      bs.bases.push_back(v);
+      bs.add(v);
       t.color = false;
     } else {
       q.pop_front();
     }
   }
+  bs.compile();
   return bs;
 } 
 
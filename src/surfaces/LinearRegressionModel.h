@@ -15,19 +15,67 @@
 class SurfPoint;
 class ScaledSurfData;
 
+/** Polynomial basis; each basis function is the product of the
+    variables listed in its entry of bases (repeats for powers).  For
+    evaluation the bases are compiled into a product tree: node n is
+    node nodeParent[n] times x[nodeVar[n]] (node 0 is the constant 1),
+    with a node per distinct prefix of a basis, so bases sharing a prefix
+    share its product and all of them cost one multiply each. */
 class LRMBasisSet
 {
 public:
 
-  VecVecUns bases;
   double eval(unsigned index, const VecDbl& x) const;
   double deriv(unsigned index, const VecDbl& x, const VecUns& vars) const;
   std::string asString() const;
+  /// append the basis given as a list of variables and rebuild the
+  /// product tree
   void add(const std::string& s_basis);
+  /// append a basis (the product of x[v] for v in vars) without
+  /// rebuilding the tree; evaluation is direct until compile()
+  void add(const VecUns& vars);
   unsigned size() const { return bases.size();}
+  /// the bases, each the list of variables it multiplies
+  const VecVecUns& getBases() const { return bases; }
+
+  /// rebuild the product tree, e.g., after a run of add(const VecUns&)
+  /// (add(const std::string&) and CreateLRM keep it current)
+  void compile();
+
+  // The following evaluate the tree in per-thread scratch space, so they
+  // don't allocate once a thread has seen the largest tree
+
+  /// values of all bases at x
+  void evalAll(const VecDbl& x, VecDbl& values) const;
+
+  /// sum_i coeffs[i]*basis_i(x)
+  double evalSum(const VecDbl& x, const VecDbl& coeffs) const;
+
+  /// gradient of sum_i coeffs[i]*basis_i at x (by reverse accumulation
+  /// through the product tree)
+  void gradientSum(const VecDbl& x, const VecDbl& coeffs, VecDbl& grad) const;
 
 private:
 
+  /// whether the product tree describes the current bases; bases are
+  /// only ever appended, so the tree is current iff it covers them all
+  bool compiled() const { return basisNode.size() == bases.size(); }
+
+  /// forward pass setting work[n] to the value of node n
+  void evalNodes(const VecDbl& x, VecDbl& work) const;
+
+  /// the calling thread's scratch space
+  static VecDbl& threadWork();
+
+  /// each basis as the list of variables it multiplies; private so
+  /// the product tree can't go stale under an in-place edit
+  VecVecUns bases;
+  /// parent node and multiplying variable for each node
+  VecUns nodeParent;
+  VecUns nodeVar;
+  /// node holding each basis function
+  VecUns basisNode;
+
 #ifdef SURFPACK_HAVE_BOOST_SERIALIZATION
   // allow serializers access to private data
   friend class boost::serialization::access;
@@ -43,13 +91,24 @@ class LinearRegressionModel : public SurfpackModel
 {
 public:
 
-  /// standard constructor from a basis set
+  /// standard constructor from a basis set; the upper triangle of Xtmp
+  /// holds the R factor of the basis matrix (as left by the solve)
   LinearRegressionModel(const unsigned dims, const LRMBasisSet& bs_in, 
 			const VecDbl& coeffs_in, const MtxDbl& Xtmp);
   virtual VecDbl gradient(const VecDbl& x) const;
+  using SurfpackModel::gradient;
   virtual std::string asString() const;
   virtual double variance(const VecDbl& x) const;
-  MtxDbl Xbasis;
+  using SurfpackModel::variance;
+  /// \deprecated The R factor (bases x bases, zero below the diagonal)
+  /// that variance uses; it replaces the former public member Xbasis,
+  /// which held the whole (points x bases) factored basis matrix, with
+  /// R in its upper triangle.  Empty if the model has no factor.
+  MtxDbl Xbasis() const;
+  /// leave-out estimates from the hat matrix of the basis on data
+  virtual bool leaveoutEstimates(const SurfData& data,
+				 const VecVecUns& partitions,
+				 VecDbl& estimates) const;
 
 protected:
 
@@ -57,8 +116,22 @@ protected:
   LinearRegressionModel() { /* empty ctor */ }
 
   virtual double evaluate(const VecDbl& x) const;
+  /// evaluate all rows of xs via one basis matrix and a DGEMV
+  virtual void evaluateBatch(const MtxDbl& xs, VecDbl& ys) const;
+  /// variance at all rows of xs via one triangular solve (DTRSM)
+  virtual void varianceBatch(const MtxDbl& xs, VecDbl& vars) const;
+  /// basis matrix (points x bases) for the rows of xs
+  void basisMatrix(const MtxDbl& xs, MtxDbl& basis) const;
+  /// R (bases x bases) unpacked from packedR
+  void unpackR(MtxDbl& R) const;
   LRMBasisSet bs;
   VecDbl coeffs;
+  /// R factor (bases x bases, upper triangular, packed by columns) of
+  /// the QR factorization of the basis matrix at the build points;
+  /// x'inv(R'R)x is the variance term for a point with basis values x.
+  /// Empty (and variance unavailable) for a model fit to fewer points
+  /// than bases, or read from a file saved before it was archived
+  VecDbl packedR;
 
 friend class LinearRegressionModelTest;
 
@@ -134,10 +207,14 @@ private:
 
 #ifdef SURFPACK_HAVE_BOOST_SERIALIZATION
 
+#include <boost/serialization/version.hpp>
+
 template<class Archive> 
 void LRMBasisSet::serialize(Archive & archive, const unsigned int version)
 {
   archive & bases;
+  if (Archive::is_loading::value)
+    compile();
 }
 
 /** Serializer for the derived Model data, e.g., basis and coefficients.
@@ -150,8 +227,15 @@ void LinearRegressionModel::serialize(Archive & archive,
   archive & boost::serialization::base_object<SurfpackModel>(*this);
   archive & bs;
   archive & coeffs;
+  // version 1 adds the variance state; older files load without it
+  if (version > 0) {
+    archive & packedR;
+    archive & meanSquaredError;
+  }
 }
 
+BOOST_CLASS_VERSION(LinearRegressionModel, 1)
+
 
 #endif
 
@@ -20,6 +20,13 @@ extern "C" { // prevent C++ name mangling
 } // end extern "C"
 
 
+// MARS keeps working state in Fortran SAVE variables, so serialize
+// model construction; FMODM evaluation is free of such state.  Some of
+// that state (e.g., jas in marsgo) carries from one build to the next,
+// so the order of builds matters too (see MarsModel::concurrentBuilds)
+static std::mutex marsBuildMutex;
+
+
 using std::cout;
 using std::endl;
 using std::string;
@@ -41,27 +48,59 @@ MarsModel::MarsModel(const unsigned dims, real* fm_in, int fmsize, int* im_in,
   memcpy(&im[0],im_in,sizeof(int)*imsize);
 }
 
+/// FMODM operands for one block of points, kept per thread and grown
+/// to the largest block seen, so evaluation stops allocating once warm
+struct MarsScratch {
+  /// points, x(nval,nvars) in Fortran order
+  std::vector<real> x;
+  /// responses
+  std::vector<real> f;
+  /// sp(nval,2) workspace
+  std::vector<real> sp;
+};
+
+static MarsScratch& marsScratch(unsigned nval, unsigned nvars)
+{
+  static thread_local MarsScratch scratch;
+  if (scratch.x.size() < nval*nvars) scratch.x.resize(nval*nvars);
+  if (scratch.f.size() < nval) scratch.f.resize(nval);
+  if (scratch.sp.size() < 2*nval) scratch.sp.resize(2*nval);
+  // (BMA, 4/17/2007): The following explicit initializations added due to
+  // similar need with fm and im in build(...) below.  Conservative.
+  std::fill(scratch.f.begin(), scratch.f.begin() + nval, 0.0f);
+  std::fill(scratch.sp.begin(), scratch.sp.begin() + 2*nval, 0.0f);
+  return scratch;
+}
+
 double MarsModel::evaluate(const VecDbl& x) const
 {
   int nval = 1;
-  real* xVector = new real[static_cast<int>(x.size())];
-  for (int i = 0; i < static_cast<int>(x.size()); i++) {
-    xVector[i] = static_cast<real>(x[i]);
+  MarsScratch& scratch = marsScratch(nval, x.size());
+  for (unsigned i = 0; i < x.size(); i++) {
+    scratch.x[i] = static_cast<real>(x[i]);
   }
-  real* sp = new real[2];
-  real* f = new real[1];
-  // (BMA, 4/17/2007): The following explicit initializations added due to
-  // similar need with fm and im in build(...) below.  Conservative.
-  memset(sp, 0, 2*sizeof(real));
-  f[0] = 0;
   int continuity_level = interpolation;
-  FMODM_F77(continuity_level,nval,xVector,const_cast<real*>(&fm[0]),
-    const_cast<int*>(&im[0]),f,sp);
-  delete [] sp;
-  delete [] xVector;
-  real result = *f;
-  delete [] f;
-  return result;
+  FMODM_F77(continuity_level,nval,&scratch.x[0],const_cast<real*>(&fm[0]),
+    const_cast<int*>(&im[0]),&scratch.f[0],&scratch.sp[0]);
+  return scratch.f[0];
+}
+
+void MarsModel::evaluateBatch(const MtxDbl& xs, VecDbl& ys) const
+{
+  int nval = static_cast<int>(xs.getNRows());
+  int nvars = static_cast<int>(xs.getNCols());
+  ys.resize(nval);
+  if (nval == 0) return;
+  MarsScratch& scratch = marsScratch(nval, nvars);
+  // xs is column-major, so each column converts as one contiguous run
+  for (int j = 0; j < nvars; j++) {
+    const double* column = &xs(0,j);
+    std::copy(column, column + nval, scratch.x.begin() + j*nval);
+  }
+  int continuity_level = interpolation;
+  FMODM_F77(continuity_level,nval,&scratch.x[0],const_cast<real*>(&fm[0]),
+    const_cast<int*>(&im[0]),&scratch.f[0],&scratch.sp[0]);
+  std::copy(scratch.f.begin(), scratch.f.begin() + nval, ys.begin());
 }
 
 VecDbl MarsModel::gradient(const VecDbl& x) const
@@ -126,13 +165,15 @@ SurfpackModel* MarsModelFactory::Create(const SurfData& sd)
 
   //unsigned pts = data.size();
   //for (unsigned i = 0; i < pts; i++) {
+  const double* x_data = sd.xData();
+  const double* f_data = sd.fData();
+  unsigned f_active = sd.getDefaultIndex();
   for (int i = 0; i < n; i++) {
-    //cout << current->getF(responseIndex) << endl;
-    //const vector<double> domain = current.X();
+    unsigned p = sd.physicalIndex(i);
     for (int j = 0; j < np; j++) {
-      xMatrix[j*n+i] = static_cast<real>(sd(i,j)); 
+      xMatrix[j*n+i] = static_cast<real>(x_data[p*np + j]); 
     }
-    y[i] = static_cast<real>(sd.getResponse(i));
+    y[i] = static_cast<real>(f_data[p*sd.fSize() + f_active]);
     w[i] = 1.0f;
   } 
   // Specify each variable to be 'unrestricted'
@@ -143,7 +184,10 @@ SurfpackModel* MarsModelFactory::Create(const SurfData& sd)
   //printMatrix(w,n,1,cout);
   //printMatrix(y,n,1,cout);
   //printIntMatrix(lx,np,1,cout);
-  MARS_F77(n,np,xMatrix,y,w,max_bases,max_interactions,lx,fm,im,sp,dp,mm);
+  {
+    std::lock_guard<std::mutex> lock(marsBuildMutex);
+    MARS_F77(n,np,xMatrix,y,w,max_bases,max_interactions,lx,fm,im,sp,dp,mm);
+  }
   SurfpackModel* model = new MarsModel(ndims,fm,fmsize,im,imsize,interpolation);
 
   delete [] mm;
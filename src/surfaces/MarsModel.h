@@ -24,7 +24,11 @@ public:
   MarsModel(const unsigned dims, real* fm_in, int fmsize, int* im_in, 
     int imsize, int interp);
   virtual VecDbl gradient(const VecDbl& x) const;
+  using SurfpackModel::gradient;
   virtual std::string asString() const;
+  /// false: MARS builds run one at a time, and each leaves Fortran
+  /// state that the next one starts from
+  virtual bool concurrentBuilds() const { return false; }
 
 protected:
 
@@ -33,6 +37,9 @@ protected:
 
   virtual double evaluate(const VecDbl& x) const;
 
+  /// evaluate all rows of xs with a single call to FMODM
+  virtual void evaluateBatch(const MtxDbl& xs, VecDbl& ys) const;
+
   std::vector<real> fm;
   std::vector<int> im;
   int interpolation;
@@ -15,11 +15,17 @@ BOOST_CLASS_EXPORT(NormalizingScaler)
 #endif
 
 
-const VecDbl& NonScaler::scale(const VecDbl& unscaled_x) const 
+const VecDbl& NonScaler::scale(const VecDbl& unscaled_x, 
+			       VecDbl&) const 
 { 
   return unscaled_x;
 }
 
+void NonScaler::scale(MtxDbl&) const
+{
+  // nothing to do; points are used as given
+}
+
 double NonScaler::descale(double scaled_response) const 
 {
   return scaled_response;
@@ -45,7 +51,8 @@ ModelScaler* NonScaler::clone() const
   return new NonScaler(*this);
 }
 
-const VecDbl& NormalizingScaler::scale(const VecDbl& unscaled_x) const
+const VecDbl& NormalizingScaler::scale(const VecDbl& unscaled_x, 
+				       VecDbl& scaled_x) const
 {
   //cout << "NormalizingScaler::scale" << endl;
   if(unscaled_x.size() != scalers.size()) {
@@ -53,11 +60,24 @@ const VecDbl& NormalizingScaler::scale(const VecDbl& unscaled_x) const
       " scalers.size=" << scalers.size() << std::endl;
     assert(unscaled_x.size() == scalers.size());
   }
-  assert(this->result.size() == scalers.size());
+  scaled_x.resize(scalers.size());
   for (unsigned i = 0; i < scalers.size(); i++) {
-    this->result[i] = (unscaled_x[i] - scalers[i].offset)/scalers[i].scaleFactor;
+    scaled_x[i] = (unscaled_x[i] - scalers[i].offset)/scalers[i].scaleFactor;
+  }
+  return scaled_x;
+}
+
+void NormalizingScaler::scale(MtxDbl& xs) const
+{
+  assert(xs.getNCols() == scalers.size());
+  // sweep one variable at a time so the offset and factor stay in registers
+  for (unsigned j = 0; j < scalers.size(); j++) {
+    const double offset = scalers[j].offset;
+    const double factor = scalers[j].scaleFactor;
+    for (unsigned i = 0; i < xs.getNRows(); i++) {
+      xs(i,j) = (xs(i,j) - offset)/factor;
+    }
   }
-  return this->result;
 }
 
 double NormalizingScaler::descale(double scaled_response) const
@@ -194,15 +214,14 @@ double ScaledSurfData::operator()(unsigned pt, unsigned dim) const
   assert(dim < sd.xSize());
   //return points[mapping[pt]]->X()[dim];
   const VecDbl& unscaled_pt = sd[pt].X();
-  const VecDbl& scaled_pt = ms.scale(unscaled_pt);
-  return scaled_pt[dim];
+  return ms.scale(unscaled_pt, scaledPt)[dim];
 }
 
 const VecDbl& ScaledSurfData::operator()(unsigned pt) const
 {
   assert(pt < sd.size());
   const VecDbl& unscaled_pt = sd[pt].X();
-  return ms.scale(unscaled_pt);
+  return ms.scale(unscaled_pt, scaledPt);
   //copy(scaled_pt.begin(),scaled_pt.end(),std::ostream_iterator<double>(cout," "));
 }
 
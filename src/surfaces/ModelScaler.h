@@ -10,14 +10,23 @@
 #define __MODEL_SCALER_H__
 
 #include "surfpack_system_headers.h"
+#include "SurfpackMatrix.h"
 
 class SurfData;
 
+/** Maps points to and from the space a model was built in.  Scalers
+    hold no mutable state, so a single scaler (and the model owning it)
+    may be used by several threads at once. */
 class ModelScaler {
 
 public:
 
-  virtual const VecDbl& scale(const VecDbl& unscaled_x) const = 0;
+  /// scale the point unscaled_x; returns a reference to either
+  /// unscaled_x itself or the caller-provided scratch scaled_x
+  virtual const VecDbl& scale(const VecDbl& unscaled_x, 
+			      VecDbl& scaled_x) const = 0;
+  /// scale, in place, a block of points stored one per row of xs
+  virtual void scale(MtxDbl& xs) const = 0;
   virtual double descale(double scaled_response) const = 0;
   virtual double scaleResponse(double unscaled_response) const = 0;
   virtual std::string asString() { return ""; }
@@ -41,7 +50,9 @@ class NonScaler : public ModelScaler {
 
 public:
 
-  virtual const VecDbl& scale(const VecDbl& unscaled_x) const;
+  virtual const VecDbl& scale(const VecDbl& unscaled_x, 
+			      VecDbl& scaled_x) const;
+  virtual void scale(MtxDbl& xs) const;
   virtual double descale(double scaled_response) const ;
   virtual double scaleResponse(double unscaled_response) const ;
   virtual std::string asString();
@@ -78,7 +89,9 @@ public:
 #endif
   };
 
-  virtual const VecDbl& scale(const VecDbl& unscaled_x) const;
+  virtual const VecDbl& scale(const VecDbl& unscaled_x, 
+			      VecDbl& scaled_x) const;
+  virtual void scale(MtxDbl& xs) const;
   virtual double descale(double scaled_response) const;
   virtual double scaleResponse(double unscaled_response) const ;
   virtual std::string asString();
@@ -87,7 +100,7 @@ public:
   virtual double getDescalerOffset() const;
   virtual double getDescalerScaleFactor() const;
   NormalizingScaler(const std::vector<Scaler>& s, const Scaler& d) 
-    : scalers(s), descaler(d), result(s.size()) {}
+    : scalers(s), descaler(d) {}
   ~NormalizingScaler() {}
   // constructor to normalize each var/resp to [ 0, 1 ]
   static ModelScaler* Create(const SurfData& data);
@@ -99,7 +112,6 @@ protected:
 
   std::vector<Scaler> scalers;
   Scaler descaler;
-  mutable VecDbl result;
   friend class ModelScalerTest;
 
 private:
@@ -133,6 +145,9 @@ protected:
 
   const ModelScaler& ms;
   const SurfData& sd;
+  /// most recently scaled point, referenced by operator()(pt); a
+  /// ScaledSurfData is a build-time view and is not shared across threads
+  mutable VecDbl scaledPt;
 
 };
 
@@ -179,6 +194,9 @@ void NormalizingScaler::serialize(Archive & archive, const unsigned int version)
   archive & boost::serialization::base_object<ModelScaler>(*this);
   archive & scalers;
   archive & descaler;
+  // placeholder for the scaled-point buffer this class used to hold;
+  // kept so existing model files remain readable
+  VecDbl result(scalers.size());
   archive & result;
 }
 
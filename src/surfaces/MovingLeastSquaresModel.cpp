@@ -11,7 +11,7 @@ BOOST_CLASS_EXPORT(MovingLeastSquaresModel)
 #endif
 
 
-double weight(const VecDbl xi, const VecDbl x, unsigned continuity = 1, 
+double weight(const VecDbl& xi, const VecDbl& x, unsigned continuity = 1, 
 	      double radius = 1.0)
 {
   assert(continuity > 0);
@@ -47,72 +47,75 @@ MovingLeastSquaresModel::MovingLeastSquaresModel(const SurfData& sd_in, const LR
 {
   assert(continuity > 0);
   assert(continuity < 4);
+  precompute();
 }
 
-double MovingLeastSquaresModel::evaluate(const VecDbl& x) const
+void MovingLeastSquaresModel::precompute()
 {
-  unsigned nbases = bs.bases.size();
-  MtxDbl A(nbases,nbases,true);
-  VecDbl By(nbases,0.0); // B(x) = Pt(x)*w(x); By = B(x)*y;
-  VecDbl resps = sd.getResponses();
+  unsigned nbases = bs.size();
+  unsigned ndata = sd.size();
+  basisAtData.reshape(ndata, nbases);
+  VecDbl values;
+  for (unsigned k = 0; k < ndata; k++) {
+    bs.evalAll(sd(k), values);
+    for (unsigned b = 0; b < nbases; b++) {
+      basisAtData(k,b) = values[b];
+    }
+  }
+  resps = sd.getResponses();
+  tree = KDTree(sd);
+}
+
+/** Only build points with nonzero weight enter A = P'*W*P and 
+    By = P'*W*y, where P holds the basis functions at those points.  The
+    compactly supported weights (continuity 2 and 3, unit radius) come
+    from a neighbor search; A is the rank-k update (W^1/2*P)'*(W^1/2*P). */
+void MovingLeastSquaresModel::localCoeffs(const VecDbl& x, 
+					  VecDbl& coeffs) const
+{
+  unsigned nbases = bs.size();
   // # of data points must be at least as great as the number of basis functions
-  assert(resps.size() >= bs.size()); 
-  for (unsigned i = 0; i < nbases; i++) {
-    for (unsigned j = 0; j < nbases; j++) {
-      A(i,j) = 0.0;
-      for (unsigned k = 0; k < sd.size(); k++) {
-        A(i,j) += bs.eval(i,sd(k))*bs.eval(j,sd(k))*weight(sd(k),x,continuity);
-        if (!j) By[i] += bs.eval(i,sd(k))*weight(sd(k),x,continuity)*resps[k];
-      }
+  assert(resps.size() >= nbases); 
+  VecUns neighbors;
+  if (continuity > 1) {
+    tree.withinRadius(x, 1.0, neighbors);
+  } else {
+    neighbors.resize(sd.size());
+    for (unsigned k = 0; k < neighbors.size(); k++) neighbors[k] = k;
+  }
+  MtxDbl WP(neighbors.size(), nbases, true);
+  VecDbl By(nbases,0.0); // B(x) = Pt(x)*w(x); By = B(x)*y;
+  for (unsigned r = 0; r < neighbors.size(); r++) {
+    unsigned k = neighbors[r];
+    double w = weight(sd(k),x,continuity);
+    // the polynomial weights are nonnegative up to round off at the 
+    // edge of their support
+    double root_w = sqrt(std::max(w, 0.0));
+    for (unsigned i = 0; i < nbases; i++) {
+      WP(r,i) = root_w*basisAtData(k,i);
+      By[i] += basisAtData(k,i)*w*resps[k];
     }
   }
-  //  cout << "Amatrix" << "\n";  
-  //for (unsigned i = 0; i < nbases; i++) {
-  //  for (unsigned j = 0; j < nbases; j++) {
-  //    cout << A(i,j) << " " ;
-  //  }
-  //  cout << "\n";
-  //} 
-
-  //cout << "Bmatrix" << "\n";  
-  //for (unsigned i = 0; i < nbases; i++) 
-  // cout << By[i] << " " ;
-  //cout << "\n";
-
-  //VecDbl temp;
+  MtxDbl A(nbases,nbases,true);
+  surfpack::matrixGramMult(A,WP);
   surfpack::linearSystemLeastSquares(A,coeffs,By);
-  //coeffs = temp;
-  double sum = 0.0;
-  for(unsigned i = 0; i < nbases; i++) {
-    sum += bs.eval(i,x)*coeffs[i];
-    //cout << "Coefficients " << i << "= " << coeffs[i];
-    //cout << "basis " << i << "= " << bs.eval(i,x);
-  }
-  return sum;
 }
 
-/// Currently set up so that operator() must be called immediately before
-/// Not good assumption
-///\todo Be able to recompute coefficients so that prior op() call is not req.
+double MovingLeastSquaresModel::evaluate(const VecDbl& x) const
+{
+  VecDbl coeffs;
+  localCoeffs(x,coeffs);
+  return bs.evalSum(x,coeffs);
+}
+
 VecDbl MovingLeastSquaresModel::gradient(const VecDbl& x) const
 {
-  ///To get the coefficients for the derivatives of the basis functions
-  ///we need to call the evaluate function.  This is potentially inefficient,
-  ///since it is likely that the evaluate function would have been called
-  ///prior to this call.  But it should at least be correct.
-  ///\todo Remove inefficiency of having to call evaluate when gradient is called.
-  (*this)(x);
-  /// code copied straight from LRM
+  VecDbl coeffs;
+  localCoeffs(x,coeffs);
   assert(!x.empty());
-  assert(coeffs.size() == bs.bases.size());
-  VecUns diff_var(1,0); // variable with which to differentiate
-  VecDbl result(x.size(),0.0);
-  for (unsigned i = 0; i < x.size(); i++) {
-    diff_var[0] = i;
-    for (unsigned j = 0; j < bs.bases.size(); j++) {
-      result[i] += coeffs[j]*bs.deriv(j,x,diff_var);
-    }
-  }
+  assert(coeffs.size() == bs.size());
+  VecDbl result;
+  bs.gradientSum(x,coeffs,result);
   return result;
 }
 
@@ -13,6 +13,7 @@
 #include "SurfpackModel.h"
 #include "SurfData.h"
 #include "LinearRegressionModel.h"
+#include "KDTree.h"
 
 class MovingLeastSquaresModel : public SurfpackModel
 {
@@ -20,13 +21,26 @@ public:
   MovingLeastSquaresModel(const SurfData& sd_in, const LRMBasisSet& bs_in,
     unsigned continuity_in = 1);
   virtual VecDbl gradient(const VecDbl& x) const;
+  using SurfpackModel::gradient;
   virtual std::string asString() const;
 protected:
   virtual double evaluate(const VecDbl& x) const;
+  /// solve the weighted least squares problem local to x; the
+  /// coefficients are returned rather than stored, keeping evaluation
+  /// free of side effects (and safe for concurrent callers)
+  void localCoeffs(const VecDbl& x, VecDbl& coeffs) const;
+  /// form the evaluation-independent data below from sd and bs
+  void precompute();
   SurfData sd;
   LRMBasisSet bs;
-  mutable VecDbl coeffs;
   unsigned continuity;
+  /// basis functions at the build points (points x bases)
+  MtxDbl basisAtData;
+  /// build responses
+  VecDbl resps;
+  /// build points, to find those inside the support of the compact
+  /// (continuity 2 and 3) weight functions
+  KDTree tree;
   
 friend class MovingLeastSquaresModelTest;
 
@@ -84,8 +98,13 @@ void MovingLeastSquaresModel::serialize(Archive & archive,
   archive & boost::serialization::base_object<SurfpackModel>(*this);
   archive & sd;
   archive & bs;
+  // placeholder for the coefficients of the most recent evaluation,
+  // which this class used to hold; kept so model files remain readable
+  VecDbl coeffs;
   archive & coeffs;
   archive & continuity;
+  if (Archive::is_loading::value)
+    precompute();
 }
 
 #endif 
@@ -3,6 +3,8 @@
 #include "surfpack.h"
 #include "AxesBounds.h"
 #include "ModelFitness.h"
+#include "KDTree.h"
+#include "SurfpackParallel.h"
 
 using std::cout;
 using std::endl;
@@ -44,66 +46,95 @@ void updateCentroid(VecDbl& centroid, const VecDbl& newpt, unsigned weight)
   }
 }
 
-unsigned findClosest(const SurfData& sd, VecDbl pt)
+/** The nearest other generator along each dimension separately is a
+    neighbor in that dimension's sorted order, so sort once per
+    dimension rather than comparing all pairs */
+SurfData radii(const SurfData& generators)
 {
-  assert(sd.size());
-  double mindist = surfpack::euclideanDistance(sd(0),pt);
-  unsigned argmin = 0;
-  for (unsigned i = 1; i < sd.size(); i++) {
-    double distance = surfpack::euclideanDistance(sd(i),pt);
-    if (distance < mindist) {
-      mindist = distance;
-      argmin = i;
+  unsigned npts = generators.size();
+  unsigned ndims = generators.xSize();
+  VecVecDbl radius(npts, VecDbl(ndims,std::numeric_limits<double>::max()));
+  VecUns order(npts);
+  for (unsigned dim = 0; dim < ndims; dim++) {
+    for (unsigned i = 0; i < npts; i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&generators, dim](unsigned a, 
+      unsigned b) { return generators(a,dim) < generators(b,dim); });
+    for (unsigned k = 0; k + 1 < npts; k++) {
+      unsigned lo = order[k], hi = order[k+1];
+      double distance = fabs(generators(lo,dim)-generators(hi,dim));
+      if (distance < radius[lo][dim]) radius[lo][dim] = distance;
+      if (distance < radius[hi][dim]) radius[hi][dim] = distance;
     }
   }
-  return argmin;
-}
-
-SurfData radii(const SurfData& generators)
-{
   SurfData result;
-  for (unsigned i = 0; i < generators.size(); i++) {
-    VecDbl radius(generators.xSize(),std::numeric_limits<double>::max());
-    for (unsigned j = 0; j < generators.size(); j++) {
-      if (i != j) {
-        for (unsigned dim = 0; dim < generators.xSize(); dim++) {
-          double distance = fabs(generators(i,dim)-generators(j,dim));
-          if (distance < radius[dim]) radius[dim] = distance;
-        }
-      }
-    }
-    result.addPoint(SurfPoint(radius));
+  for (unsigned i = 0; i < npts; i++) {
+    result.addPoint(SurfPoint(radius[i]));
   }
   return result;
 }
 
+/** Centroidal Voronoi tessellation by sampling: each iteration assigns
+    fresh Monte Carlo influencers to their nearest generators (through a
+    k-d tree, in blocks on num_threads threads) and pulls the generators
+    toward the centroids of their influencers.  Stops after max_iters, or
+    once no generator moves more than tol (relative to the width of the
+    bounds) in any dimension. */
 SurfData cvts(const AxesBounds& ab, unsigned ngenerators, unsigned ninfluencers,
-  double minalpha = .5, double maxalpha = .99)
+  double minalpha = .5, double maxalpha = .99, unsigned max_iters = 10,
+  double tol = 1.e-3, unsigned num_threads = 0)
 {
+  surfpack::ScopedPhase phase("centers");
   assert(ninfluencers > ngenerators);
   SurfData* generators = ab.sampleMonteCarlo(ngenerators);
-  unsigned iters = 10;
-  for (unsigned i = 0; i < iters; i++) {
+  unsigned ndims = ab.size();
+  // worth a thread only for a sizeable block of influencers
+  const unsigned min_block = 256;
+  unsigned n_threads = 
+    surfpack::parallel_threads(num_threads, ninfluencers/min_block);
+  VecUns nearest(ninfluencers);
+  for (unsigned i = 0; i < max_iters; i++) {
     SurfData* influencers = ab.sampleMonteCarlo(ninfluencers);
-    vector<SurfData> closestSets(ngenerators);
-    for (unsigned samp = 0; samp < influencers->size(); samp++) {
-      unsigned nearest = findClosest(*generators,(*influencers)(samp));
-      closestSets[nearest].addPoint((*influencers)[samp]);
+    KDTree tree(*generators);
+    surfpack::parallel_for(n_threads, n_threads, [&](unsigned id, unsigned) {
+      unsigned last = surfpack::block_low(id+1,n_threads,ninfluencers);
+      for (unsigned samp = surfpack::block_low(id,n_threads,ninfluencers);
+	   samp < last; samp++)
+	nearest[samp] = tree.nearest((*influencers)(samp));
+    });
+    // sum each generator's influencers in sample order
+    VecVecDbl centers(ngenerators, VecDbl(ndims,0.0));
+    VecUns counts(ngenerators,0);
+    for (unsigned samp = 0; samp < ninfluencers; samp++) {
+      const VecDbl& x = (*influencers)(samp);
+      for (unsigned dim = 0; dim < ndims; dim++) {
+	centers[nearest[samp]][dim] += x[dim];
+      }
+      counts[nearest[samp]]++;
     } // for each sample pt
     // Find centroids, update generators
     SurfData* new_generators = new SurfData;
+    double max_move = 0.0;
     for (unsigned gen = 0; gen < ngenerators; gen++) {
-      if (closestSets[gen].size() != 0) {
-        SurfPoint center = computeCentroid(closestSets[gen]);
-        double genweight = minalpha + (maxalpha - minalpha)*((double)i/iters);
-        new_generators->addPoint(SurfPoint(
-          surfpack::weightedAvg((*generators)(gen),center.X(),genweight)));
+      if (counts[gen] != 0) {
+	for (unsigned dim = 0; dim < ndims; dim++) {
+	  centers[gen][dim] /= counts[gen];
+	}
+        double genweight = minalpha + (maxalpha - minalpha)*((double)i/max_iters);
+	VecDbl moved = 
+	  surfpack::weightedAvg((*generators)(gen),centers[gen],genweight);
+	for (unsigned dim = 0; dim < ndims; dim++) {
+	  if (ab[dim].minIsMax) continue;
+	  max_move = std::max(max_move, fabs(moved[dim]-(*generators)(gen,dim))
+			      /(ab[dim].max-ab[dim].min));
+	}
+        new_generators->addPoint(SurfPoint(moved));
       } else {
         new_generators->addPoint((*generators)(gen));
       }
     }
     delete generators; generators = new_generators;
     delete influencers;
+    if (max_move < tol) break;
   } // end iteration
   SurfData result(*generators);
   delete generators;
@@ -146,16 +177,32 @@ void augment(VecRbf& rbfs)
   }
 }
 
-MtxDbl getMatrix(const SurfData& sd, const VecRbf& candidates, VecUns used)
+/// Value of every candidate basis function at every data point
+/// (points x candidates), formed once and shared by all subsets
+MtxDbl getMatrix(const SurfData& sd, const VecRbf& candidates)
 {
-  std::sort(used.begin(),used.end());
-  MtxDbl A(sd.size(),used.size(),true);
+  surfpack::ScopedPhase phase("basis_matrix");
   unsigned nrows = sd.size();
-  unsigned ncols = used.size();
+  unsigned ncols = candidates.size();
+  MtxDbl A(nrows,ncols,true);
   for (unsigned rowa = 0; rowa < nrows; rowa++) {
+    const VecDbl& x = sd(rowa);
     for (unsigned cola = 0; cola < ncols; cola++) {
-      assert(used[cola] < candidates.size());
-      A(rowa,cola) = candidates[used[cola]](sd(rowa));
+      A(rowa,cola) = candidates[cola](x);
+    }
+  }
+  return A;
+}
+
+/// The columns of basis for the (sorted) candidates in used
+MtxDbl selectColumns(const MtxDbl& basis, const VecUns& used)
+{
+  unsigned nrows = basis.getNRows();
+  MtxDbl A(nrows,used.size(),true);
+  for (unsigned cola = 0; cola < used.size(); cola++) {
+    assert(used[cola] < basis.getNCols());
+    for (unsigned rowa = 0; rowa < nrows; rowa++) {
+      A(rowa,cola) = basis(rowa,used[cola]);
     }
   }
   return A;
@@ -276,6 +323,55 @@ double RadialBasisFunctionModel::evaluate(const VecDbl& x) const
   return sum;
 }
 
+/** Only with cv_centers = fixed: the folds would otherwise place their
+    own centers and choose their own subset, so estimates that keep this
+    model's would be optimistic */
+bool RadialBasisFunctionModel::leaveoutEstimates(const SurfData& data,
+						 const VecVecUns& partitions,
+						 VecDbl& estimates) const
+{
+  ParamMap::const_iterator param_it = args.find("cv_centers");
+  if (param_it == args.end() || param_it->second != "fixed")
+    return false;
+  MtxDbl A(data.size(), rbfs.size());
+  VecDbl scaled_x;
+  for (unsigned i = 0; i < data.size(); i++) {
+    const VecDbl& x = mScaler->scale(data(i), scaled_x);
+    for (unsigned j = 0; j < rbfs.size(); j++) {
+      A(i,j) = rbfs[j](x);
+    }
+  }
+  return surfpack::leastSquaresLeaveout(A, data.getResponses(), partitions,
+					estimates);
+}
+
+/** Form the (points x centers) matrix of basis function values, sweeping
+    each center over all points in turn, then apply the coefficients with
+    a single matrix-vector multiply */
+void RadialBasisFunctionModel::evaluateBatch(const MtxDbl& xs, VecDbl& ys) const
+{
+  unsigned npts = xs.getNRows();
+  MtxDbl phi(npts, rbfs.size());
+  VecDbl sums(npts);
+  for (unsigned c = 0; c < rbfs.size(); c++) {
+    const VecDbl& center = rbfs[c].center;
+    const VecDbl& radius = rbfs[c].radius;
+    assert(center.size() == xs.getNCols());
+    std::fill(sums.begin(), sums.end(), 0.0);
+    for (unsigned k = 0; k < center.size(); k++) {
+      for (unsigned i = 0; i < npts; i++) {
+	double temp = xs(i,k) - center[k];
+	sums[i] += temp*temp*radius[k];
+      }
+    }
+    for (unsigned i = 0; i < npts; i++) {
+      phi(i,c) = exp(-sums[i]);
+    }
+  }
+  // matrixVectorMult does not modify the vector operand
+  surfpack::matrixVectorMult(ys, phi, const_cast<VecDbl&>(coeffs));
+}
+
 /// Currently set up so that operator() must be called immediately before
 /// Not good assumption
 VecDbl RadialBasisFunctionModel::gradient(const VecDbl& x) const
@@ -328,21 +424,35 @@ std::string RadialBasisFunctionModel::asString() const
 }
 
 
-typedef std::pair<double,VecUns> RbfBest;
+/** Least squares coefficients for the candidates in used, from the
+    columns of the shared basis matrix; returns the StandardFitness of
+    the resulting model at the data */
+double fitSubset(const MtxDbl& basis, const VecDbl& b, const VecUns& used,
+		 VecDbl& coeffs)
+{
+  MtxDbl A = selectColumns(basis,used);
+  MtxDbl A_fit = A; // overwritten by the solve
+  surfpack::linearSystemLeastSquares(A_fit,coeffs,b);
+  VecDbl predicted;
+  surfpack::matrixVectorMult(predicted,A,coeffs);
+  StandardFitness sf;
+  return sf(b,predicted);
+}
+
 ///////////////////////////////////////////////////////////
 ///	Moving Least Squares Model Factory
 ///////////////////////////////////////////////////////////
 
 RadialBasisFunctionModelFactory::RadialBasisFunctionModelFactory()
   : SurfpackModelFactory(), nCenters(0), cvtPts(0), maxSubsets(0), 
-  minPartition(1)
+  minPartition(1), numThreads(0)
 {
 
 }
 
 RadialBasisFunctionModelFactory::RadialBasisFunctionModelFactory(const ParamMap& args)
   : SurfpackModelFactory(args), nCenters(0), cvtPts(0), maxSubsets(0), 
-  minPartition(1)
+  minPartition(1), numThreads(0)
 {
 
 }
@@ -359,8 +469,17 @@ void RadialBasisFunctionModelFactory::config()
   if (strarg != "") maxSubsets = std::atoi(strarg.c_str());
   strarg = params["min_partition"];
   if (strarg != "") minPartition = std::atoi(strarg.c_str());
+  strarg = params["num_threads"];
+  if (strarg != "") numThreads = std::atoi(strarg.c_str());
+  strarg = params["cv_centers"];
+  if (strarg != "" && strarg != "rebuild" && strarg != "fixed")
+    throw string("Rbf cv_centers must be rebuild or fixed");
 }
 
+/** Candidate subsets are drawn up front, so the random stream (and the
+    chosen model) doesn't depend on how many threads score them.  Every
+    subset's design matrix is a column selection of one shared basis
+    matrix, and the winning coefficients are kept rather than refit. */
 SurfpackModel* RadialBasisFunctionModelFactory::Create(const SurfData& sd)
 {
   unsigned max_centers = 100;
@@ -368,42 +487,43 @@ SurfpackModel* RadialBasisFunctionModelFactory::Create(const SurfData& sd)
   if (nCenters == 0) nCenters = min(max_centers,sd.size());
   if (cvtPts == 0) cvtPts = 10*nCenters;
   if (maxSubsets == 0) maxSubsets = min(max_max_subsets,3*nCenters);
-  RbfBest bestset(std::numeric_limits<double>::max(),VecUns());
   
-  SurfData centers = cvts(AxesBounds::boundingBox(sd),nCenters,cvtPts);
+  SurfData centers = cvts(AxesBounds::boundingBox(sd),nCenters,cvtPts,
+			  .5,.99,10,1.e-3,numThreads);
   SurfData radiuses = radii(centers);
   VecDbl b = sd.getResponses();
   VecRbf candidates = makeRbfs(centers,radiuses);
   augment(candidates);
   assert(candidates.size() == 2*nCenters);
+  MtxDbl basis = getMatrix(sd,candidates);
+
+  vector<VecUns> subsets(maxSubsets);
   for (unsigned i = 0; i < maxSubsets; i++) {
-    VecUns used = probInclusion(candidates.size(),sd.size(),.5);
-    MtxDbl A = getMatrix(sd,candidates,used);
-    VecDbl x;
-    surfpack::linearSystemLeastSquares(A,x,b);
-    VecDbl coeffs = fullCoeff(candidates.size(),x,used);
-    RadialBasisFunctionModel rbfm(candidates,coeffs);
-    StandardFitness sf;
-    double fitness = sf(rbfm,sd);
-    if (fitness < bestset.first) bestset = RbfBest(fitness,used);
+    subsets[i] = probInclusion(candidates.size(),sd.size(),.5);
+  }
+  VecDbl fitness(maxSubsets);
+  vector<VecDbl> subset_coeffs(maxSubsets);
+
+  // the workers' least squares fits are merged into the profile, their
+  // times summed over threads; this phase is the wall clock time
+  surfpack::ScopedPhase subset_phase("subset_selection");
+  surfpack::parallel_for(maxSubsets, numThreads,
+    [&](unsigned i, unsigned) {
+      fitness[i] = fitSubset(basis,b,subsets[i],subset_coeffs[i]);
+    });
+
+  // the first of any equally fit subsets wins, as in a serial search
+  unsigned best = 0;
+  for (unsigned i = 1; i < maxSubsets; i++) {
+    if (fitness[i] < fitness[best]) best = i;
   }
-  VecUns used = bestset.second;
+  const VecUns& used = subsets[best];
   VecRbf final_rbfs;
-  VecUns final_used(used.size());
   for (unsigned i = 0; i < used.size(); i++) {
-    final_used[i] = i;
     final_rbfs.push_back(candidates[used[i]]);
   }
-  // Recompute the coefficients.  If we cached the result, we wouldn't
-  // have to do it again.  
-  MtxDbl A = getMatrix(sd,final_rbfs,final_used);
-  VecDbl x;
-  surfpack::linearSystemLeastSquares(A,x,b);
-  SurfpackModel* sm = new RadialBasisFunctionModel(final_rbfs, x); 
-  StandardFitness sf;
-  double fitness = sf(*sm,sd);
-  //cout << "Cached fitness: " << bestset.first << " recomputed: " << fitness << endl;
+  SurfpackModel* sm = 
+    new RadialBasisFunctionModel(final_rbfs, subset_coeffs[best]); 
   assert(sm);
   return sm; 
 }
-
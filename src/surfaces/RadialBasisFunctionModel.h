@@ -67,13 +67,24 @@ public:
   RadialBasisFunctionModel(const VecRbf& rbfs_in, const VecDbl& coeffs_in);
   virtual double evaluate(const VecDbl& x) const;
   virtual VecDbl gradient(const VecDbl& x) const;
+  using SurfpackModel::gradient;
   virtual std::string asString() const;
+  /// leave-out estimates refitting only the coefficients of these
+  /// basis functions (centers and radii held fixed), from the hat
+  /// matrix; only when built with cv_centers = fixed, since by default
+  /// (rebuild) each fold chooses its own basis functions
+  virtual bool leaveoutEstimates(const SurfData& data,
+				 const VecVecUns& partitions,
+				 VecDbl& estimates) const;
 
 protected:
 
   /// default constructor used when reading from archive file
   RadialBasisFunctionModel() { /* empty ctor */ }
 
+  /// evaluate all rows of xs via one RBF matrix and a DGEMV
+  virtual void evaluateBatch(const MtxDbl& xs, VecDbl& ys) const;
+
   VecRbf rbfs;
   VecDbl coeffs;
 
@@ -120,6 +131,9 @@ protected:
   unsigned cvtPts;
   unsigned maxSubsets;
   unsigned minPartition;
+  /// threads placing centers and scoring candidate subsets (0 for
+  /// surfpack::default_num_threads())
+  unsigned numThreads;
 };
 
 
@@ -12,24 +12,95 @@ using std::string;
 BOOST_CLASS_EXPORT_IMPLEMENT(SurfpackModel)
 #endif
 
+const unsigned SurfpackModel::evalBlockSize;
+
 ///////////////////////////////////////////////////////////
 ///	Surfpack Model 
 ///////////////////////////////////////////////////////////
 
 VecDbl SurfpackModel::operator()(const SurfData& data) const
 {
-  VecDbl result(data.size());
-  for (unsigned pt = 0; pt < data.size(); pt++) {
-    result[pt] = (*this)(data(pt));
+  unsigned npts = data.size();
+  VecDbl result(npts);
+  assert(npts == 0 || data.xSize() == ndims);
+  for (unsigned start = 0; start < npts; start += evalBlockSize) {
+    unsigned block_pts = std::min(evalBlockSize, npts - start);
+    MtxDbl xs(block_pts, ndims);
+    for (unsigned i = 0; i < block_pts; i++) {
+      const double* x = data.xData() + data.physicalIndex(start+i)*ndims;
+      for (unsigned j = 0; j < ndims; j++) {
+	xs(i,j) = x[j];
+      }
+    }
+    evaluateBlock(xs, &result[start]);
   }
   return result;
 }
 
+void SurfpackModel::operator()(const double* x, unsigned npts, 
+			       unsigned pt_stride, unsigned var_stride,
+			       double* y) const
+{
+  assert((x != NULL && y != NULL) || npts == 0);
+  for (unsigned start = 0; start < npts; start += evalBlockSize) {
+    unsigned block_pts = std::min(evalBlockSize, npts - start);
+    MtxDbl xs(block_pts, ndims);
+    for (unsigned j = 0; j < ndims; j++) {
+      for (unsigned i = 0; i < block_pts; i++) {
+	xs(i,j) = x[(start+i)*pt_stride + j*var_stride];
+      }
+    }
+    evaluateBlock(xs, y + start);
+  }
+}
+
+void SurfpackModel::operator()(const MtxDbl& x, double* y) const
+{
+  assert(x.getNCols() == ndims);
+  unsigned npts = x.getNRows();
+  for (unsigned start = 0; start < npts; start += evalBlockSize) {
+    unsigned block_pts = std::min(evalBlockSize, npts - start);
+    MtxDbl xs(block_pts, ndims);
+    for (unsigned j = 0; j < ndims; j++) {
+      for (unsigned i = 0; i < block_pts; i++) {
+	xs(i,j) = x(start+i,j);
+      }
+    }
+    evaluateBlock(xs, y + start);
+  }
+}
+
+/** Scale a block of points in place, evaluate them in one batch, and
+    write the descaled responses to y */
+void SurfpackModel::evaluateBlock(MtxDbl& xs, double* y) const
+{
+  VecDbl ys;
+  mScaler->scale(xs);
+  evaluateBatch(xs, ys);
+  assert(ys.size() == xs.getNRows());
+  for (unsigned i = 0; i < ys.size(); i++) {
+    y[i] = mScaler->descale(ys[i]);
+  }
+}
+
+void SurfpackModel::evaluateBatch(const MtxDbl& xs, VecDbl& ys) const
+{
+  ys.resize(xs.getNRows());
+  VecDbl x(xs.getNCols());
+  for (unsigned i = 0; i < xs.getNRows(); i++) {
+    for (unsigned j = 0; j < xs.getNCols(); j++) {
+      x[j] = xs(i,j);
+    }
+    ys[i] = evaluate(x);
+  }
+}
+
 double SurfpackModel::operator()(const VecDbl& x) const
 {
   //cout << "\nunscaled\n";
   //copy(x.begin(),x.end(),std::ostream_iterator<double>(cout," "));
-  const VecDbl& x1 = mScaler->scale(x);
+  VecDbl scaled_x;
+  const VecDbl& x1 = mScaler->scale(x, scaled_x);
   //cout << "\nscaled\n";
   //copy(x1.begin(),x1.end(),std::ostream_iterator<double>(cout," "));
   double value = evaluate(x1);
@@ -53,7 +124,8 @@ SurfpackModel::SurfpackModel(unsigned ndims_in)
 }
 
 SurfpackModel::SurfpackModel(const SurfpackModel& other)
-  : ndims(other.ndims), args(other.args), mScaler(other.mScaler->clone())
+  : ndims(other.ndims), args(other.args), mScaler(other.mScaler->clone()),
+    profile(other.profile)
 {
 
 }
@@ -71,11 +143,82 @@ double SurfpackModel::variance(const VecDbl& x) const
   throw std::string("This model does not currently support variance eval");
 }
 
+void SurfpackModel::variance(const MtxDbl& x, double* var) const
+{
+  assert(x.getNCols() == ndims);
+  unsigned npts = x.getNRows();
+  VecDbl vars;
+  for (unsigned start = 0; start < npts; start += evalBlockSize) {
+    unsigned block_pts = std::min(evalBlockSize, npts - start);
+    MtxDbl xs(block_pts, ndims);
+    for (unsigned j = 0; j < ndims; j++) {
+      for (unsigned i = 0; i < block_pts; i++) {
+	xs(i,j) = x(start+i,j);
+      }
+    }
+    varianceBatch(xs, vars);
+    assert(vars.size() == block_pts);
+    std::copy(vars.begin(), vars.end(), var + start);
+  }
+}
+
+void SurfpackModel::varianceBatch(const MtxDbl& xs, VecDbl& vars) const
+{
+  vars.resize(xs.getNRows());
+  VecDbl x(xs.getNCols());
+  for (unsigned i = 0; i < xs.getNRows(); i++) {
+    for (unsigned j = 0; j < xs.getNCols(); j++) {
+      x[j] = xs(i,j);
+    }
+    vars[i] = variance(x);
+  }
+}
+
 VecDbl SurfpackModel::gradient(const VecDbl& x) const
 {
   throw std::string("This model does not currently support gradients");
 }
 
+void SurfpackModel::gradient(const MtxDbl& x, MtxDbl& grads) const
+{
+  assert(x.getNCols() == ndims);
+  unsigned npts = x.getNRows();
+  grads.reshape(npts, ndims);
+  MtxDbl block_grads;
+  for (unsigned start = 0; start < npts; start += evalBlockSize) {
+    unsigned block_pts = std::min(evalBlockSize, npts - start);
+    MtxDbl xs(block_pts, ndims);
+    for (unsigned j = 0; j < ndims; j++) {
+      for (unsigned i = 0; i < block_pts; i++) {
+	xs(i,j) = x(start+i,j);
+      }
+    }
+    gradientBatch(xs, block_grads);
+    assert(block_grads.getNRows() == block_pts);
+    for (unsigned j = 0; j < ndims; j++) {
+      for (unsigned i = 0; i < block_pts; i++) {
+	grads(start+i,j) = block_grads(i,j);
+      }
+    }
+  }
+}
+
+void SurfpackModel::gradientBatch(const MtxDbl& xs, MtxDbl& grads) const
+{
+  grads.reshape(xs.getNRows(), xs.getNCols());
+  VecDbl x(xs.getNCols());
+  for (unsigned i = 0; i < xs.getNRows(); i++) {
+    for (unsigned j = 0; j < xs.getNCols(); j++) {
+      x[j] = xs(i,j);
+    }
+    VecDbl grad = gradient(x);
+    assert(grad.size() == xs.getNCols());
+    for (unsigned j = 0; j < xs.getNCols(); j++) {
+      grads(i,j) = grad[j];
+    }
+  }
+}
+
 MtxDbl SurfpackModel::hessian(const VecDbl& x) const
 {
   throw std::string("This model does not currently support hessians");
@@ -196,6 +339,18 @@ double SurfpackModel::nFoldCrossValidation(const SurfData& data, unsigned n)
 return 0.;
 }
 
+bool SurfpackModel::leaveoutEstimates(const SurfData& data,
+				      const VecVecUns& partitions,
+				      VecDbl& estimates) const
+{
+  return false;
+}
+
+bool SurfpackModel::concurrentBuilds() const
+{
+  return true;
+}
+
 double SurfpackModel::genericMetric(std::vector<double>& observed,
     std::vector<double>& predicted, enum MetricType mt, enum DifferenceType dt)
 {
@@ -317,7 +472,14 @@ SurfpackModel* SurfpackModelFactory::Build(const SurfData& sd)
   sd.setDefaultIndex(this->response_index);
   // check whether there is sufficient SurfData to build
   sufficient_data(sd);
-  SurfpackModel* model = Create(sd);
+  SurfpackModel* model = NULL;
+  surfpack::BuildProfile profile;
+  {
+    surfpack::BuildProfileScope profile_scope(profile);
+    surfpack::ScopedPhase phase("build");
+    model = Create(sd);
+  }
   model->parameters(params);
+  model->buildProfile(profile);
   return model;
 }
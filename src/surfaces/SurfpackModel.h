@@ -13,6 +13,7 @@
 #include "surfpack.h"
 // need complete type information for serialization
 #include "ModelScaler.h"
+#include "SurfpackProfile.h"
 
 class SurfData;
 
@@ -21,6 +22,11 @@ class SurfData;
 ///	Surfpack Model 
 ///////////////////////////////////////////////////////////
 
+/** Base class for all surfaces.  The const evaluation members
+    (operator(), variance, gradient, hessian) are reentrant: any
+    scratch space is local to the call, so once built (or loaded) one
+    model may be evaluated by many threads concurrently.  Construction,
+    scaler(ModelScaler*), and parameters(ParamMap) are not thread safe. */
 class SurfpackModel
 {
 
@@ -30,8 +36,24 @@ public:
   SurfpackModel(const SurfpackModel& other);
   virtual VecDbl operator()(const SurfData& data) const;
   double operator()(const VecDbl& x) const;
+  /// Evaluate the model at npts points stored in one contiguous block;
+  /// coordinate j of point i is read from x[i*pt_stride + j*var_stride],
+  /// so a row-major block uses (pt_stride, var_stride) = (size(), 1) and
+  /// a column-major block uses (1, npts).  The npts responses are
+  /// written to the caller-allocated array y.
+  void operator()(const double* x, unsigned npts, unsigned pt_stride,
+		  unsigned var_stride, double* y) const;
+  /// Evaluate the model at each row of x (npts x size()), writing the
+  /// npts responses to the caller-allocated array y
+  void operator()(const MtxDbl& x, double* y) const;
   virtual double variance(const VecDbl& x) const;
+  /// Variance at each row of x (npts x size()), written to the
+  /// caller-allocated array var
+  void variance(const MtxDbl& x, double* var) const;
   virtual VecDbl gradient(const VecDbl& x) const;
+  /// Gradients at each row of x (npts x size()), returned as the rows
+  /// of grads (npts x size())
+  void gradient(const MtxDbl& x, MtxDbl& grads) const;
   virtual MtxDbl hessian(const VecDbl& x) const;
   virtual std::string asString() const = 0;
   void modelFitness(const double& fitness);
@@ -50,6 +72,19 @@ public:
   /// square root of the mean of the squares of all the residuals.
   double press(const SurfData& data);
   double nFoldCrossValidation(const SurfData& data, unsigned n);
+  /// Estimate the response at each point of data as this model would
+  /// if refit on data less the partition containing the point, without
+  /// rebuilding.  Returns false, leaving estimates unspecified, when the
+  /// model has no closed form for this; callers must then rebuild.
+  virtual bool leaveoutEstimates(const SurfData& data,
+				 const VecVecUns& partitions,
+				 VecDbl& estimates) const;
+  /// Whether rebuilds of this model (e.g., cross-validation folds) gain
+  /// from running at the same time.  A model whose build holds a
+  /// process-wide lock for nearly all of its run returns false; its
+  /// rebuilds are then made one at a time, each free to spread its own
+  /// work over the threads.
+  virtual bool concurrentBuilds() const;
   /// Compute one of several goodness of fit metrics.  The observed parameter
   /// should be a list of observed (or true) function values; the vector of
   /// predicted values gives the corresponding estimates from this surface.
@@ -75,6 +110,11 @@ public:
   const VecStr& input_labels() const { return inputLabels; }
   void input_labels(const VecStr& labels) { this->inputLabels = labels; }
 
+  /// where the time of the build went (see SurfpackProfile.h); empty
+  /// for a model read from a file
+  const surfpack::BuildProfile& buildProfile() const { return profile; }
+  void buildProfile(const surfpack::BuildProfile& p) { this->profile = p; }
+
 protected:
 
   /// default constructor used when reading from archive file 
@@ -83,6 +123,27 @@ protected:
   /// evaluation function implemented by derived classes, used in operator()
   virtual double evaluate(const VecDbl& x) const = 0;
 
+  /// batch evaluation used by the block operator(); xs holds one scaled
+  /// point per row and ys must be resized to xs.getNRows().  Derived
+  /// classes override this with a vectorized kernel; the default loops
+  /// over evaluate(const VecDbl&)
+  virtual void evaluateBatch(const MtxDbl& xs, VecDbl& ys) const;
+
+  /// maximum number of points handed to evaluateBatch at once, bounding
+  /// the scratch memory (e.g., basis or correlation matrices) per call
+  static const unsigned evalBlockSize = 512;
+
+  /// batch variance used by the block variance(); like variance(const
+  /// VecDbl&), xs holds unscaled points, one per row, and vars must be
+  /// resized to xs.getNRows().  The default loops over variance(const
+  /// VecDbl&)
+  virtual void varianceBatch(const MtxDbl& xs, VecDbl& vars) const;
+
+  /// batch gradient used by the block gradient(); as with the variance,
+  /// xs holds unscaled points and grads is resized to match xs.  The
+  /// default loops over gradient(const VecDbl&)
+  virtual void gradientBatch(const MtxDbl& xs, MtxDbl& grads) const;
+
   /// number of input (x) variables
   unsigned ndims;
   /// input (x) variable labels, possibly empty
@@ -91,12 +152,17 @@ protected:
   ParamMap args;
   /// data scaler for this model
   ModelScaler*  mScaler;
+  /// phases and counters recorded by the factory's Build; not saved
+  surfpack::BuildProfile profile;
 
 private:
 
   /// disallow assignment as not implemented
   SurfpackModel& operator=(const SurfpackModel& other);
 
+  /// scale, batch evaluate, and descale one block of points into y
+  void evaluateBlock(MtxDbl& xs, double* y) const;
+
 #ifdef SURFPACK_HAVE_BOOST_SERIALIZATION
   // allow serializers access to private data
   friend class boost::serialization::access;
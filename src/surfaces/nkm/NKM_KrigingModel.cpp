@@ -1,9 +1,12 @@
 #include "NKM_SurfPack.hpp"
 #include "NKM_KrigingModel.hpp"
+#include "SurfpackParallel.h"
+#include "SurfpackProfile.h"
 //#include "Accel.hpp"
 //#include "NKM_LinearRegressionModel.hpp"
 #include <math.h>
 #include <iostream>
+#include <iomanip>
 #include <cfloat>
 
 
@@ -28,7 +31,10 @@ using std::ostringstream;
 // typical constructor
 KrigingModel::KrigingModel(const SurfData& sd, const ParamMap& params)
   : SurfPackModel(sd,sd.getIOut()), numVarsr(sd.getNVarsr()), 
-    numTheta(numVarsr), numPoints(sdBuild.getNPts()), XR(sdBuild.xr)
+    numTheta(numVarsr), numThreads(0), varianceStateMutex(new std::mutex),
+    numPoints(sdBuild.getNPts()), sharedBuild(new SharedBuildMatrices),
+    XR(sdBuild.xr), Yall(sharedBuild->Yall), Gall(sharedBuild->Gall),
+    Z(sharedBuild->Z), deltaXR(sharedBuild->deltaXR)
 {
   //printf("calling the right KrigingModel constructor\n"); fflush(stdout);
 
@@ -178,19 +184,6 @@ KrigingModel::KrigingModel(const SurfData& sd, const ParamMap& params)
   //no dimensions are locked.  The scaling is done to let us define 
   //the feasible region simply (region is defined in create);
 
-  if(buildDerOrder==0) {
-    sdBuild.getY(Yall); 
-    Yall.reshape(numPoints,1);
-  }
-  else if(buildDerOrder==1) {
-    sdBuild.getUpToDerY(Yall,1);
-    Yall.reshape(numEqnAvail,1);
-    //Yall is now a column vector that contains
-    //[y0, dy_0/dxr_0, ..., dy_0/dxr_{numVarsr-1}, y1, dy_1/dxr_0, ..., y2, ...
-    // y_{numPoints-1}, dy_{numPoints-1}/dxr_0, ...,
-    // dy_{numPoints-1}/dx_{numVarsr-1}]^T
-  }
-
   // *************************************************************
   // this starts the input section about optimizing or directly
   // specifying correlation lengths, it must come after the 
@@ -198,7 +191,7 @@ KrigingModel::KrigingModel(const SurfData& sd, const ParamMap& params)
   // *************************************************************
   
   // current options are none (fixed correl) | sampling (guess) | local | 
-  // global | global_local
+  // quasi_newton | global | global_local
   optimizationMethod = "global"; //the default
   //optimizationMethod = "none"; //the default
   param_it = params.find("optimization_method");
@@ -209,6 +202,13 @@ KrigingModel::KrigingModel(const SurfData& sd, const ParamMap& params)
     maxTrials=1;
   else if(optimizationMethod.compare("local")==0)
     maxTrials=20;
+  else if(optimizationMethod.compare("quasi_newton")==0) {
+    if(buildDerOrder!=0) {
+      std::cerr << "The quasi_newton optimization_method needs the analytical gradient of the\nlikelihood, which is only available for Kriging (derivative_order 0).\n";
+      assert(false);
+    }
+    maxTrials=50;
+  }
   else if(optimizationMethod.compare("sampling")==0)
     maxTrials=2*numVarsr+1;
   else if(optimizationMethod.compare("global")==0)
@@ -239,8 +239,9 @@ KrigingModel::KrigingModel(const SurfData& sd, const ParamMap& params)
     }
   }
   
-  if(!((numStarts==1)||(optimizationMethod.compare("local")==0))) {
-    std::cerr << "Local optimization is the only optimization method for Kriging that uses the \"num_starts\" key word. Check your input file for errors.\n";
+  if(!((numStarts==1)||(optimizationMethod.compare("local")==0)||
+       (optimizationMethod.compare("quasi_newton")==0))) {
+    std::cerr << "Local and quasi_newton optimization are the only optimization methods for Kriging that use the \"num_starts\" key word. Check your input file for errors.\n";
     assert(false);
   }
   
@@ -451,7 +452,9 @@ KrigingModel::KrigingModel(const SurfData& sd, const ParamMap& params)
   numConFunc=1;
   
   //convert to the Dakota bitflag convention for derivative orders
-  int num_analytic_obj_ders_in=0; //analytical derivatives have been removed
+  //the analytical gradient of the objective is available for Kriging 
+  //but not for Gradient Enhanced Kriging
+  int num_analytic_obj_ders_in=(buildDerOrder==0)?1:0; 
   int num_analytic_con_ders_in=0; //analytical derivatives have been removed
   maxObjDerMode=(static_cast<int>(std::pow(2.0,num_analytic_obj_ders_in+1)))-1; //analytical gradients of objective function
   maxConDerMode=(static_cast<int> (std::pow(2.0,num_analytic_con_ders_in+1)))-1; //analytical gradients of constraint function(s)
@@ -498,9 +501,91 @@ KrigingModel::KrigingModel(const SurfData& sd, const ParamMap& params)
     ifPrescribedNug=true;
   }
 
+  // compute R tile by tile from XR instead of storing the Z matrix
+  ifStreamR=false; //default
+  param_it = params.find("stream_correlation_matrix");
+  if (param_it != params.end() && param_it->second.size() > 0)
+    ifStreamR=(std::atoi(param_it->second.c_str())!=0);
+
+  // *************************************************************
+  // how often update() should reoptimize the correlation lengths,
+  // zero (the default) means that it never does
+  // *************************************************************
+  reoptimizeEvery=0;
+  numUpdates=0;
+  param_it = params.find("reoptimize_every");
+  if (param_it != params.end() && param_it->second.size() > 0) {
+    reoptimizeEvery = std::atoi(param_it->second.c_str());
+    if(reoptimizeEvery<0) {
+      std::cerr << "reoptimize_every must be a non-negative integer"
+		<< std::endl;
+      assert(false);
+    }
+  }
+
+  // *************************************************************
+  // whether create() and update() should keep only what's needed to
+  // evaluate the mean, see make_prediction_only()
+  // *************************************************************
+  ifPredictionOnly=false;
+  param_it = params.find("prediction_only");
+  if (param_it != params.end() && param_it->second.size() > 0)
+    ifPredictionOnly=(std::atoi(param_it->second.c_str())!=0);
+
+  // *************************************************************
+  // the most threads to optimize the correlation lengths and to
+  // stream R with, zero (the default) means the library default
+  // *************************************************************
+  numThreads=0;
+  param_it = params.find("num_threads");
+  if (param_it != params.end() && param_it->second.size() > 0) {
+    numThreads = std::atoi(param_it->second.c_str());
+    if(numThreads<0) {
+      std::cerr << "num_threads must be a non-negative integer"
+		<< std::endl;
+      assert(false);
+    }
+  }
+
   // *************************************************************
   // this ends the input parsing now finish up the prep work
   // *************************************************************
+  prepareBuild();
+
+  //printf("completed the KrigingModel constructor\n"); fflush(stdout);
+}
+
+/** (re)initialize, from the (scaled) build data in sdBuild, everything
+    that create() needs but discards once the model is built; called at
+    the end of the constructor and again by update() when it must refit
+    the model from all of its points */
+void KrigingModel::prepareBuild()
+{
+  numPoints=sdBuild.getNPts();
+  numEqnAvail=(buildDerOrder==0)?numPoints:(1+numVarsr)*numPoints;
+
+  if(buildDerOrder==0) {
+    sdBuild.getY(Yall); 
+    Yall.reshape(numPoints,1);
+  }
+  else if(buildDerOrder==1) {
+    sdBuild.getUpToDerY(Yall,1);
+    Yall.reshape(numEqnAvail,1);
+    //Yall is now a column vector that contains
+    //[y0, dy_0/dxr_0, ..., dy_0/dxr_{numVarsr-1}, y1, dy_1/dxr_0, ..., y2, ...
+    // y_{numPoints-1}, dy_{numPoints-1}/dxr_0, ...,
+    // dy_{numPoints-1}/dx_{numVarsr-1}]^T
+  }
+
+  if(Poly.getNCols()<numTrend(polyOrderRequested,0)) {
+    //create() discarded some of the trend basis functions, start over
+    //with all of the ones requested
+    if(ifReducedPoly)
+      main_effects_poly_power(Poly, numVarsr, polyOrderRequested);
+    else
+      multi_dim_poly_power(Poly, numVarsr, polyOrderRequested);
+  }
+
   preAllocateMaxMemory(); //so we don't have to constantly dynamically 
   //allocate, the SurfMat class can use a subset of the allocated memory
   //without using dynamic reallocation
@@ -563,8 +648,6 @@ KrigingModel::KrigingModel(const SurfData& sd, const ParamMap& params)
   // coefficient is 1.0, for Matern 1.5 and Matern 2.5 correlation functions
   // it's not 1.0 and we only do the multiplcation when the coefficient isn't
   // 1.0 to save computation.
-
-  //printf("completed the KrigingModel constructor\n"); fflush(stdout);
 }
 
 void KrigingModel::create()
@@ -585,6 +668,7 @@ void KrigingModel::create()
   
   //printf("numVarsr=%d\n",numVarsr); fflush(stdout);
   OptimizationProblem opt(*this, numVarsr, numConFunc);
+  opt.num_threads(numThreads);
   
   
   // set the bounds for the plausible region for correlation lengths
@@ -666,6 +750,7 @@ void KrigingModel::create()
     opt.retrieve_initial_iterate(0,natLogCorrLen);
   } 
   else{
+    ::surfpack::ScopedPhase optimization_phase("optimization");
     if(optimizationMethod.compare("local")==0) {
       //local optimization
       if(numStarts==1)
@@ -676,6 +761,14 @@ void KrigingModel::create()
 	opt.multistart_conmin_optimize(numStarts);
       }
     }
+    else if(optimizationMethod.compare("quasi_newton")==0) {
+      //bound constrained limited memory BFGS using the analytical 
+      //gradient of the likelihood
+      if(numStarts==1)
+	opt.lbfgs_optimize();
+      else
+	opt.multistart_lbfgs_optimize(numStarts);
+    }
     else if(optimizationMethod.compare("global")==0)
       //global optimization via the "DIvision of RECTangles" method
       opt.direct_optimize();
@@ -698,6 +791,17 @@ void KrigingModel::create()
     natLogCorrLen = opt.best_point();
   }
 
+  fitAtCorrLen();
+  if(ifPredictionOnly)
+    make_prediction_only();
+}
+
+/** build the model at the correlation lengths in natLogCorrLen, i.e. 
+    everything create() does after it has optimized them */
+void KrigingModel::fitAtCorrLen()
+{
+  prevObjDerMode=prevConDerMode=0;
+
   MtxDbl corr_len(numVarsr,1);
   for(int ixr=0; ixr<numVarsr; ++ixr)
     corr_len(ixr,0)=std::exp(natLogCorrLen(ixr,0));
@@ -747,6 +851,8 @@ void KrigingModel::create()
     for(int ixr=0; ixr<numVarsr; ++ixr)
       XRreorder(ixr,ipt)=XR(ixr,isrc);
   }
+  if(buildDerOrder==0)
+    prepareCorrelationTile();
 
   if(outputLevel >= NORMAL_OUTPUT) {
     std::cout << model_summary_string();
@@ -785,6 +891,353 @@ void KrigingModel::create()
   con.clear(); //vector
 }
 
+/** add new_points (unscaled, with the same inputs, outputs and 
+    derivative orders as the build data) to an already created model.
+    For Kriging the correlation parameters, nugget, and retained trend
+    basis functions are kept and the Cholesky factorization of R is 
+    extended by the new rows and columns (see extendCholR()), so an 
+    update costs O(numRowsR^2*(nnew+nTrend)) ops instead of the 
+    O(numRowsR^3) factorizations, many of them, of create().  Every
+    reoptimizeEvery-th update (if reoptimizeEvery>0) runs create() on all
+    of the points instead.  Gradient Enhanced Kriging, and updates that 
+    would make R or G*R^-1*G^T ill-conditioned, are refit from all of the
+    points at the current correlation lengths (so points or trend basis 
+    functions may be discarded as they are in create()).  The build data
+    is not rescaled, the new points are scaled as the original ones were */
+void KrigingModel::update(const SurfData& new_points)
+{
+  int nnew=new_points.getNPts();
+  if(nnew==0)
+    return;
+
+  int num_old=numPoints;
+  SurfData sd_new(new_points); //putPoints() wants a non-const SurfData
+  sdBuild.putPoints(sd_new); //appends the new points at sdBuild's scale
+  numPoints=sdBuild.getNPts();
+  ++numUpdates;
+
+  if((reoptimizeEvery>0)&&(numUpdates%reoptimizeEvery==0)) {
+    prepareBuild();
+    create();
+    return;
+  }
+
+  numEqnAvail=(buildDerOrder==0)?numPoints:(1+numVarsr)*numPoints;
+  if(buildDerOrder==0) {
+    restoreVarianceState(); //extendCholR() extends RChol and Y
+    if(extendCholR(num_old)) {
+      prepareCorrelationTile();
+      if(outputLevel >= NORMAL_OUTPUT)
+	std::cout << model_summary_string();
+      if(ifPredictionOnly)
+	make_prediction_only();
+      return;
+    }
+  }
+
+  prepareBuild();
+  fitAtCorrLen();
+  if(ifPredictionOnly)
+    make_prediction_only();
+}
+
+/** extend, for Kriging, the factorization R=RChol*RChol^T of the 
+    retained points' correlation matrix by the build points num_old 
+    through numPoints-1 (appended to the retained points in that order),
+    then recompute everything that depends on it: the trend coefficients,
+    rhs, and the estimated variance.  The correlation parameters, nugget,
+    and trend basis functions are unchanged.  Returns false if the 
+    extended R or G*R^-1*G^T is numerically singular, in which case the
+    caller must refit the model from scratch */
+bool KrigingModel::extendCholR(int num_old)
+{
+  int nold=numRowsR;
+  int nnew=numPoints-num_old;
+  int nrows=nold+nnew;
+  double min_allowed_rcond=1.0/maxCondNum;
+
+  //rcondR needs the one norm of R, i.e. its maximum absolute column sum;
+  //create() doesn't keep the column sums so compute those of the 
+  //retained points once (a tile of columns at a time) and then just 
+  //update them
+  if(sumAbsColR.getNRows()!=nold) {
+    sumAbsColR.newSize(nold,1);
+    int ntile_max=(1<<17)/nold;
+    if(ntile_max<16)
+      ntile_max=16;
+    MtxDbl xr_tile, r;
+    for(int jstart=0; jstart<nold; jstart+=ntile_max) {
+      int ntile=(nold-jstart<ntile_max)?(nold-jstart):ntile_max;
+      xr_tile.newSize(numVarsr,ntile);
+      for(int j=0; j<ntile; ++j)
+	for(int k=0; k<numVarsr; ++k)
+	  xr_tile(k,j)=XRreorder(k,jstart+j);
+      correlation_matrix(r,xr_tile);
+      for(int j=0; j<ntile; ++j) {
+	double sum=nug; //the diagonal of R is 1+nug
+	for(int i=0; i<nold; ++i)
+	  sum+=std::fabs(r(i,j));
+	sumAbsColR(jstart+j,0)=sum;
+      }
+    }
+  }
+
+  //the new points are appended to the retained ones
+  MtxDbl xr_new(numVarsr,nnew);
+  XRreorder.resize(numVarsr,nrows);
+  iPtsKeep.resize(nrows,1);
+  for(int j=0; j<nnew; ++j) {
+    for(int k=0; k<numVarsr; ++k)
+      XRreorder(k,nold+j)=xr_new(k,j)=XR(k,num_old+j);
+    iPtsKeep(nold+j,0)=num_old+j;
+  }
+  numWholePointsKeep=numPointsKeep=numRowsR=nrows;
+
+  //r12 holds the correlations between all retained points (rows) and 
+  //the new points (columns), split it into R12 (old to new) and R22
+  //(new to new, plus the nugget)
+  MtxDbl r12, r22(nnew,nnew);
+  correlation_matrix(r12,xr_new);
+  for(int j=0; j<nnew; ++j)
+    for(int i=0; i<nnew; ++i)
+      r22(i,j)=r12(nold+i,j);
+  for(int i=0; i<nnew; ++i)
+    r22(i,i)*=1.0+nug;
+  r12.resize(nold,nnew);
+
+  sumAbsColR.resize(nrows,1);
+  for(int j=0; j<nnew; ++j) {
+    double sum=0.0;
+    for(int i=0; i<nold; ++i) {
+      double abs_r=std::fabs(r12(i,j));
+      sumAbsColR(i,0)+=abs_r;
+      sum+=abs_r;
+    }
+    for(int i=0; i<nnew; ++i)
+      sum+=std::fabs(r22(i,j));
+    sumAbsColR(nold+j,0)=sum;
+  }
+  double one_norm_R=sumAbsColR(0,0);
+  for(int i=1; i<nrows; ++i)
+    if(one_norm_R<sumAbsColR(i,0))
+      one_norm_R=sumAbsColR(i,0);
+
+  int chol_info;
+  Chol_fact_extend(RChol,r12,r22,chol_info);
+  if(chol_info!=0)
+    return false;
+
+  int ld_RChol=RChol.getNRowsAct();
+  rcondDblWork.newSize(3*ld_RChol,1);
+  rcondIntWork.newSize(ld_RChol,1);
+  char uplo='L';
+  DPOCON_F77(&uplo,&nrows,RChol.ptr(0,0),&ld_RChol,&one_norm_R,&rcondR,
+	     rcondDblWork.ptr(0,0),rcondIntWork.ptr(0,0),&chol_info);
+  if(rcondR<=min_allowed_rcond)
+    return false;
+
+  Y.resize(nrows,1);
+  MtxDbl y_all;
+  sdBuild.getY(y_all);
+  for(int j=0; j<nnew; ++j)
+    Y(nold+j,0)=y_all(0,num_old+j);
+
+  //Poly only holds the retained trend basis functions
+  MtxDbl g;
+  eval_trend_fn(g,XRreorder);
+  Gtran.newSize(nrows,nTrend);
+  for(int itrend=0; itrend<nTrend; ++itrend)
+    for(int i=0; i<nrows; ++i)
+      Gtran(i,itrend)=g(itrend,i);
+
+  Rinv_Gtran.newSize(nrows,nTrend);
+  solve_after_Chol_fact(Rinv_Gtran,RChol,Gtran);
+  G_Rinv_Gtran.newSize(nTrend,nTrend);
+  matrix_mult(G_Rinv_Gtran,Gtran,Rinv_Gtran,0.0,1.0,'T','N');
+  G_Rinv_Gtran_Chol.copy(G_Rinv_Gtran);
+  Chol_fact_workspace(G_Rinv_Gtran_Chol,G_Rinv_Gtran_Chol_Scale,
+		      G_Rinv_Gtran_Chol_DblWork,G_Rinv_Gtran_Chol_IntWork,
+		      chol_info,rcond_G_Rinv_Gtran);
+  if((chol_info!=0)||(rcond_G_Rinv_Gtran<min_allowed_rcond))
+    return false;
+
+  //the rest is masterObjectiveAndConstraints() after the trend selection
+  double log_determinant_R = 0.0;
+  for (int i = 0; i < numRowsR; ++i) 
+    log_determinant_R += std::log(RChol(i,i)); 
+  log_determinant_R *= 2.0;
+
+  G_Rinv_Y.newSize(nTrend,1);
+  matrix_mult(G_Rinv_Y, Rinv_Gtran, Y, 0.0, 1.0, 'T', 'N');
+  betaHat.newSize(nTrend,1);
+  solve_after_Chol_fact(betaHat,G_Rinv_Gtran_Chol,G_Rinv_Y);
+  eps.copy(Y);
+  matrix_mult(eps, Gtran, betaHat, 1.0, -1.0, 'N', 'N');
+  rhs.newSize(numRowsR,1);
+  solve_after_Chol_fact(rhs,RChol,eps);
+
+#ifdef __NKM_UNBIASED_LIKE__
+  double log_determinant_G_Rinv_Gtran=0.0;
+  for (int itrend = 0; itrend < nTrend; ++itrend)
+    log_determinant_G_Rinv_Gtran += 
+      std::log(G_Rinv_Gtran_Chol(itrend,itrend)); 
+  log_determinant_G_Rinv_Gtran *= 2.0;
+  estVarianceMLE = dot_product(eps,rhs)/(numRowsR-nTrend); 
+  likelihood = -0.5*(std::log(estVarianceMLE)+(log_determinant_R+log_determinant_G_Rinv_Gtran)/(numRowsR-nTrend)); 
+#else
+  estVarianceMLE = dot_product(eps,rhs)/numRowsR;
+  likelihood = -0.5*(std::log(estVarianceMLE)+log_determinant_R/numRowsR); 
+#endif
+  obj=-likelihood;
+
+  //as at the end of create(), but sumAbsColR is kept for the next update
+  Gtran.clear();
+  G_Rinv_Gtran.clear();
+  G_Rinv_Y.clear();
+  eps.clear();
+  return true;
+}
+
+void KrigingModel::make_prediction_only()
+{
+  std::lock_guard<std::mutex> lock(*varianceStateMutex);
+  RChol.clear();
+  Rinv_Gtran.clear();
+  G_Rinv_Gtran_Chol.clear();
+  Y.clear();
+  sumAbsColR.clear();
+  ifPredictionOnly=true;
+  varianceStateReady.value.store(false,std::memory_order_release);
+}
+
+/** recompute the matrices make_prediction_only() freed, RChol, 
+    Rinv_Gtran, G_Rinv_Gtran_Chol, and Y, for the retained points in 
+    XRreorder at the current correlations (nugget, and trend basis 
+    functions).  For Kriging R is formed directly from XRreorder, for GEK
+    a copy of the model is refit (which is how create() and update() 
+    built it).  The matrices evaluate() uses aren't touched, so other 
+    threads can keep evaluating the mean while this runs.  Once the 
+    state is current a call only reads varianceStateReady; the mutex is
+    taken just to rebuild */
+void KrigingModel::restoreVarianceState() const
+{
+  if((ifPredictionOnly==false)||
+     varianceStateReady.value.load(std::memory_order_acquire))
+    return;
+  std::lock_guard<std::mutex> lock(*varianceStateMutex);
+  if(varianceStateReady.value.load(std::memory_order_relaxed))
+    return; //another thread restored it while this one waited
+
+  if(buildDerOrder==0) {
+    MtxDbl r_chol;
+    correlation_matrix(r_chol,XRreorder);
+    for(int i=0; i<numRowsR; ++i)
+      r_chol(i,i)*=1.0+nug;
+    int chol_info;
+    double rcond;
+    Chol_fact(r_chol,chol_info,rcond);
+#ifdef __KRIG_ERR_CHECK__
+    assert(chol_info==0);
+#endif
+
+    MtxDbl g, gtran(numRowsR,nTrend);
+    eval_trend_fn(g,XRreorder);
+    for(int itrend=0; itrend<nTrend; ++itrend)
+      for(int i=0; i<numRowsR; ++i)
+	gtran(i,itrend)=g(itrend,i);
+    MtxDbl rinv_gtran(numRowsR,nTrend);
+    solve_after_Chol_fact(rinv_gtran,r_chol,gtran);
+    MtxDbl g_rinv_gtran_chol(nTrend,nTrend);
+    matrix_mult(g_rinv_gtran_chol,gtran,rinv_gtran,0.0,1.0,'T','N');
+    Chol_fact(g_rinv_gtran_chol,chol_info,rcond);
+
+    MtxDbl y_all, y(numRowsR,1);
+    sdBuild.getY(y_all);
+    for(int i=0; i<numRowsR; ++i)
+      y(i,0)=y_all(0,iPtsKeep(i,0));
+
+    RChol.copy(r_chol);
+    Rinv_Gtran.copy(rinv_gtran);
+    G_Rinv_Gtran_Chol.copy(g_rinv_gtran_chol);
+    Y.copy(y);
+  }
+  else{
+    //the copy's XR still refers to this model's build data
+    KrigingModel refit(*this);
+    refit.outputLevel=SILENT_OUTPUT;
+    refit.prepareBuild();
+    refit.fitAtCorrLen();
+    assert((refit.numRowsR==numRowsR)&&(refit.nTrend==nTrend));
+    RChol.copy(refit.RChol);
+    Rinv_Gtran.copy(refit.Rinv_Gtran);
+    G_Rinv_Gtran_Chol.copy(refit.G_Rinv_Gtran_Chol);
+    Y.copy(refit.Y);
+  }
+  varianceStateReady.value.store(true,std::memory_order_release);
+}
+
+std::string KrigingModel::memory_report() const
+{
+  struct {
+    const char* name;
+    std::size_t bytes;
+  } parts[] = {
+    {"build data", sdBuild.getNBytesAlloc()},
+    {"XRreorder", XRreorder.getNBytesAlloc()},
+    {"tile constants", tileCenter.getNBytesAlloc()+
+     tileThetaXR.getNBytesAlloc()+tileXRsq.getNBytesAlloc()+
+     tileXRtran.getNBytesAlloc()},
+    {"Y", Y.getNBytesAlloc()},
+    {"Poly", Poly.getNBytesAlloc()},
+    {"betaHat", betaHat.getNBytesAlloc()},
+    {"rhs", rhs.getNBytesAlloc()},
+    {"RChol", RChol.getNBytesAlloc()},
+    {"Rinv_Gtran", Rinv_Gtran.getNBytesAlloc()},
+    {"G_Rinv_Gtran_Chol", G_Rinv_Gtran_Chol.getNBytesAlloc()},
+    {"iPtsKeep", iPtsKeep.getNBytesAlloc()},
+    {"sumAbsColR", sumAbsColR.getNBytesAlloc()},
+    {"other", 0}
+  };
+  int nparts=sizeof(parts)/sizeof(parts[0]);
+  std::size_t total=memory_bytes();
+  std::size_t listed=0;
+  for(int i=0; i<nparts-1; ++i)
+    listed+=parts[i].bytes;
+  parts[nparts-1].bytes=total-listed;
+
+  std::ostringstream oss;
+  for(int i=0; i<nparts; ++i)
+    oss << std::setw(20) << std::left << parts[i].name 
+	<< std::setw(14) << std::right << parts[i].bytes << " bytes\n";
+  oss << std::setw(20) << std::left << "total" 
+      << std::setw(14) << std::right << total << " bytes" 
+      << (ifPredictionOnly ? " (prediction only)" : "") << "\n";
+  return (oss.str());
+}
+
+std::size_t KrigingModel::memory_bytes() const
+{
+  const MtxDbl* dbl_mtx[] = {
+    &natLogCorrLen, &correlations, &XRreorder, &tileCenter, &tileThetaXR,
+    &tileXRsq, &tileXRtran, &Yall, &Y, &Gall, &Gtran,
+    &betaHat, &Z, &Ztran_theta, &deltaXR, &R, &RChol, &scaleRChol, 
+    &sumAbsColR, &oneNormR, &lapackRcondR, &rcondDblWork, &Rinv_Gtran,
+    &G_Rinv_Gtran, &G_Rinv_Gtran_Chol, &G_Rinv_Gtran_Chol_Scale,
+    &G_Rinv_Gtran_Chol_DblWork, &G_Rinv_Y, &eps, &rhs, &prevTheta,
+    &gradObj, &gradObjWeights, &con
+  };
+  const MtxInt* int_mtx[] = {
+    &Der, &iPtsKeep, &numTrend, &iTrendKeep, &Poly, &rcondIntWork, 
+    &G_Rinv_Gtran_Chol_IntWork
+  };
+  std::size_t bytes=sdBuild.getNBytesAlloc();
+  for(std::size_t i=0; i<sizeof(dbl_mtx)/sizeof(dbl_mtx[0]); ++i)
+    bytes+=dbl_mtx[i]->getNBytesAlloc();
+  for(std::size_t i=0; i<sizeof(int_mtx)/sizeof(int_mtx[0]); ++i)
+    bytes+=int_mtx[i]->getNBytesAlloc();
+  return bytes;
+}
+
 std::string KrigingModel::get_corr_func() const {
   std::ostringstream oss;
 
@@ -1006,7 +1459,7 @@ void KrigingModel::preAllocateMaxMemory() {
 // BMA TODO: combine these two functions?
 
 /// evaluate (y) the Kriging Model at a single point (xr)
-double KrigingModel::evaluate(const MtxDbl& xr)
+double KrigingModel::evaluate(const MtxDbl& xr) const
 {
   if(buildDerOrder==0) {
     //you wouldn't want to do this for Gradient Enhanced Kriging
@@ -1048,8 +1501,11 @@ double KrigingModel::evaluate(const MtxDbl& xr)
 }
 
 
-/// evaluate (y) the Kriging Model at a collection of points (xr)
-MtxDbl& KrigingModel::evaluate(MtxDbl& y, const MtxDbl& xr)
+/** evaluate (y) the Kriging Model at a collection of points (xr). The
+    points are processed in tiles small enough that the tile of r stays
+    in cache; each tile's prediction is a DGEMV against betaHat and rhs
+    rather than one dot product per point */
+MtxDbl& KrigingModel::evaluate(MtxDbl& y, const MtxDbl& xr) const
 {
   int nptsxr=xr.getNCols();
   //printf("nptsxr=%d nvarsrxr=%d",nptsxr,xr.getNCols());
@@ -1066,24 +1522,42 @@ MtxDbl& KrigingModel::evaluate(MtxDbl& y, const MtxDbl& xr)
     }
   }
   //assert(numVarsr == xr.getNRows());
-  MtxDbl g(nTrend, nptsxr), r(numRowsR, nptsxr);
 
-  if(scaler.isUnScaled()) {
-    eval_trend_fn(g, xr);
-    correlation_matrix(r, xr);
-  }
-  else{
-    MtxDbl xr_scaled(xr);
-    scaler.scaleXrOther(xr_scaled);
-    eval_trend_fn(g, xr_scaled);
-    correlation_matrix(r, xr_scaled);
-  }
+  //about 1 MB of r per tile, but never fewer than 16 points
+  int ntile_max=(1<<17)/(numRowsR>0?numRowsR:1);
+  if(ntile_max<16)
+    ntile_max=16;
+  if(ntile_max>nptsxr)
+    ntile_max=nptsxr;
+
+  MtxDbl g(nTrend, ntile_max), r(numRowsR, ntile_max);
+  MtxDbl xr_tile(numVarsr, ntile_max), y_tile(1, ntile_max);
+  for(int jstart=0; jstart<nptsxr; jstart+=ntile_max) {
+    int ntile=nptsxr-jstart;
+    if(ntile>ntile_max)
+      ntile=ntile_max;
+    xr_tile.newSize(numVarsr,ntile);
+    for(int j=0; j<ntile; ++j)
+      for(int k=0; k<numVarsr; ++k)
+	xr_tile(k,j)=xr(k,jstart+j);
+    if(!scaler.isUnScaled())
+      scaler.scaleXrOther(xr_tile);
+
+    eval_trend_fn(g, xr_tile);
+    if(buildDerOrder==0)
+      eval_kriging_correlation_tile(r, xr_tile);
+    else
+      correlation_matrix(r, xr_tile);
 
-  //y=0.0*y+1.0*betaHat^T*g => y = betaHat^T*g
-  matrix_mult(y, betaHat, g, 0.0, 1.0,'T','N'); 
+    //y=0.0*y+1.0*betaHat^T*g => y = betaHat^T*g
+    matrix_mult(y_tile, betaHat, g, 0.0, 1.0,'T','N'); 
   
-  //y=1.0*y+1.0*r*rhs where rhs=R^-1*(Y-G(XR)^T*betaHat), initial y=betaHat^T*g => y=betaHat^T*g+rhs^T*r
-  matrix_mult(y, rhs    , r, 1.0, 1.0,'T','N');
+    //y=1.0*y+1.0*r*rhs where rhs=R^-1*(Y-G(XR)^T*betaHat), initial y=betaHat^T*g => y=betaHat^T*g+rhs^T*r
+    matrix_mult(y_tile, rhs    , r, 1.0, 1.0,'T','N');
+
+    for(int j=0; j<ntile; ++j)
+      y(0,jstart+j)=y_tile(0,j);
+  }
   
   scaler.unScaleYOther(y);
 
@@ -1092,7 +1566,7 @@ MtxDbl& KrigingModel::evaluate(MtxDbl& y, const MtxDbl& xr)
   return y;
 }
 
-MtxDbl& KrigingModel::evaluate_d1y(MtxDbl& d1y, const MtxDbl& xr)
+MtxDbl& KrigingModel::evaluate_d1y(MtxDbl& d1y, const MtxDbl& xr) const
 {
   int nptsxr=xr.getNCols();
 #ifdef __KRIG_ERR_CHECK__
@@ -1134,7 +1608,10 @@ MtxDbl& KrigingModel::evaluate_d1y(MtxDbl& d1y, const MtxDbl& xr)
   MtxInt der(numVarsr,nder); 
   multi_dim_poly_power(der,numVarsr,-1); //equivalent to der.identity();
 
-  evaluate_poly_der(d1y,flyPoly,derivBetaHat,Poly,der,betaHat,xr_scaled);
+  // local work space keeps concurrent evaluations independent
+  MtxInt fly_poly;
+  MtxDbl fly_coef;
+  evaluate_poly_der(d1y,fly_poly,fly_coef,Poly,der,betaHat,xr_scaled);
   
   MtxDbl r(numRowsR,nptsxr);
   correlation_matrix(r, xr_scaled);
@@ -1172,7 +1649,7 @@ MtxDbl& KrigingModel::evaluate_d1y(MtxDbl& d1y, const MtxDbl& xr)
   return d1y;
 }
 
-MtxDbl& KrigingModel::evaluate_d2y(MtxDbl& d2y, const MtxDbl& xr)
+MtxDbl& KrigingModel::evaluate_d2y(MtxDbl& d2y, const MtxDbl& xr) const
 {
   int nptsxr=xr.getNCols();
   int nder=num_multi_dim_poly_coef(numVarsr,-2);
@@ -1196,7 +1673,10 @@ MtxDbl& KrigingModel::evaluate_d2y(MtxDbl& d2y, const MtxDbl& xr)
   MtxInt thisder(numVarsr,1);
   multi_dim_poly_power(der,numVarsr,-2); 
 
-  evaluate_poly_der(d2y,flyPoly,derivBetaHat,Poly,der,betaHat,xr_scaled);
+  // local work space keeps concurrent evaluations independent
+  MtxInt fly_poly;
+  MtxDbl fly_coef;
+  evaluate_poly_der(d2y,fly_poly,fly_coef,Poly,der,betaHat,xr_scaled);
   
   MtxDbl r(numRowsR,nptsxr);
   correlation_matrix(r, xr);
@@ -1249,15 +1729,71 @@ MtxDbl& KrigingModel::evaluate_d2y(MtxDbl& d2y, const MtxDbl& xr)
 
 
 
+/** With Q the upper left block of inv([R G^T; G 0]), i.e. 
+    Q=R^-1-R^-1*G^T*(G*R^-1*G^T)^-1*G*R^-1, the residuals of a model 
+    rebuilt without the points S are Y(S)-y_{-S}(XR(S))=Q(S,S)^-1*(Q*Y)(S)
+    (Dubrule 1983) and Q*Y=R^-1*(Y-G^T*betaHat) is rhs.  This needs one
+    inverse of R for all partitions, instead of one Kriging model build
+    per partition */
+bool KrigingModel::leaveout_estimates(std::vector<double>& estimates,
+				      const std::vector<std::vector<unsigned> >&
+				      partitions) const
+{
+  if((ifUserSpecifiedCorrLengths==false)||
+     (optimizationMethod.compare("none")!=0)||(ifChooseNug==true)||
+     (buildDerOrder!=0)||(numPointsKeep!=numPoints))
+    return false;
+
+  restoreVarianceState();
+  MtxDbl Q(RChol);
+  inverse_after_Chol_fact(Q);
+  MtxDbl G_Rinv_Gtran_inv_G_Rinv(nTrend,numRowsR);
+  solve_after_Chol_fact(G_Rinv_Gtran_inv_G_Rinv,G_Rinv_Gtran_Chol,Rinv_Gtran,
+			'T');
+  matrix_mult(Q,Rinv_Gtran,G_Rinv_Gtran_inv_G_Rinv,1.0,-1.0,'N','N');
+
+  //the build points were reordered by iPtsKeep
+  std::vector<int> ikeep(numPoints);
+  for(int ipt=0; ipt<numPoints; ++ipt)
+    ikeep[iPtsKeep(ipt,0)]=ipt;
+
+  estimates.resize(numPoints);
+  MtxDbl QSS, eS, resid;
+  for(std::size_t ipart=0; ipart<partitions.size(); ++ipart) {
+    const std::vector<unsigned>& part=partitions[ipart];
+    int nleave=static_cast<int>(part.size());
+    QSS.newSize(nleave,nleave);
+    eS.newSize(nleave,1);
+    for(int j=0; j<nleave; ++j) {
+      for(int i=0; i<nleave; ++i)
+	QSS(i,j)=Q(ikeep[part[i]],ikeep[part[j]]);
+      eS(j,0)=rhs(ikeep[part[j]],0);
+    }
+    //Q(S,S) is singular if the remaining points can't determine the trend
+    int chol_info;
+    double rcond_QSS;
+    Chol_fact(QSS,chol_info,rcond_QSS);
+    if((chol_info!=0)||!(rcond_QSS>DBL_EPSILON))
+      return false;
+    solve_after_Chol_fact(resid,QSS,eS);
+    for(int i=0; i<nleave; ++i)
+      estimates[part[i]]=
+	scaler.unScaleYOther(Y(ikeep[part[i]],0)-resid(i,0));
+  }
+  return true;
+}
+
+
 /** matrix Ops evaluation of adjusted variance at a single point
     adj_var=unadjvar*
             (1-r^T*R^-1*r+(g-G*R^-1*r)^T*(G*R^-1*G^T)^-1*(g-G*R^-1*r))
     on a point by point basis */
-double KrigingModel::eval_variance(const MtxDbl& xr)
+double KrigingModel::eval_variance(const MtxDbl& xr) const
 {
 #ifdef __KRIG_ERR_CHECK__
   assert( (numVarsr==xr.getNRows()) && (xr.getNCols()==1) );
 #endif
+  restoreVarianceState();
   MtxDbl g_minus_G_Rinv_r(nTrend,1), r(numRowsR,1);
 
   double unscaled_unadj_var=estVarianceMLE;
@@ -1312,13 +1848,14 @@ double KrigingModel::eval_variance(const MtxDbl& xr)
     adj_var=unadjvar*
             (1-r^T*R^-1*r+(g-G*R^-1*r)^T*(G*R^-1*G^T)^-1*(g-G*R^-1*r))
     on a point by point basis */
-MtxDbl& KrigingModel:: eval_variance(MtxDbl& adj_var, const MtxDbl& xr)
+MtxDbl& KrigingModel:: eval_variance(MtxDbl& adj_var, const MtxDbl& xr) const
 {
 #ifdef __KRIG_ERR_CHECK__
   assert(numVarsr==xr.getNRows()); 
 #endif
   int nptsxr=xr.getNCols();
   adj_var.newSize(1,nptsxr);
+  restoreVarianceState();
   MtxDbl g_minus_G_Rinv_r(nTrend,nptsxr), r(numRowsR,nptsxr);
 
   double unscaled_unadj_var=estVarianceMLE;
@@ -1681,6 +2218,158 @@ MtxDbl& KrigingModel::eval_kriging_correlation_matrix(MtxDbl& r, const MtxDbl& x
 }
 
 
+/** fill the members eval_kriging_correlation_tile() uses from XRreorder
+    and the correlation parameters (only those for corrFunc, the others
+    are cleared); called whenever XRreorder changes */
+void KrigingModel::prepareCorrelationTile()
+{
+  tileCenter.clear();
+  tileThetaXR.clear();
+  tileXRsq.clear();
+  tileXRtran.clear();
+  if(numPointsKeep<1)
+    return;
+
+  int i, k;
+  if(corrFunc==GAUSSIAN_CORR_FUNC) {
+    tileCenter.newSize(numVarsr,1);
+    for(k=0; k<numVarsr; ++k) {
+      double sum=0.0;
+      for(i=0; i<numPointsKeep; ++i)
+	sum+=XRreorder(k,i);
+      tileCenter(k,0)=sum/numPointsKeep;
+    }
+
+    //tileThetaXR=Theta*(XR-center), tileXRsq(i)=|XR(:,i)-center|_theta^2
+    tileThetaXR.newSize(numVarsr,numPointsKeep);
+    tileXRsq.newSize(numPointsKeep,1);
+    for(i=0; i<numPointsKeep; ++i) {
+      double sum=0.0;
+      for(k=0; k<numVarsr; ++k) {
+	double dx=XRreorder(k,i)-tileCenter(k,0);
+	tileThetaXR(k,i)=correlations(k,0)*dx;
+	sum+=tileThetaXR(k,i)*dx;
+      }
+      tileXRsq(i,0)=sum;
+    }
+  } else if((corrFunc==EXP_CORR_FUNC)||
+	    ((corrFunc==MATERN_CORR_FUNC)&&
+	     ((maternCorrFuncNu==1.5)||(maternCorrFuncNu==2.5)))) {
+    tileXRtran.newSize(numPointsKeep,numVarsr);
+    for(k=0; k<numVarsr; ++k)
+      for(i=0; i<numPointsKeep; ++i)
+	tileXRtran(i,k)=XRreorder(k,i);
+  }
+}
+
+/** r for a tile of evaluation points, see eval_kriging_correlation_matrix
+    for the correlation functions themselves.  For the Gaussian
+    correlation function the exponent is expanded as
+      -sum_k theta_k*(xr(k,j)-XR(k,i))^2 
+        = 2*(Theta*XR)^T*xr - |XR(:,i)|_theta^2 - |xr(:,j)|_theta^2
+    with both point sets shifted to the centroid of XR to limit
+    cancellation, so the cross term for the whole tile is one DGEMM.  For
+    the exponential and Matern functions the loop over dimensions is
+    outermost, running over contiguous columns of r and of a transposed
+    copy of XR.  Either way the exponentials are taken in a last tight
+    pass over each column.  The parts that depend only on XR are made 
+    once per build by prepareCorrelationTile() */
+MtxDbl& KrigingModel::eval_kriging_correlation_tile(MtxDbl& r, const MtxDbl& xr) const
+{
+  bool have_tile=(corrFunc==GAUSSIAN_CORR_FUNC)?
+    (tileXRsq.getNRows()==numPointsKeep):
+    (tileXRtran.getNRows()==numPointsKeep);
+  if((!have_tile)||(corrFunc==POW_EXP_CORR_FUNC)||
+     ((corrFunc==MATERN_CORR_FUNC)&&
+      (maternCorrFuncNu!=1.5)&&(maternCorrFuncNu!=2.5)))
+    return eval_kriging_correlation_matrix(r,xr);
+
+  int nptsxr=xr.getNCols(); //points at which we are evalutating the model
+#ifdef __KRIG_ERR_CHECK__
+  assert((xr.getNRows()==numVarsr)&&(0<nptsxr)&&(buildDerOrder==0));
+#endif
+  int i; //row index of the Kriging r matrix (also reorderd XR point index)
+  int j; //column index of the Kriging r matrix (also xr point index)
+  int k; //dimension index
+  double* rj;
+
+  if(corrFunc==GAUSSIAN_CORR_FUNC) {
+    const MtxDbl& center=tileCenter;
+    MtxDbl xr_centered(numVarsr,nptsxr);
+    for(j=0; j<nptsxr; ++j)
+      for(k=0; k<numVarsr; ++k)
+	xr_centered(k,j)=xr(k,j)-center(k,0);
+
+    //r=2*tileThetaXR^T*xr_centered, the cross term for every pair at once
+    matrix_mult(r,tileThetaXR,xr_centered,0.0,2.0,'T','N');
+
+    const double* XR_sq_ptr=tileXRsq.ptr(0,0);
+    for(j=0; j<nptsxr; ++j) {
+      double xr_sq=0.0;
+      for(k=0; k<numVarsr; ++k)
+	xr_sq+=correlations(k,0)*xr_centered(k,j)*xr_centered(k,j);
+      rj=r.ptr(0,j);
+      //rounding can leave a coincident pair's exponent slightly positive
+      for(i=0; i<numPointsKeep; ++i) {
+	double arg=rj[i]-XR_sq_ptr[i]-xr_sq;
+	rj[i]=(arg<0.0)?arg:0.0;
+      }
+      for(i=0; i<numPointsKeep; ++i)
+	rj[i]=std::exp(rj[i]);
+    }
+    return r;
+  }
+
+  r.newSize(numPointsKeep,nptsxr);
+
+  if(corrFunc==EXP_CORR_FUNC) {
+    for(j=0; j<nptsxr; ++j) {
+      rj=r.ptr(0,j);
+      for(i=0; i<numPointsKeep; ++i)
+	rj[i]=0.0;
+      for(k=0; k<numVarsr; ++k) {
+	double theta=correlations(k,0), xrkj=xr(k,j);
+	const double* XRk=tileXRtran.ptr(0,k);
+	for(i=0; i<numPointsKeep; ++i)
+	  rj[i]-=theta*std::fabs(xrkj-XRk[i]);
+      }
+      for(i=0; i<numPointsKeep; ++i)
+	rj[i]=std::exp(rj[i]);
+    }
+  } else if(corrFunc==MATERN_CORR_FUNC) {
+    //the polynomial factor of the Matern function is accumulated in coef
+    const double quad_coef=(maternCorrFuncNu==2.5)?1.0/3.0:0.0;
+    MtxDbl coef(numPointsKeep,1);
+    double* coef_ptr=coef.ptr(0,0);
+    for(j=0; j<nptsxr; ++j) {
+      rj=r.ptr(0,j);
+      for(i=0; i<numPointsKeep; ++i) {
+	rj[i]=0.0;
+	coef_ptr[i]=1.0;
+      }
+      for(k=0; k<numVarsr; ++k) {
+	double theta=correlations(k,0), xrkj=xr(k,j);
+	const double* XRk=tileXRtran.ptr(0,k);
+	for(i=0; i<numPointsKeep; ++i) {
+	  double theta_abs_dx=theta*std::fabs(xrkj-XRk[i]);
+	  coef_ptr[i]*=1.0+theta_abs_dx+quad_coef*theta_abs_dx*theta_abs_dx;
+	  rj[i]-=theta_abs_dx;
+	}
+      }
+      for(i=0; i<numPointsKeep; ++i)
+	rj[i]=std::exp(rj[i]);
+      for(i=0; i<numPointsKeep; ++i)
+	rj[i]*=coef_ptr[i];
+    }
+  } else{
+    std::cerr << "unknown corrFunc in MtxDbl& eval_kriging_correlation_tile(MtxDbl& r, const MtxDbl& xr) const\n";
+    assert(false);
+  }
+
+  return r;
+}
+
+
 /** the inline function 
     MtxDbl& KrigingModel::correlation_matrix(MtxDbl& r, const MtxDbl& xr) const
     calls either 
@@ -2925,33 +3614,15 @@ MtxDbl& KrigingModel::eval_gek_d2correlation_matrix_dxIdxJ(MtxDbl& d2r, const Mt
 
 
 
-/** this function is typically used during emulator construction, the below
-    the diagonal portion of R = exp(Z^T*theta), where R is symmetric with 1's 
-    on the diagonal, theta is the vector of correlations and the Z matrix is 
-    defined as Z(k,ij)=-(XR(k,i)-XR(k,j))^2 where ij counts downward within
-    columns of R starting from the element below the diagonal and continues 
-    from one column to the next, Z^T*theta is matrix vector multiplication to 
-    be performed efficiently by BLAS, V=Z^T*theta is a vector with 
-    nchoosek(numPoints,2) elements.  We need to copy exp(V(ij)) to R(i,j) 
-    and R(j,i) to produce R. The Z matrix is produced by 
-    KrigingModel::gen_Z_matrix()     KRD wrote this */
+/** this function is typically used during emulator construction, it
+    forms R for the correlation parameters theta: the Kriging portion (all
+    of R for Kriging, the upper-left submatrix for GEK) comes from either
+    Z_kriging_correlation_matrix() or, if the stream_correlation_matrix
+    option was given, stream_kriging_correlation_matrix(); both produce
+    the same R.  KRD wrote this */
 void KrigingModel::correlation_matrix(const MtxDbl& theta)
 {
-  int ncolsZ=Z.getNCols();
-  //printf("nrowsZ=%d; numPoints=%d; ''half'' numPoints^2=%d; numVarsr=%d; theta.getNRows()=%d\n",
-  //	 ncolsZ,numPoints,nchoosek(numPoints,2),numVarsr,theta.getNRows());
-  //fflush(stdout);
-#ifdef __KRIG_ERR_CHECK__
-  assert((ncolsZ==nchoosek(numPoints,2))&&
-	 (numVarsr==Z.getNRows())&&
-	 (numVarsr==theta.getNRows())&&
-	 (1==theta.getNCols()));
-#endif
-  
-  Ztran_theta.newSize(ncolsZ,1); //Z transpose because subsequent access of a 
-  //column vector should be marginally faster than a row vector
-  matrix_mult(Ztran_theta,Z,theta,0.0,1.0,'T','N');
-
+  ::surfpack::ScopedPhase phase("correlation_matrix");
   if(buildDerOrder==0)
     numRowsR=numPoints;
   else if(buildDerOrder==1)
@@ -2963,76 +3634,10 @@ void KrigingModel::correlation_matrix(const MtxDbl& theta)
   R.newSize(numRowsR,numRowsR);
 
   //Do the regular (Der0) Kriging Portion of the Correlation matrix first
-  double Rij_temp;
-  int ij=0;
-  if((corrFunc==GAUSSIAN_CORR_FUNC)||
-     (corrFunc==EXP_CORR_FUNC)||
-     (corrFunc==POW_EXP_CORR_FUNC)) {
-    for(int j=0; j<numPoints-1; ++j) {
-      R(j,j)=1.0;
-      for(int i=j+1; i<numPoints; ++i, ++ij) {
-	Rij_temp=std::exp(Ztran_theta(ij,0));
-	R(i,j)=Rij_temp;
-	R(j,i)=Rij_temp;
-      }
-    }
-  } else if((corrFunc==MATERN_CORR_FUNC)&&(maternCorrFuncNu==1.5)){
-    //for matern Z(k,ij)=-|XR(k,i)-XR(k,j)| we want to feed
-    //theta(k,0)*|XR(k,i)-XR(k,j)| to matern_1pt5_coef so we need to 
-    //negate the already negative quantity
-    if(numVarsr==1)
-      for(int j=0; j<numPoints-1; ++j) {
-	R(j,j)=1.0;
-	for(int i=j+1; i<numPoints; ++i, ++ij) {
-	  Rij_temp=std::exp(Ztran_theta(ij,0))*
-	    matern_1pt5_coef(-Ztran_theta(ij,0));
-	  R(i,j)=Rij_temp;
-	  R(j,i)=Rij_temp;
-	}
-      }
-    else 
-      for(int j=0; j<numPoints-1; ++j) {
-	R(j,j)=1.0;
-	for(int i=j+1; i<numPoints; ++i, ++ij) {
-	  Rij_temp=std::exp(Ztran_theta(ij,0))*
-	    matern_1pt5_coef(-Z(0,ij)*theta(0,0));
-	  for(int k=1; k<numVarsr; ++k) 
-	    Rij_temp*=matern_1pt5_coef(-Z(k,ij)*theta(k,0));
-	  R(i,j)=Rij_temp;
-	  R(j,i)=Rij_temp;
-	}
-      }    
-  } else if((corrFunc==MATERN_CORR_FUNC)&&(maternCorrFuncNu==2.5)){
-    //for matern Z(k,ij)=-|XR(k,i)-XR(k,j)| we want to feed
-    //theta(k,0)*|XR(k,i)-XR(k,j)| to matern_2pt5_coef so we need to 
-    //negate the already negative quantity
-    if(numVarsr==1)
-      for(int j=0; j<numPoints-1; ++j) {
-	R(j,j)=1.0;
-	for(int i=j+1; i<numPoints; ++i, ++ij) {
-	  Rij_temp=std::exp(Ztran_theta(ij,0))*
-	    matern_2pt5_coef(-Ztran_theta(ij,0));
-	  R(i,j)=Rij_temp;
-	  R(j,i)=Rij_temp;
-	}
-      }
-    else 
-      for(int j=0; j<numPoints-1; ++j) {
-	R(j,j)=1.0;
-	for(int i=j+1; i<numPoints; ++i, ++ij) {
-	  Rij_temp=std::exp(Ztran_theta(ij,0))*
-	    matern_2pt5_coef(-Z(0,ij)*theta(0,0));
-	  for(int k=1; k<numVarsr; ++k) 
-	    Rij_temp*=matern_2pt5_coef(-Z(k,ij)*theta(k,0));
-	  R(i,j)=Rij_temp;
-	  R(j,i)=Rij_temp;
-	}
-      }    
-  }else{
-    std::cerr << "unknown corrFunc in void KrigingModel::correlation_matrix(const MtxDbl& theta)\n";
-    assert(false);
-  }
-  R(numPoints-1,numPoints-1)=1.0;
+  if(ifStreamR==true)
+    stream_kriging_correlation_matrix(theta);
+  else
+    Z_kriging_correlation_matrix(theta);
 
   /*
   FILE *fp=fopen("km_Rmat_check.txt","w");
@@ -3392,6 +3997,195 @@ void KrigingModel::correlation_matrix(const MtxDbl& theta)
   return; 
 }
 
+
+/** the Kriging portion of R, i.e. the below
+    the diagonal portion of R = exp(Z^T*theta), where R is symmetric with 1's 
+    on the diagonal, theta is the vector of correlations and the Z matrix is 
+    defined as Z(k,ij)=-(XR(k,i)-XR(k,j))^2 where ij counts downward within
+    columns of R starting from the element below the diagonal and continues 
+    from one column to the next, Z^T*theta is matrix vector multiplication,
+    V=Z^T*theta is a vector with 
+    nchoosek(numPoints,2) elements.  We need to copy exp(V(ij)) to R(i,j) 
+    and R(j,i) to produce R. The Z matrix is produced by 
+    KrigingModel::gen_Z_matrix()     KRD wrote this */
+void KrigingModel::Z_kriging_correlation_matrix(const MtxDbl& theta)
+{
+  int ncolsZ=Z.getNCols();
+  //printf("nrowsZ=%d; numPoints=%d; ''half'' numPoints^2=%d; numVarsr=%d; theta.getNRows()=%d\n",
+  //	 ncolsZ,numPoints,nchoosek(numPoints,2),numVarsr,theta.getNRows());
+  //fflush(stdout);
+#ifdef __KRIG_ERR_CHECK__
+  assert((ncolsZ==nchoosek(numPoints,2))&&
+	 (numVarsr==Z.getNRows())&&
+	 (numVarsr==theta.getNRows())&&
+	 (1==theta.getNCols()));
+#endif
+  
+  Ztran_theta.newSize(ncolsZ,1); //Z transpose because subsequent access of a 
+  //column vector should be marginally faster than a row vector
+  //summed in increasing k rather than by DGEMV, so that this and 
+  //stream_kriging_correlation_matrix() give the same R whatever BLAS 
+  //is linked
+  double sum_z_theta;
+  for(int ij=0; ij<ncolsZ; ++ij) {
+    sum_z_theta=0.0;
+    for(int k=0; k<numVarsr; ++k)
+      sum_z_theta+=Z(k,ij)*theta(k,0);
+    Ztran_theta(ij,0)=sum_z_theta;
+  }
+
+  double Rij_temp;
+  int ij=0;
+  if((corrFunc==GAUSSIAN_CORR_FUNC)||
+     (corrFunc==EXP_CORR_FUNC)||
+     (corrFunc==POW_EXP_CORR_FUNC)) {
+    for(int j=0; j<numPoints-1; ++j) {
+      R(j,j)=1.0;
+      for(int i=j+1; i<numPoints; ++i, ++ij) {
+	Rij_temp=std::exp(Ztran_theta(ij,0));
+	R(i,j)=Rij_temp;
+	R(j,i)=Rij_temp;
+      }
+    }
+  } else if((corrFunc==MATERN_CORR_FUNC)&&(maternCorrFuncNu==1.5)){
+    //for matern Z(k,ij)=-|XR(k,i)-XR(k,j)| we want to feed
+    //theta(k,0)*|XR(k,i)-XR(k,j)| to matern_1pt5_coef so we need to 
+    //negate the already negative quantity
+    if(numVarsr==1)
+      for(int j=0; j<numPoints-1; ++j) {
+	R(j,j)=1.0;
+	for(int i=j+1; i<numPoints; ++i, ++ij) {
+	  Rij_temp=std::exp(Ztran_theta(ij,0))*
+	    matern_1pt5_coef(-Ztran_theta(ij,0));
+	  R(i,j)=Rij_temp;
+	  R(j,i)=Rij_temp;
+	}
+      }
+    else 
+      for(int j=0; j<numPoints-1; ++j) {
+	R(j,j)=1.0;
+	for(int i=j+1; i<numPoints; ++i, ++ij) {
+	  Rij_temp=std::exp(Ztran_theta(ij,0))*
+	    matern_1pt5_coef(-Z(0,ij)*theta(0,0));
+	  for(int k=1; k<numVarsr; ++k) 
+	    Rij_temp*=matern_1pt5_coef(-Z(k,ij)*theta(k,0));
+	  R(i,j)=Rij_temp;
+	  R(j,i)=Rij_temp;
+	}
+      }    
+  } else if((corrFunc==MATERN_CORR_FUNC)&&(maternCorrFuncNu==2.5)){
+    //for matern Z(k,ij)=-|XR(k,i)-XR(k,j)| we want to feed
+    //theta(k,0)*|XR(k,i)-XR(k,j)| to matern_2pt5_coef so we need to 
+    //negate the already negative quantity
+    if(numVarsr==1)
+      for(int j=0; j<numPoints-1; ++j) {
+	R(j,j)=1.0;
+	for(int i=j+1; i<numPoints; ++i, ++ij) {
+	  Rij_temp=std::exp(Ztran_theta(ij,0))*
+	    matern_2pt5_coef(-Ztran_theta(ij,0));
+	  R(i,j)=Rij_temp;
+	  R(j,i)=Rij_temp;
+	}
+      }
+    else 
+      for(int j=0; j<numPoints-1; ++j) {
+	R(j,j)=1.0;
+	for(int i=j+1; i<numPoints; ++i, ++ij) {
+	  Rij_temp=std::exp(Ztran_theta(ij,0))*
+	    matern_2pt5_coef(-Z(0,ij)*theta(0,0));
+	  for(int k=1; k<numVarsr; ++k) 
+	    Rij_temp*=matern_2pt5_coef(-Z(k,ij)*theta(k,0));
+	  R(i,j)=Rij_temp;
+	  R(j,i)=Rij_temp;
+	}
+      }    
+  }else{
+    std::cerr << "unknown corrFunc in void KrigingModel::Z_kriging_correlation_matrix(const MtxDbl& theta)\n";
+    assert(false);
+  }
+  R(numPoints-1,numPoints-1)=1.0;
+}
+
+
+/** the Kriging portion of R computed directly from XR and theta, without
+    the Z matrix or Ztran_theta, so the only nchoosek(numPoints,2) sized 
+    storage is R itself.  The strictly lower triangle is cut into square
+    tiles that are handed out to up to numThreads threads (when numPoints
+    is large enough to repay starting them); each entry is an independent function of two
+    columns of XR.  Each exponent sums Z(k,ij)*theta(k,0) in increasing k
+    as Z_kriging_correlation_matrix() does, so R is unchanged */
+void KrigingModel::stream_kriging_correlation_matrix(const MtxDbl& theta)
+{
+#ifdef __KRIG_ERR_CHECK__
+  assert((numVarsr==theta.getNRows())&&(1==theta.getNCols()));
+#endif
+  const int tile_size=64;
+  int ntiles=(numPoints+tile_size-1)/tile_size;
+  //tiles on or below the diagonal, column of tiles by column of tiles
+  std::vector<std::pair<int,int> > tiles;
+  tiles.reserve(ntiles*(ntiles+1)/2);
+  for(int jtile=0; jtile<ntiles; ++jtile)
+    for(int itile=jtile; itile<ntiles; ++itile)
+      tiles.push_back(std::make_pair(itile,jtile));
+
+  // the optimizer's workers already run concurrently, so parallel_for
+  // computes their tiles serially
+  unsigned num_threads=(numPoints>=512) ? static_cast<unsigned>(numThreads) : 1;
+  ::surfpack::parallel_for(static_cast<unsigned>(tiles.size()), num_threads,
+    [&](unsigned itile, unsigned) {
+      stream_kriging_correlation_tile(theta,tiles[itile].first,
+				      tiles[itile].second,tile_size);
+    });
+}
+
+/** fill the (itile,jtile) tile of the Kriging portion of R, and its
+    mirror image above the diagonal, for stream_kriging_correlation_matrix;
+    the Z(k,ij) terms are formed exactly as in gen_Z_matrix() */
+void KrigingModel::stream_kriging_correlation_tile(const MtxDbl& theta,
+						   int itile, int jtile,
+						   int tile_size)
+{
+  int jbegin=jtile*tile_size;
+  int jend=std::min(jbegin+tile_size,numPoints);
+  int iend=std::min((itile+1)*tile_size,numPoints);
+  double dXR, sum_z_theta, Rij_temp;
+  for(int j=jbegin; j<jend; ++j) {
+    if(itile==jtile)
+      R(j,j)=1.0;
+    int ibegin=std::max(itile*tile_size,j+1);
+    for(int i=ibegin; i<iend; ++i) {
+      sum_z_theta=0.0;
+      for(int k=0; k<numVarsr; ++k) {
+	dXR=XR(k,i)-XR(k,j);
+	if(corrFunc==GAUSSIAN_CORR_FUNC)
+	  sum_z_theta+=(-dXR*dXR)*theta(k,0);
+	else if(corrFunc==POW_EXP_CORR_FUNC)
+	  sum_z_theta+=
+	    (-std::pow(std::fabs(dXR),powExpCorrFuncPow))*theta(k,0);
+	else
+	  sum_z_theta+=(-std::fabs(dXR))*theta(k,0);
+      }
+      Rij_temp=std::exp(sum_z_theta);
+      if(corrFunc==MATERN_CORR_FUNC) {
+	//as in Z_kriging_correlation_matrix, one coefficient per dimension
+	//except in 1D, where the exponent already is the scaled distance
+	if(numVarsr==1)
+	  Rij_temp*=(maternCorrFuncNu==1.5)?matern_1pt5_coef(-sum_z_theta):
+	    matern_2pt5_coef(-sum_z_theta);
+	else
+	  for(int k=0; k<numVarsr; ++k) {
+	    double theta_abs_dx=std::fabs(XR(k,i)-XR(k,j))*theta(k,0);
+	    Rij_temp*=(maternCorrFuncNu==1.5)?matern_1pt5_coef(theta_abs_dx):
+	      matern_2pt5_coef(theta_abs_dx);
+	  }
+      }
+      R(i,j)=Rij_temp;
+      R(j,i)=Rij_temp;
+    }
+  }
+}
+
+
 /** the Z matrix is defined as Z(k,ij)=-(XR(i,k)-XR(j,k))^2 where
     ij=i+j*XR.getNRows(), it enables the efficient repeated calculation
     of the R matrix during model construction:
@@ -3409,6 +4203,18 @@ MtxDbl& KrigingModel::gen_Z_matrix()
   assert((XR.getNRows()==numVarsr)&&(XR.getNCols()==numPoints));
 #endif
   int ncolsZ=nchoosek(numPoints,2);
+  if(ifStreamR==true) {
+    //R is computed directly from XR, only GEK needs deltaXR
+    if(buildDerOrder>0) {
+      deltaXR.newSize(ncolsZ,numVarsr);
+      int ij=0;
+      for(int j=0; j<numPoints-1; ++j)
+	for(int i=j+1; i<numPoints; ++i, ++ij)
+	  for(int k=0; k<numVarsr; k++)
+	    deltaXR(ij,k)=XR(k,i)-XR(k,j);
+    }
+    return Z;
+  }
   Z.newSize(numVarsr,ncolsZ);
 
   if(buildDerOrder>0) {
@@ -3539,6 +4345,7 @@ void KrigingModel::reorderCopyRtoRChol() {
 }
 
 void KrigingModel::nuggetSelectingCholR(){
+  ::surfpack::ScopedPhase phase("cholesky_r");
   if(buildDerOrder==0)
     numExtraDerKeep=0;
   else if(buildDerOrder==1)
@@ -3630,6 +4437,7 @@ void KrigingModel::nuggetSelectingCholR(){
    discontinutity it is highly likely that at least one of them 
    will get discarded */
 void KrigingModel::equationSelectingCholR(){ 
+  ::surfpack::ScopedPhase phase("cholesky_r");
   if(!((buildDerOrder==0)||(buildDerOrder==1))) {
     std::cerr << "buildDerOrder=" << buildDerOrder 
 	      << " in void KrigingModel::equationSelectingCholR().  "
@@ -3738,6 +4546,7 @@ void KrigingModel::equationSelectingCholR(){
   NKM_PIVOTCHOL_F77(&uplo, &numPoints, RChol.ptr(0,0), &ld_RChol,
     		iPtsKeep.ptr(0,0), &numPointsKeep, &min_allowed_rcond, 
 		&info); 
+  ::surfpack::profile_count("factorizations");
 
   //for(int ipt=0; ipt<numPoints; ++ipt)
   //printf("F77 iPtsKeep(%d)=%d\n",ipt,iPtsKeep(ipt,0));
@@ -3878,6 +4687,7 @@ void KrigingModel::equationSelectingCholR(){
     //the pivoting cholesky above) 
     uplo='L';
     DPOTRF_F77(&uplo,&numEqnAvail,RChol.ptr(0,0),&ld_RChol,&info);
+    ::surfpack::profile_count("factorizations");
   
     //Kriging already has the rcondR so to get GEK into an equivalent
     //state we will feed LAPACK the one norm of the full GEK R (after 
@@ -4251,6 +5061,7 @@ void KrigingModel::trendSelectingPivotedCholesky(){
   NKM_PIVOTCHOL_F77(&uplo, &nTrend, G_Rinv_Gtran_Chol.ptr(0,0),
 		&ld_G_Rinv_Gtran_Chol, iTrendKeep.ptr(0,0), &num_trend_keep, 
 		&min_allowed_rcond, &info); 
+  ::surfpack::profile_count("factorizations");
   
   nTrend=num_trend_keep; //this is the maximum number of trend functions
   //we could keep, we might not be able to keep this many
@@ -4425,9 +5236,9 @@ void KrigingModel::masterObjectiveAndConstraints(const MtxDbl& theta, int obj_de
   // if(obj_der_mode=1) (1=2^0=> 0th derivative) calculate objective function
   // if(con_der_mode=1) (1=2^0=> 0th derivative) calculate the constraint 
   //functions
-  // ERROR if(con_der_mode>=2) (2=2^1 = 1st derivative) this function does not
-  //                           support analytical derivatives of the objective
-  //                           function 
+  // if(obj_der_mode>=2) (2=2^1 = 1st derivative) also calculate the 
+  //                     analytical gradient of the objective function, 
+  //                     Kriging only (maxObjDerMode==3)
   // ERROR if(con_der_mode>=2) (2=2^1 = 1st derivative) this function does not
   //                           support analytical derivatives of the constraint
   //                           function 
@@ -4436,10 +5247,11 @@ void KrigingModel::masterObjectiveAndConstraints(const MtxDbl& theta, int obj_de
   //maxConDerMode,con_der_mode,maxObjDerMode,obj_der_mode);
 
   //might want to replace this with a thrown exception
-  assert((maxObjDerMode<=1)&&(maxConDerMode<=1)&&
+  assert((maxObjDerMode<=3)&&(maxConDerMode<=1)&&
 	 (0<=obj_der_mode)&&(obj_der_mode<=maxObjDerMode)&&
 	 (0<=con_der_mode)&&(con_der_mode<=maxConDerMode)&&
 	 ((1<=obj_der_mode)||(1<=con_der_mode))); 
+  ::surfpack::profile_count("objective_evaluations");
 
   //if theta was the same as the last time we called this function than we can reuse some of the things we calculated last time
   
@@ -4666,6 +5478,17 @@ void KrigingModel::masterObjectiveAndConstraints(const MtxDbl& theta, int obj_de
     }
   }
 
+  if((prevObjDerMode<3)&&(2<=obj_der_mode)) {
+    //the analytical gradient of the objective reuses the factorizations
+    //of R and G*R^-1*G^T we just made (or stored from last time)
+    objectiveGradient(theta);
+    prevObjDerMode=3; //increase prevObjDerMode to the current value
+    if(con_der_mode<=prevConDerMode) {
+      //we have everything we need so exit early
+      return;
+    }
+  }
+
   if((prevConDerMode==0)&&(1<=con_der_mode)) {
     //calculate the constraint on reciprocal condition number that ensures 
     //that the correlation matrix is well conditioned. 
@@ -4700,12 +5523,82 @@ void KrigingModel::masterObjectiveAndConstraints(const MtxDbl& theta, int obj_de
 }
 
 
+/** For the "per equation" negative log likelihood, with 
+    P=R^-1-R^-1*G^T*(G*R^-1*G^T)^-1*G*R^-1 (the trend is estimated by
+    generalized least squares) and rhs=P*Y, the derivative with respect to
+    any correlation parameter p is
+      d(obj)/dp = 0.5*sum_ij (P(i,j)-rhs(i)*rhs(j)/estVarianceMLE)*dR(i,j)/dp
+                  /(numRowsR-nTrend)
+    (R^-1 and numRowsR for the biased likelihood).  That costs one inverse
+    of R and O(numVarsr*numRowsR^2) operations, where finite differences
+    would cost another factorization of R per correlation length.  The 
+    retained equations, trend basis functions, and nugget are held fixed;
+    dR(i,i)/dp=0 so the nugget doesn't otherwise enter. */
+void KrigingModel::objectiveGradient(const MtxDbl& theta)
+{
+#ifdef __KRIG_ERR_CHECK__
+  assert(buildDerOrder==0);
+#endif
+  //gradObjWeights=R^-1
+  gradObjWeights.copy(RChol);
+  inverse_after_Chol_fact(gradObjWeights);
+#ifdef __NKM_UNBIASED_LIKE__
+  //gradObjWeights=P
+  MtxDbl Ginv_G_Rinv(nTrend,numRowsR);
+  solve_after_Chol_fact(Ginv_G_Rinv,G_Rinv_Gtran_Chol,Rinv_Gtran,'T');
+  matrix_mult(gradObjWeights,Rinv_Gtran,Ginv_G_Rinv,1.0,-1.0,'N','N');
+  double num_dof=static_cast<double>(numRowsR-nTrend);
+#else
+  double num_dof=static_cast<double>(numRowsR);
+#endif
+
+  //only the strictly lower triangle is needed since both matrices are 
+  //symmetric and the diagonal of dR/dp is zero, dR(i,j)/d(log(corr_len(k)))
+  //is R(i,j) times a function of the k-th component of the distance 
+  //between points i and j (the "coef" below)
+  gradObj.newSize(numVarsr,1);
+  gradObj.zero();
+  for(int j=0; j<numRowsR; ++j) {
+    int jpt=iPtsKeep(j,0);
+    double rhs_j=rhs(j,0)/estVarianceMLE;
+    for(int i=j+1; i<numRowsR; ++i) {
+      int ipt=iPtsKeep(i,0);
+      double weight=(gradObjWeights(i,j)-rhs(i,0)*rhs_j)*R(ipt,jpt);
+      if(weight==0.0) 
+	continue;
+      for(int k=0; k<numVarsr; ++k) {
+	double dist=std::fabs(XR(k,ipt)-XR(k,jpt));
+	double coef;
+	if(corrFunc==GAUSSIAN_CORR_FUNC) 
+	  coef=2.0*theta(k,0)*dist*dist;
+	else if(corrFunc==EXP_CORR_FUNC)
+	  coef=theta(k,0)*dist;
+	else if(corrFunc==POW_EXP_CORR_FUNC)
+	  coef=(dist>0.0)?powExpCorrFuncPow*theta(k,0)*
+	    std::pow(dist,powExpCorrFuncPow):0.0;
+	else{ //MATERN_CORR_FUNC
+	  double t=theta(k,0)*dist;
+	  if(maternCorrFuncNu==1.5)
+	    coef=t*t/(1.0+t);
+	  else //maternCorrFuncNu==2.5
+	    coef=t*t*(1.0+t)/(3.0+t*(3.0+t));
+	}
+	gradObj(k,0)+=weight*coef;
+      }
+    }
+  }
+  //0.5 times 2 for the upper triangle
+  for(int k=0; k<numVarsr; ++k)
+    gradObj(k,0)/=num_dof;
+}
+
+
 void KrigingModel::getRandGuess(MtxDbl& guess) const
 {
   int mymod = 1048576; //2^20 instead of 10^6 to be kind to the computer
   guess.newSize(numVarsr,1);
   for(int k=0; k<numVarsr; k++) {
-    guess(k,0) = (std::rand() % mymod)*(maxNatLogCorrLen-minNatLogCorrLen)/mymod+
+    guess(k,0) = (nkm_rand() % mymod)*(maxNatLogCorrLen-minNatLogCorrLen)/mymod+
       minNatLogCorrLen; //this returns a random nat_log_corr_len which is the space we need to search in
   }
   return;
@@ -4717,14 +5610,14 @@ void KrigingModel::getRandGuess(MtxDbl& guess) const
 void KrigingModel::set_conmin_parameters(OptimizationProblem& opt) const
 {
   //set conmin specific parameters for this problem
-  if((maxObjDerMode==1)&&(maxConDerMode==1)) {
-    //use numerical  gradients of objective and constraints
+  if(maxConDerMode==1) {
+    //use numerical gradients of objective and constraints, there is no 
+    //analytical gradient of the constraint
     opt.conminData.nfdg = 0; 
   } else {
     std::cerr << "This Kriging/Gradient-Enhanced-Kriging model does not "
-	      << "support analytical\nderivatives of the objective "
-	      << "(negative per equation log likelihood) or\nconstraint "
-	      << "(reciprocal condition number) functions." << std::endl;
+	      << "support analytical\nderivatives of the constraint "
+	      << "(reciprocal condition number) function." << std::endl;
     assert(false);
   }
 
@@ -4759,4 +5652,21 @@ void KrigingModel::set_direct_parameters(OptimizationProblem& opt) const
   opt.directData.constraintsPresent = true;
 }
 
+void KrigingModel::set_lbfgs_parameters(OptimizationProblem& opt) const
+{
+  opt.lbfgsData.numCorrections = 10;
+  opt.lbfgsData.maxIterations = maxTrials; //maximum # of iterations
+  opt.lbfgsData.gradTol = 1.0e-6;
+  opt.lbfgsData.relFunTol = 1.0e-10;
+}
+
+SurfPackModel* KrigingModel::clone_workspace() const
+{
+  KrigingModel* workspace=new KrigingModel(*this);
+  // the objective doesn't read the copy's own build data: its XR, like
+  // Y, the trend basis, and Z, still refers to this model's
+  workspace->sdBuild.clear();
+  return workspace;
+}
+
 } // end namespace nkm
@@ -17,6 +17,9 @@
 //#include "NKM_LinearRegressionModel.hpp"
 #include <map>
 #include <string>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 namespace nkm {
 
@@ -59,10 +62,17 @@ public:
 
   void set_direct_parameters(OptimizationProblem& opt) const;
 
+  void set_lbfgs_parameters(OptimizationProblem& opt) const;
+
+  /// a copy for the optimizer's threads to evaluate the objective on,
+  /// with its own R, Cholesky factor, and scratch; it shares XR, Y,
+  /// and Z (or deltaXR) with this model, so it must not outlive it
+  SurfPackModel* clone_workspace() const;
+
   // Creating KrigingModels
 
   /// Default constructor
-  KrigingModel() : ifChooseNug(false), ifAssumeRcondZero(false), ifPrescribedNug(false), nug(0.0), XR(sdBuild.xr)
+  KrigingModel() : ifChooseNug(false), ifAssumeRcondZero(false), ifStreamR(false), ifPrescribedNug(false), nug(0.0), reoptimizeEvery(0), numUpdates(0), ifPredictionOnly(false), numThreads(0), varianceStateMutex(new std::mutex), sharedBuild(new SharedBuildMatrices), XR(sdBuild.xr), Yall(sharedBuild->Yall), Gall(sharedBuild->Gall), Z(sharedBuild->Z), deltaXR(sharedBuild->deltaXR)
   { /* empty constructor */ };
   
   /// Standard KrigingModel constructor
@@ -72,28 +82,61 @@ public:
   /// function (TODO: add builtFlag for safety)
   void create();
 
+  /// add new_points (unscaled) to a created model, extending the Cholesky
+  /// factorization of R at the current correlation lengths rather than
+  /// repeating create(), except every reoptimizeEvery-th update
+  void update(const SurfData& new_points);
+
 
   // Evaluating Kriging Models
 
   /// evaluate (y) the Kriging Model at a single point (xr is a Real row vector)
-  double evaluate(const MtxDbl& xr);
+  double evaluate(const MtxDbl& xr) const;
 
   /// evaluate (y) the Kriging Model at a collection of points xr, one per row
-  MtxDbl& evaluate(MtxDbl& y, const MtxDbl& xr);
+  MtxDbl& evaluate(MtxDbl& y, const MtxDbl& xr) const;
 
   /// evaluate the KrigingModel's adjusted variance at a single point
-  double eval_variance(const MtxDbl& xr);
+  double eval_variance(const MtxDbl& xr) const;
 
   /// evaluate the KrigingModel's adjusted variance at a collection of points xr, one per row
-  MtxDbl& eval_variance(MtxDbl& adj_var, const MtxDbl& xr);
+  MtxDbl& eval_variance(MtxDbl& adj_var, const MtxDbl& xr) const;
 
   //double get_unadjusted_variance(){return (estVarianceMLE*scaler.unScaleFactorVarY());};
   
   /// evaluate the partial first derivatives with respect to xr of the models adjusted mean
-  MtxDbl& evaluate_d1y(MtxDbl& d1y, const MtxDbl& xr);
+  MtxDbl& evaluate_d1y(MtxDbl& d1y, const MtxDbl& xr) const;
 
   /// evaluate the partial second derivatives with respect to xr of the models adjusted mean... this gives you the lower triangular, including diagonal, part of the Hessian(s), with each evaluation point being a row in both xr (input) and d2y(output)
-  MtxDbl& evaluate_d2y(MtxDbl& d2y, const MtxDbl& xr);
+  MtxDbl& evaluate_d2y(MtxDbl& d2y, const MtxDbl& xr) const;
+
+  /** closed form (Dubrule) estimates of the output at each build point
+      when the model is rebuilt without the partition of build points
+      containing it, with the correlation lengths and nugget held fixed.
+      Returns false, leaving estimates unspecified, when the correlation
+      lengths or nugget were chosen from the data, for Gradient Enhanced
+      Kriging, or when points were dropped for ill-conditioning; then
+      the model must really be rebuilt */
+  bool leaveout_estimates(std::vector<double>& estimates,
+			  const std::vector<std::vector<unsigned> >& 
+			  partitions) const;
+
+  /** free the matrices that only eval_variance(), leaveout_estimates(),
+      and update() use (RChol, Rinv_Gtran, G_Rinv_Gtran_Chol, and Y),
+      keeping just what evaluate() and its derivatives need: XRreorder,
+      correlations, Poly, betaHat, and rhs.  The freed matrices are
+      recomputed (once) the next time one of those functions is called.
+      create() and update() do this themselves if the prediction_only
+      option was given.  Not safe while other threads use the model */
+  void make_prediction_only();
+
+  /// the bytes of memory allocated to each of the model's matrices and
+  /// to its build data, one per line, and their total
+  std::string memory_report() const;
+
+  /// the total bytes of memory allocated to the model's matrices and to
+  /// its build data
+  std::size_t memory_bytes() const;
 
   // Helpers for solving correlation optimization problems
 
@@ -138,6 +181,24 @@ public:
     return;
   };
 
+  /// objective and its analytical gradient with respect to the natural
+  /// log of the correlation lengths (Kriging, not Gradient Enhanced Kriging)
+  inline void objectiveAndGradient(double& obj_out, MtxDbl& grad_obj_out,
+				   const MtxDbl& nat_log_corr_len) {
+    MtxDbl corr_len(numTheta,1);
+    for(int i=0; i<numTheta; ++i)
+      corr_len(i,0)=std::exp(nat_log_corr_len(i,0));
+    correlations.newSize(numTheta,1);
+    get_theta_from_corr_len(correlations,corr_len);
+    masterObjectiveAndConstraints(correlations, 3, 0);
+    obj_out=obj;
+    grad_obj_out.newSize(numTheta,1);
+    if(obj<HUGE_VAL)
+      grad_obj_out.copy(gradObj);
+    else
+      grad_obj_out.zero(); //R was singular, there is no gradient to speak of
+  };
+
   /// return the Number of Trend functions, the trend is represented by an
   /// arbitrary order multidimensional polynomial, individual trend functions
   /// are the separate additive terms in that multidimensional polynomial
@@ -156,6 +217,10 @@ public:
   void getRandGuess(MtxDbl& guess) const;
 
 private:
+
+  /// only clone_workspace() copies a model; the copy shares 
+  /// sharedBuild (so Yall, Gall, Z, and deltaXR) with the original
+  KrigingModel(const KrigingModel& other) = default;
   
 #ifdef SURFPACK_HAVE_BOOST_SERIALIZATION
   // allow serializers access to private data
@@ -166,12 +231,22 @@ private:
 #endif
 
   // helper functions
+  void prepareBuild();
+  void fitAtCorrLen();
+  bool extendCholR(int num_old);
+  void prepareCorrelationTile();
+  void restoreVarianceState() const;
   void preAllocateMaxMemory();
   void reorderCopyRtoRChol();
   void nuggetSelectingCholR();
   void equationSelectingCholR();
   void trendSelectingPivotedCholesky();
 
+  /// fill gradObj with the analytical gradient of the objective with
+  /// respect to the natural log of the correlation lengths, at the theta
+  /// the objective was just computed for
+  void objectiveGradient(const MtxDbl& theta);
+
   /// this function calculates the objective function (negative log
   /// likelihood) and/or the constraint functions and/or their analytical
   /// gradients and/or the hessian of the objective function using a 
@@ -186,15 +261,18 @@ private:
 
   //void set_conmin_parameters(OptimizationProblem& opt) const;
 
-  /// evaluate the trend function g(xr), using class member Poly
-  inline MtxDbl& eval_trend_fn(MtxDbl& g, const MtxDbl& xr) {
-    return (evaluate_poly_basis(g, flyPoly, Poly, xr));
+  /// evaluate the trend function g(xr), using class member Poly; the
+  /// flypoly work space is local so concurrent evaluations don't collide
+  inline MtxDbl& eval_trend_fn(MtxDbl& g, const MtxDbl& xr) const {
+    MtxInt fly_poly;
+    return (evaluate_poly_basis(g, fly_poly, Poly, xr));
   }
 
   inline MtxDbl& eval_der_trend_fn(MtxDbl& dg, const MtxInt& der, 
-				   const MtxDbl& xr) {
-    return (evaluate_poly_der_basis(dg, flyPoly, derivBetaHat, Poly, der, xr));
-    return dg;
+				   const MtxDbl& xr) const {
+    MtxInt fly_poly;
+    MtxDbl fly_coef;
+    return (evaluate_poly_der_basis(dg, fly_poly, fly_coef, Poly, der, xr));
   }
 
 
@@ -251,6 +329,12 @@ private:
 
   MtxDbl& eval_kriging_correlation_matrix(MtxDbl& r, const MtxDbl& xr) const;
   MtxDbl& eval_gek_correlation_matrix(MtxDbl& r, const MtxDbl& xr) const;
+  /** same r as eval_kriging_correlation_matrix but organized for one tile
+      of many evaluation points: the Gaussian exponents come from a single
+      DGEMM, the exponential and Matern ones from contiguous passes over
+      each column of r, and the exponentials are taken last in one sweep.
+      Powered exponential falls back to eval_kriging_correlation_matrix */
+  MtxDbl& eval_kriging_correlation_tile(MtxDbl& r, const MtxDbl& xr) const;
   /** r(i,j)=corr_func(xr(i,:),XR(j,:);theta(:)) choices for correlation 
       function are gaussian, exponential, powered exponential with 1<power<2, 
       and matern with nu=1.5 or 2.5 (gaussian and exponential are pulled out
@@ -345,6 +429,17 @@ private:
       inputs of the correlation function */
   void correlation_matrix(const MtxDbl& corr_vec);
 
+  /// the Kriging portion of R from exp(Z^T*theta)
+  void Z_kriging_correlation_matrix(const MtxDbl& theta);
+
+  /** the Kriging portion of R computed tile by tile directly from XR, so
+      neither Z nor Ztran_theta is needed, used when ifStreamR==true */
+  void stream_kriging_correlation_matrix(const MtxDbl& theta);
+
+  /// one tile of stream_kriging_correlation_matrix()
+  void stream_kriging_correlation_tile(const MtxDbl& theta, int itile, 
+				       int jtile, int tile_size);
+
   /** this function applies the nugget to the R matrix (a member variable)
       and stores the result in R (another member variable), i.e. it adds 
       nug to the diagonal of R. The convention is that capital matrices 
@@ -370,7 +465,8 @@ private:
       capital matrices are for the data the model is built from, lower 
       case matrices are for arbitrary points to evaluate the model at, 
       the Z and XR matrices are member variables so they don't need to be 
-      passed in */
+      passed in.  When ifStreamR==true Z is left empty and only deltaXR 
+      (for GEK) is formed */
   MtxDbl& gen_Z_matrix();
   
   /** the order of the derivatives this Kriging Model was built for
@@ -504,6 +600,13 @@ private:
       Enhanced Kriging if you would like to add a nugget.*/
   bool ifAssumeRcondZero;
 
+  /** if ifStreamR==true the Kriging R matrix is computed tile by tile
+      (in parallel for large numPoints) directly from XR, instead of from
+      the Z matrix; this avoids storing Z and Ztran_theta, which together
+      take (numVarsr+1)/2 times as much memory as R itself, it is set by
+      the "stream_correlation_matrix" option */
+  bool ifStreamR;
+
   /** if ifPrescribedNug==true then the user has prescribed a nugget, 
       (think of the nugget a measurement noise term, it should be 
       roughly the variance of the measurement noise divided by the 
@@ -520,6 +623,44 @@ private:
       choose the smallest nugget needed to fix ill conditioning */
   double nug;
 
+  /** update() runs create() again, reoptimizing the correlation lengths,
+      every reoptimizeEvery-th time it is called (never if it is zero, the
+      default), it is set by the "reoptimize_every" option */
+  int reoptimizeEvery;
+
+  /// the number of times update() has been called
+  int numUpdates;
+
+  /** true if create() and update() call make_prediction_only(), it is 
+      set by the "prediction_only" option (or by loading a model saved
+      without the variance state) */
+  bool ifPredictionOnly;
+
+  /** the most threads that create() evaluates the likelihood on and
+      that R is streamed with, 0 (the default) for 
+      surfpack::default_num_threads(), it is set by the "num_threads" 
+      option */
+  int numThreads;
+
+  /** serializes the rebuild in restoreVarianceState() and 
+      make_prediction_only(), shared with clone_workspace() copies (a
+      std::mutex can't be copied) */
+  std::shared_ptr<std::mutex> varianceStateMutex;
+
+  /// an atomic flag that copies its value, so the model stays copyable
+  struct CopyableAtomicFlag {
+    CopyableAtomicFlag() : value(false) { }
+    CopyableAtomicFlag(const CopyableAtomicFlag& other) 
+      : value(other.value.load()) { }
+    std::atomic<bool> value;
+  };
+
+  /** true once a prediction only model's variance state is current, set
+      (release) at the end of the rebuild so restoreVarianceState() can 
+      check it (acquire) without locking varianceStateMutex on every 
+      eval_variance() call; make_prediction_only() clears it */
+  mutable CopyableAtomicFlag varianceStateReady;
+
   /// the number of build points available
   int numPoints;
 
@@ -562,6 +703,18 @@ private:
   /// if we have an Anchor point what is its index?
   int  iAnchorPoint;
 
+  /** the matrices formed from the build data, before the correlation
+      lengths are optimized, that the objective function only reads;
+      clone_workspace() copies share them instead of copying Z, which
+      has numVarsr*nchoosek(numPoints,2) elements */
+  struct SharedBuildMatrices {
+    MtxDbl Yall;
+    MtxDbl Gall;
+    MtxDbl Z;
+    MtxDbl deltaXR;
+  };
+  std::shared_ptr<SharedBuildMatrices> sharedBuild;
+
   /** the input the model was constructed from; convention is capital
       matrices are data model is built from, lower case matrices are
       arbitrary points to evaluate model at, using XR instead of X in
@@ -572,10 +725,21 @@ private:
   MtxDbl XRreorder;  //a reordered (by pivoted cholesky subset selection)
   //version of XR to make emulator EVALUATION fast
 
+  /** what eval_kriging_correlation_tile() needs of XRreorder, computed
+      once per build by prepareCorrelationTile(): for the Gaussian
+      correlation function the centroid of XRreorder, Theta*(XRreorder-
+      centroid), and the squared theta norms of its columns; for the 
+      exponential and Matern functions XRreorder transposed.  Not 
+      archived, they are recomputed when a model is loaded */
+  MtxDbl tileCenter;
+  MtxDbl tileThetaXR;
+  MtxDbl tileXRsq;
+  MtxDbl tileXRtran;
+
   /** the output at ALL available build data points, reshaped to a vector. 
       If GEK is used the function value and derivatives at a point are 
       sequential (i.e. a "whole point" at a time) */
-  MtxDbl Yall;
+  MtxDbl& Yall;
 
   /** the likely reorderd subset of build point output data that the model 
       was constructed from. If GEK is used, all but the last point is 
@@ -585,14 +749,15 @@ private:
       guaranteed to have the function value, the derivatives in the final 
       gradient were not reorderd before trailing entries were dropped). The
       convention is capital matrices are data model is built from, lower case
-      matrices are arbitrary points to evaluate model at */
-  MtxDbl Y;   
+      matrices are arbitrary points to evaluate model at.  Like RChol, it's
+      mutable so that a prediction only model can restore it on demand */
+  mutable MtxDbl Y;   
 
   /** the trend basis functions evaluated at all available build data points
       in their original order.  It has npoly rows. For Kriging it has numPoints
       columns.  For GEK it has (1+numVarsr)*numPoints columns with each "whole
       point" appearing as as 1+numVarsr sequential columns */
-  MtxDbl Gall;
+  MtxDbl& Gall;
 
   /** the transpose of the matrix of trend function evaluations at the 
       (likely reorderd) subset of points used to build the Kriging Model.  
@@ -646,25 +811,11 @@ private:
   */
   MtxInt Poly;  
 
-  /** flyPoly is "work space" for an on the fly generated 
-      represenation of polynomials that is concise/fast to evaluate,
-      particularly when a set of numPoints points is stored as a
-      matrix with numVarsr rows and numPoints columns (where each column
-      is a point).  But the "flypoly" style representation is not a
-      convenient format for performing analytical derivatives of polynomials.
-      However, converting from a "poly" representation to a "flypoly" 
-      representation is trivially easy. See comments in NKM_SurfPack.hpp 
-      for a description of the "flypoly" format. */
-  MtxInt flyPoly; 
-
   /** the vector of coefficients of the trend functions (unadjusted mean)
       betaHat=(G*R^-1*G^T)^-1*(G*R^-1*Y) i.e. the generalized by R^-1 
       least squares fit, the generalization makes it unbiased */
   MtxDbl betaHat;
 
-  /// modified coefficients for on the fly derivatives of the trend functions
-  MtxDbl derivBetaHat;
-
   /** the Z matrix, Z=Z(XR), 
       * for the Gaussian Correlation function
         Z(ij,k)=-(XR(i,k)-XR(j,k))^2
@@ -682,7 +833,7 @@ private:
       that capital matrices are for the data the model is built from, 
       lower case matrices are for arbitrary points to evaluate model at 
       size(Z)=[numVarsr nchoosek(numPoints,2)] */
-  MtxDbl Z; 
+  MtxDbl& Z; 
 
   /** working memory (so we don't constantly need to allocate and deallocate it)
       used during the calculation of R, equals Z^T*theta (matrix multiplication 
@@ -699,7 +850,7 @@ private:
       matrix sine it is "blocked" into (1+numVarsr) by (1+numVarsr) submatrices.
       The size of each submatrix is numPoints by numPoints (i.e. the size of 
       the Kriging R matrix) */
-  MtxDbl deltaXR;
+  MtxDbl& deltaXR;
 
   /** the "correlation matrix," for either regular Kriging or Gradient Enhanced
       Kriging, after possible inclusion of a nugget, use of a nugget causes 
@@ -719,8 +870,10 @@ private:
       a nugget).  Keep this around to evaluate the adjusted variance. 
       The convention is that capital matrices are for the data the model 
       is built from, lower case matrices are for arbitrary points to 
-      evaluate the model at */
-  MtxDbl RChol;
+      evaluate the model at.  It's mutable (as are Y, Rinv_Gtran and 
+      G_Rinv_Gtran_Chol) because a prediction only model recomputes it in
+      restoreVarianceState() when eval_variance() first asks for it */
+  mutable MtxDbl RChol;
 
   /** working memory for the factorization of R so that the equilibrated
       Cholesky Lapack wrapper won't have to allocate memory each time it is
@@ -758,13 +911,13 @@ private:
   double rcond_G_Rinv_Gtran;
 
   /// keep around to evaluate adjusted variance
-  MtxDbl Rinv_Gtran;
+  mutable MtxDbl Rinv_Gtran;
 
   /// don't keep arround
   MtxDbl G_Rinv_Gtran;
 
   /// keep around to evaluate adjusted variance
-  MtxDbl G_Rinv_Gtran_Chol;
+  mutable MtxDbl G_Rinv_Gtran_Chol;
 
   /** working memory used to calculate G_Rinv_Gtran_Chol efficiently (so we 
       don't have to constantly allocate/deallocate memory) */
@@ -813,6 +966,12 @@ private:
   /// the objective function for the optimization of correlation lengths, it's the negative "per equation" log likelihood function
   double obj;
 
+  /// the analytical gradient of obj with respect to the natural log of the correlation lengths
+  MtxDbl gradObj;
+
+  /// workspace for gradObj, the matrix of weights on the derivatives of R
+  MtxDbl gradObjWeights;
+
   /// the vector (a numConFunc by 1 matrix) of constraint functions for the optimization of the correlation lengths, it only needs to be a vector for compatibility with the nkm::OptimizationProblem class, otherwise it could be a double
   MtxDbl con; 
 };
@@ -873,9 +1032,7 @@ void nkm::KrigingModel::serialize(Archive & archive,
   archive & nTrend;
   //don't archive iTrendKeep, it's not needed because at the discarded terms in the trend basis function are removed from Poly at the end of create()
   archive & Poly;
-  //don't archive flyPoly, it's work space needed to efficiently evaluate a polynomial basis "on the fly" (it's a member variable only to avoid constant allocation and deallocation)
   archive & betaHat;
-  //don't archive derivBeta, it's work space needed to efficiently evaluate derivatives of a polynomial (it's a member variable only to avoid constant allocation and deallocation)
   //don't archive Z, we need it during the construction of a model but not afterward
   //don't archive Ztran_theta, we need it during the construction of a model but not afterward
   //don't archive deltaXR, we need it during the construction of a model but not afterward
@@ -908,6 +1065,13 @@ void nkm::KrigingModel::serialize(Archive & archive,
   archive & maxConDerMode;
   archive & obj;
   //don't archive con, we need it during the construction of a model but not afterward
+  //a prediction only model was saved without RChol (and the rest of the
+  //variance state), it will be recomputed if it is needed
+  if (Archive::is_loading::value) {
+    ifPredictionOnly=(numRowsR>0)&&(RChol.getNRows()==0);
+    if(buildDerOrder==0)
+      prepareCorrelationTile();
+  }
 }
 #endif
 
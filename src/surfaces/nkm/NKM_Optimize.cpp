@@ -1,7 +1,12 @@
 #include "NKM_Optimize.hpp"
 #include "NKM_SurfPackModel.hpp"
 #include <cfloat>
+#include <cmath>
+#include "SurfpackParallel.h"
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
+#include <mutex>
 
 // define array limits hard-wired in DIRECT
 // maxdim (same as maxor)
@@ -52,7 +57,18 @@ void NCSU_DIRECT_F77(int (*objfun)(int *n, double c[], double l[], double u[],
 
 namespace nkm {
 
-OptimizationProblem* OptimizationProblem::optimizationProblemInstance(NULL);
+// CONMIN and DIRECT keep their state in Fortran COMMON/SAVE data for
+// the whole optimization: CONMIN its line search between the reverse
+// communication calls, DIRECT its work arrays (too large for the stack)
+// across the evaluator callbacks.  So the lock is held from the first
+// call to the last and only one of them runs at a time per process.
+// Builds that use them aren't overlapped (see the surfpack
+// KrigingModel::concurrentBuilds); instead each spreads its batches of
+// objective evaluations over the threads (run_tasks)
+static std::mutex fortranOptimizerMutex;
+
+OptimizationProblem::~OptimizationProblem()
+{ /* empty dtor, out of line so the workspaces' type is complete */ }
 
 // TODO: move to Teuchos, use putScalar (no need for bds check)
 
@@ -78,6 +94,33 @@ void OptimizationProblem::add_initial_iterates(MtxDbl& init_iterates_to_add)
   initialIterates.putCols(init_iterates_to_add,icols);
 }
 
+/** Run task(model, i) for every i in [0, num_tasks).  The calling
+    thread works on theModel and each additional thread on a workspace
+    copy of it; when the model can't be copied everything runs here. */
+void OptimizationProblem::
+run_tasks(int num_tasks, const std::function<void(SurfPackModel&, int)>& task)
+{
+  if(num_tasks < 1)
+    return;
+  int num_threads = static_cast<int>(
+    ::surfpack::parallel_threads(numThreads < 1 ? 0 : numThreads, num_tasks));
+  // make any missing workspaces before the threads start
+  while(static_cast<int>(workspaces.size()) < num_threads-1) {
+    SurfPackModel* workspace = theModel.clone_workspace();
+    if(workspace == NULL)
+      break;
+    workspaces.push_back(std::unique_ptr<SurfPackModel>(workspace));
+  }
+  if(num_threads > static_cast<int>(workspaces.size())+1)
+    num_threads = static_cast<int>(workspaces.size())+1;
+
+  ::surfpack::parallel_for(num_tasks, num_threads, 
+    [&](unsigned i, unsigned worker) {
+      task(worker == 0 ? theModel : *workspaces[worker-1], i);
+    });
+}
+
+
 // no treatment of constraints for now
 void OptimizationProblem::multistart_conmin_optimize(int num_guesses)
 {
@@ -87,30 +130,20 @@ void OptimizationProblem::multistart_conmin_optimize(int num_guesses)
   double best_obj;
   bestFunction = DBL_MAX;
 
-  double obj;
-  MtxDbl con_out(10,1);
-
-  // iterate over provided then possibly random guesses
+  // CONMIN holds fortranOptimizerMutex for its whole run, so the starts
+  // are made one after another on theModel; threads would only queue
   for (int iguess = 0; iguess < num_guesses; ++iguess) {
-    //printf("iguess/num_guesses=%d/%d ",iguess,num_guesses);
     theModel.set_conmin_parameters(*this);
-
     retrieve_initial_iterate(iguess, guess);
-    
     // TODO: put switch here for optimizer choice
-    optimize_with_conmin(guess, best_obj);
+    optimize_with_conmin(theModel, conminData, guess, best_obj);
 
-    theModel.objectiveAndConstraints(obj,con_out,guess);
-    //printf("} obj=%g\n",best_obj);
-
-
-    // this will update guess to the best point found
+    // the first of the best starts wins
     if(best_obj < bestFunction) {
       bestFunction = best_obj;
       bestVars = guess;
     }
   }
-
 }
 
 
@@ -120,7 +153,222 @@ void OptimizationProblem::conmin_optimize()
   theModel.set_conmin_parameters(*this);
   // directly update bestVars/Functions in iteration
   retrieve_initial_iterate(0, bestVars);
-  optimize_with_conmin(bestVars, bestFunction);
+  optimize_with_conmin(theModel, conminData, bestVars, bestFunction);
+}
+
+
+// single pass of limited memory BFGS; if no initial iterate, use random guess
+void OptimizationProblem::lbfgs_optimize()
+{
+  theModel.set_lbfgs_parameters(*this);
+  // directly update bestVars/Functions in iteration
+  retrieve_initial_iterate(0, bestVars);
+  optimize_with_lbfgs(theModel, bestVars, bestFunction);
+  require_feasible_lbfgs_result();
+}
+
+
+// the rcond constraint is a hidden one, see optimize_with_lbfgs()
+void OptimizationProblem::multistart_lbfgs_optimize(int num_guesses)
+{
+  assert(num_guesses >= 1);
+
+  // draw the guesses here, in order, so the random ones don't depend on
+  // how the starts are spread over threads
+  MtxDbl guesses(numDesignVar,num_guesses);
+  MtxDbl guess(numDesignVar,1);
+  for (int iguess = 0; iguess < num_guesses; ++iguess) {
+    retrieve_initial_iterate(iguess, guess);
+    for (int i = 0; i < numDesignVar; ++i)
+      guesses(i,iguess) = guess(i,0);
+  }
+
+  theModel.set_lbfgs_parameters(*this);
+
+  // each start polishes its own column of guesses
+  MtxDbl best_objs(num_guesses,1);
+  run_tasks(num_guesses, [&](SurfPackModel& model, int iguess) {
+      MtxDbl my_guess;
+      guesses.getCols(my_guess, iguess);
+      optimize_with_lbfgs(model, my_guess, best_objs(iguess,0));
+      for (int i = 0; i < numDesignVar; ++i)
+	guesses(i,iguess) = my_guess(i,0);
+    });
+
+  // the first of the best starts wins
+  bestFunction = DBL_MAX;
+  for (int iguess = 0; iguess < num_guesses; ++iguess)
+    if(best_objs(iguess,0) < bestFunction) {
+      bestFunction = best_objs(iguess,0);
+      guesses.getCols(bestVars, iguess);
+    }
+  require_feasible_lbfgs_result();
+}
+
+
+/** Unlike CONMIN, which is left at its last iterate, L-BFGS only ever
+    moves to feasible points, so if it ended on an infeasible one then
+    every start was infeasible; refuse to hand that back as the best 
+    point */
+void OptimizationProblem::require_feasible_lbfgs_result() const
+{
+  if(!(bestFunction < HUGE_VAL)) {
+    std::cerr << "quasi_newton optimization found no correlation lengths "
+	      << "for which the\ncorrelation matrix satisfies the condition "
+	      << "number constraint; try more\nnum_starts, a nugget, or "
+	      << "another optimization_method." << std::endl;
+    throw(std::string("quasi_newton found no feasible correlation lengths"));
+  }
+}
+
+
+/** Limited memory BFGS restricted to the box [lowerBounds, upperBounds],
+    in the spirit of L-BFGS-B but simpler: variables sitting on a bound
+    that the gradient pushes against are held fixed for the iteration,
+    the two-loop recursion gives the quasi-Newton direction in the rest,
+    and a backtracking (Armijo) line search along the projection of that
+    direction onto the box picks the step.  Each iteration costs one 
+    gradient plus one objective per step tried; the model may reuse the
+    work of the last objective for the gradient at the same point. 
+    The condition number constraint is handled as a hidden constraint,
+    as DiRECT does: the model's objective is HUGE_VAL wherever the
+    constraint is violated (the reciprocal condition number of R, or of
+    G*R^-1*G^T, is at or below 1/maxCondNum), and such points are 
+    treated as failed steps, so every iterate is feasible.  An 
+    infeasible start is returned at once with final_val=HUGE_VAL. */
+void OptimizationProblem::optimize_with_lbfgs(SurfPackModel& model, 
+					      MtxDbl& x, double& final_val)
+{
+  const int n = numDesignVar;
+  const int m = (lbfgsData.numCorrections > 0) ? lbfgsData.numCorrections : 1;
+  const double sufficient_decrease = 1.0e-4;
+  const int max_backtracks = 30;
+
+  for(int i=0; i<n; ++i)
+    x(i,0) = std::min(std::max(x(i,0), lowerBounds(i,0)), upperBounds(i,0));
+
+  double f;
+  MtxDbl g(n,1);
+  model.objectiveAndGradient(f, g, x);
+  final_val = f;
+  if(!(f < HUGE_VAL))
+    return;
+
+  // the (step, change in gradient) pairs, oldest overwritten first
+  MtxDbl S(n,m), Yg(n,m), rho(m,1), alpha(m,1);
+  int num_pairs = 0, inewest = -1;
+
+  MtxDbl d(n,1), x_trial(n,1), g_trial(n,1);
+  std::vector<bool> is_free(n);
+  for(int iter=0; iter<lbfgsData.maxIterations; ++iter) {
+
+    double max_proj_grad = 0.0;
+    for(int i=0; i<n; ++i) {
+      is_free[i] = !(((x(i,0) <= lowerBounds(i,0)) && (g(i,0) > 0.0)) ||
+		     ((x(i,0) >= upperBounds(i,0)) && (g(i,0) < 0.0)));
+      if(is_free[i])
+	max_proj_grad = std::max(max_proj_grad, std::fabs(g(i,0)));
+    }
+    if(max_proj_grad <= lbfgsData.gradTol)
+      break;
+
+    // two-loop recursion for d = -H*g over the free variables
+    for(int i=0; i<n; ++i)
+      d(i,0) = is_free[i] ? g(i,0) : 0.0;
+    for(int ipair=0, k=inewest; ipair<num_pairs; ++ipair, k=(k+m-1)%m) {
+      double sq = 0.0;
+      for(int i=0; i<n; ++i)
+	sq += S(i,k)*d(i,0);
+      alpha(k,0) = rho(k,0)*sq;
+      for(int i=0; i<n; ++i)
+	d(i,0) -= alpha(k,0)*Yg(i,k);
+    }
+    double gamma;
+    if(num_pairs > 0) {
+      double sy = 0.0, yy = 0.0;
+      for(int i=0; i<n; ++i) {
+	sy += S(i,inewest)*Yg(i,inewest);
+	yy += Yg(i,inewest)*Yg(i,inewest);
+      }
+      gamma = sy/yy;
+    }
+    else
+      gamma = 1.0/max_proj_grad; // first step moves at most 1 in any variable
+    for(int i=0; i<n; ++i)
+      d(i,0) *= gamma;
+    for(int ipair=0, k=(inewest+m-num_pairs+1)%m; ipair<num_pairs; 
+	++ipair, k=(k+1)%m) {
+      double yd = 0.0;
+      for(int i=0; i<n; ++i)
+	yd += Yg(i,k)*d(i,0);
+      double beta = rho(k,0)*yd;
+      for(int i=0; i<n; ++i)
+	d(i,0) += (alpha(k,0)-beta)*S(i,k);
+    }
+    double dg = 0.0;
+    for(int i=0; i<n; ++i) {
+      d(i,0) = is_free[i] ? -d(i,0) : 0.0;
+      dg += d(i,0)*g(i,0);
+    }
+    if(!(dg < 0.0)) {
+      // not a descent direction; forget the curvature pairs and use the
+      // (scaled) steepest descent direction instead
+      num_pairs = 0;
+      inewest = -1;
+      for(int i=0; i<n; ++i)
+	d(i,0) = is_free[i] ? -g(i,0)/max_proj_grad : 0.0;
+    }
+
+    // backtracking line search along the projected path
+    double step = 1.0, f_trial = HUGE_VAL;
+    bool accepted = false;
+    for(int ibt=0; ibt<max_backtracks; ++ibt, step*=0.5) {
+      double decrease = 0.0;
+      for(int i=0; i<n; ++i) {
+	x_trial(i,0) = std::min(std::max(x(i,0)+step*d(i,0), 
+					 lowerBounds(i,0)), upperBounds(i,0));
+	decrease += g(i,0)*(x_trial(i,0)-x(i,0));
+      }
+      if(!(decrease < 0.0))
+	break; // the step no longer moves us downhill
+      f_trial = model.objective(x_trial);
+      if(f_trial <= f + sufficient_decrease*decrease) {
+	accepted = true;
+	break;
+      }
+    }
+    if(!accepted)
+      break;
+
+    model.objectiveAndGradient(f_trial, g_trial, x_trial);
+
+    // keep the pair only if it has positive curvature
+    double sy = 0.0, yy = 0.0;
+    for(int i=0; i<n; ++i) {
+      double yi = g_trial(i,0)-g(i,0);
+      sy += (x_trial(i,0)-x(i,0))*yi;
+      yy += yi*yi;
+    }
+    if(sy > DBL_EPSILON*yy) {
+      inewest = (inewest+1)%m;
+      for(int i=0; i<n; ++i) {
+	S(i,inewest) = x_trial(i,0)-x(i,0);
+	Yg(i,inewest) = g_trial(i,0)-g(i,0);
+      }
+      rho(inewest,0) = 1.0/sy;
+      if(num_pairs < m)
+	++num_pairs;
+    }
+
+    double f_decrease = f-f_trial;
+    x.copy(x_trial);
+    g.copy(g_trial);
+    f = f_trial;
+    if(f_decrease <= lbfgsData.relFunTol*std::max(std::fabs(f), 1.0))
+      break;
+  }
+
+  final_val = f;
 }
 
 
@@ -135,7 +383,9 @@ void OptimizationProblem::direct_optimize()
 
 
 //void OptimizationProblem::optimize_with_conmin(MtxDbl& guess)
-void OptimizationProblem::optimize_with_conmin(MtxDbl& guess, 
+void OptimizationProblem::optimize_with_conmin(SurfPackModel& model,
+					       OptProbConminData& conmin_data,
+					       MtxDbl& guess, 
 					       double& final_val)
 {
 /*  The following was copied from the conmin user's manual found at 
@@ -427,6 +677,8 @@ where
     N5 = 2*N4
 */
 
+  std::lock_guard<std::mutex> lock(fortranOptimizerMutex);
+
   int N1 = numDesignVar + 2;
   int N2 = numConFunc + 2*numDesignVar;
   int N3 = numDesignVar + numConFunc + 1; //N3=NACMX1= 1 plus user's best estimate 
@@ -462,12 +714,12 @@ where
   int iter  = 0;                 ///Internal CONMIN variable: iteration count.
 
   ///conjugate direction restart parameter
-  if(conminData.icndir==0) conminData.icndir=numDesignVar+1;
+  if(conmin_data.icndir==0) conmin_data.icndir=numDesignVar+1;
 
   MtxDbl query_pt(N1,1); //CONMIN CALLS THIS "X"
   MtxDbl lower_bounds(N1,1);
   MtxDbl upper_bounds(N1,1);
-  theModel.makeGuessFeasible(guess,this); //need to find a better place to put this
+  model.makeGuessFeasible(guess,this); //need to find a better place to put this
   for(int ivar=0; ivar<numDesignVar; ivar++) {
     query_pt(ivar,0)=guess(ivar,0);
     lower_bounds(ivar,0)=lowerBounds(ivar,0);
@@ -486,21 +738,21 @@ where
   MtxDbl A(N1,N3); A.zero(); //the gradients of constraints array that we need to pass into CONMIN (inludes extra workspace), if finite difference gradients are used this is a CONMIN internal array
 
 
-  //assert((conminData.nfdg==0)||(conminData.nfdg==1)||(conminData.nfdg==2));
+  //assert((conmin_data.nfdg==0)||(conmin_data.nfdg==1)||(conmin_data.nfdg==2));
   int i, k;
   do {
     if(numConFunc>0) {
       //there are constraint FUNCTIONS
       //printf("  conmin iter=%d info=%d\n",iter,info);
       if(info>=2) {
-	if(conminData.nfdg==1) {
+	if(conmin_data.nfdg==1) {
 	  //ConMin is requesting analyical GRADIENTS of the objective and constraint functions (but not the objective and constraint functions themselves)
-	  theModel.objectiveAndConstraintsAndGradients(dummy_obj, con, 
+	  model.objectiveAndConstraintsAndGradients(dummy_obj, con, 
 						     grad_obj, grad_con, guess);
-	  if(conminData.nfdg==1) {
+	  if(conmin_data.nfdg==1) {
 	    nac=0;
 	    for(k=0; k<numConFunc; k++) 
-	      if(conminData.ct<=con(k,0)) {
+	      if(conmin_data.ct<=con(k,0)) {
 		ic(nac,0)=k+1;
 		for(i=0; i<numDesignVar; i++) 
 		  A(i,nac) = grad_con(k,i);
@@ -509,15 +761,15 @@ where
 	  }
 
 	}
-	else if(conminData.nfdg==2) //no analytical gradients for the constraints
-	  theModel.objectiveAndGradient(dummy_obj, grad_obj, guess);
+	else if(conmin_data.nfdg==2) //no analytical gradients for the constraints
+	  model.objectiveAndGradient(dummy_obj, grad_obj, guess);
 	
 	for(i=0; i<numDesignVar; i++) 
 	  df(i,0)=grad_obj(i,0);	
       }
       else{ //if(info==1) {
 	//conmin is requesting the objective and constraint functions but NOT their gradients
-	theModel.objectiveAndConstraints(obj, con, guess);
+	model.objectiveAndConstraints(obj, con, guess);
 	for(k=0; k<numConFunc; k++) 
 	  cv(k,0)=con(k,0);	  
       }
@@ -527,15 +779,15 @@ where
     else{
       //there are NO constraint FUNCTIONS
 
-      if((conminData.nfdg>0)&&(info>=2)) {
+      if((conmin_data.nfdg>0)&&(info>=2)) {
 	//conmin is requesting the analytical GRADIENT of the objective function (but not the objective function itself)
-	theModel.objectiveAndGradient(dummy_obj, grad_obj, guess);
+	model.objectiveAndGradient(dummy_obj, grad_obj, guess);
 	for(i=0; i<numDesignVar; i++) 
 	  df(i,0)=grad_obj(i,0);
       }
       else{
 	//conmin is requesting the objective function but NOT it's analytical gradient
-	obj=theModel.objective(guess);
+	obj=model.objective(guess);
       }
     }
 
@@ -543,13 +795,13 @@ where
 	       cv.ptr(0,0), scal.ptr(0,0), df.ptr(0,0), A.ptr(0,0), s.ptr(0,0),
 	       g1.ptr(0,0), g2.ptr(0,0), B.ptr(0,0), c.ptr(0,0),
 	       isc.ptr(0,0), ic.ptr(0,0), ms1.ptr(0,0), N1, N2, N3, N4, N5,
-	       conminData.delfun, conminData.dabfun, 
-	       conminData.fdch, conminData.fdchm,
-	       conminData.ct, conminData.ctmin, conminData.ctl,
-	       conminData.ctlmin, alphax, abobj1, theta, 
-	       obj, numDesignVar, numConFunc, conminData.nside, 
-	       conminData.iprint, conminData.nfdg, nscal, linobj, 
-	       conminData.itmax, conminData.itrm, conminData.icndir, 
+	       conmin_data.delfun, conmin_data.dabfun, 
+	       conmin_data.fdch, conmin_data.fdchm,
+	       conmin_data.ct, conmin_data.ctmin, conmin_data.ctl,
+	       conmin_data.ctlmin, alphax, abobj1, theta, 
+	       obj, numDesignVar, numConFunc, conmin_data.nside, 
+	       conmin_data.iprint, conmin_data.nfdg, nscal, linobj, 
+	       conmin_data.itmax, conmin_data.itrm, conmin_data.icndir, 
 	       igoto, nac, info, infog, iter);
 
     for(i = 0; i<numDesignVar; i++) 
@@ -566,19 +818,31 @@ void OptimizationProblem::best_guess_optimize(int num_guesses)
 {
   assert(num_guesses >= 1);
 
+  // draw the provided then possibly random guesses here, in order, so
+  // they don't depend on how the evaluations are spread over threads
+  MtxDbl guesses(numDesignVar,num_guesses);
   MtxDbl guess(numDesignVar,1);
-  bestFunction = DBL_MAX;
-
-  // iterate over provided then possibly random guesses
   for (int iguess = 0; iguess < num_guesses; ++iguess) {
     retrieve_initial_iterate(iguess, guess);
-    double obj = theModel.objective(guess);
-    if(obj < bestFunction) {
-      bestFunction = obj;
-      bestVars = guess;
-    }
+    for (int i = 0; i < numDesignVar; ++i)
+      guesses(i,iguess) = guess(i,0);
   }
 
+  MtxDbl objs(num_guesses,1);
+  run_tasks(num_guesses, [&](SurfPackModel& model, int iguess) {
+      MtxDbl my_guess;
+      guesses.getCols(my_guess, iguess);
+      objs(iguess,0) = model.objective(my_guess);
+    });
+
+  // the first of the best guesses wins, as when they ran one at a time
+  bestFunction = DBL_MAX;
+  for (int iguess = 0; iguess < num_guesses; ++iguess)
+    if(objs(iguess,0) < bestFunction) {
+      bestFunction = objs(iguess,0);
+      guesses.getCols(bestVars, iguess);
+    }
+
 }
 
 
@@ -600,8 +864,7 @@ optimize_with_direct(double& final_val)
     std::exit(-1);
 
   // INITIALIZATION
-  OptimizationProblem* prev_instance = optimizationProblemInstance;
-  optimizationProblemInstance = this;
+  std::lock_guard<std::mutex> lock(fortranOptimizerMutex);
 
   int ierror, num_cv = numDesignVar, algmethod = 1, logfile = 13,
     quiet_flag  = directData.verboseOutput ? 0 : 1;
@@ -617,11 +880,14 @@ optimize_with_direct(double& final_val)
   double fglper = 
     (directData.solutionTarget > -DBL_MAX) ? directData.convergenceTol : 0.;
 
-  // for passing additional data to objective_eval()
-  int isize = 0, dsize = 0, csize = 0;
+  // for passing additional data to objective_eval(): DIRECT hands cdata
+  // back untouched, so it carries this problem to the evaluator
+  int isize = 0, dsize = 0, csize = sizeof(OptimizationProblem*);
   int*    idata = NULL;
   double* ddata = NULL;
-  char*   cdata = NULL;
+  OptimizationProblem* problem = this;
+  char    cdata[sizeof(OptimizationProblem*)];
+  std::memcpy(cdata, &problem, sizeof(problem));
 
   int max_eval = directData.maxFunctionEvals;
   int max_iter = directData.maxIterations;
@@ -687,7 +953,6 @@ optimize_with_direct(double& final_val)
   }
 
   // FINALIZE
-  optimizationProblemInstance = prev_instance;
   final_val = fmin;
 
   //std::cout << "fmin = " << fmin << "; theta = ";
@@ -700,13 +965,16 @@ optimize_with_direct(double& final_val)
 
 /// Modified batch evaluator that accepts multiple points and returns
 /// corresponding vector of functions in fvec.  Must be used with modified
-/// DIRECT src (DIRbatch.f).
+/// DIRECT src (DIRbatch.f).  cdata holds the OptimizationProblem.
 int OptimizationProblem::
 direct_objective_eval(int *n, double c[], double l[], double u[], int point[],
 		      int *maxI, int *start, int *maxfunc, double fvec[],
 		      int iidata[], int *iisize, double ddata[], int *idsize, 
 		      char cdata[], int *icsize)
 {
+  OptimizationProblem* problem;
+  std::memcpy(&problem, cdata, sizeof(problem));
+
   int cnt = *start-1; // starting index into fvec
   int nx  = *n;       // dimension of design vector x.
   
@@ -714,58 +982,61 @@ direct_objective_eval(int *n, double c[], double l[], double u[], int point[],
   // if initial point, we have a single point to evaluate
   int np = (*start == 1) ? 1 : *maxI*2;
 
-  // loop over trial points, lift scaling, synchronously evaluate
-  MtxDbl curr_vars(nx,1);
+  // gather the trial points and lift scaling
+  MtxDbl trial_vars(nx,np);
   int pos = *start-1; // only used for second eval and beyond
   for (int j=0; j<np; j++) {
 
     if (*start == 1)
       for (int i=0; i<nx; i++)
-	curr_vars(i,0) = (c[i]+u[i])*l[i];
+	trial_vars(i,j) = (c[i]+u[i])*l[i];
     else {
       for (int i=0; i<nx; i++) {
 	// c[pos+i*maxfunc] = c(pos,i) in Fortran.
 	double ci=c[pos+i*(*maxfunc)];
-	curr_vars(i,0) = (ci + u[i])*l[i];
+	trial_vars(i,j) = (ci + u[i])*l[i];
       }
       pos = point[pos]-1;
     }
+  }
 
-    // choose between hidden constraint and unconstrained formula
-    if (optimizationProblemInstance->directData.constraintsPresent) {
-      
-      double obj;
-      MtxDbl con(optimizationProblemInstance->numConFunc,1);
-
-      optimizationProblemInstance->
-	theModel.objectiveAndConstraints(obj, con, curr_vars);
-
-       // return function values
-      fvec[cnt+j] = obj;
-
-      // set flag to 1 if infeasible w.r.t. ANY constraint
-      int infeasible = 0;
-      //std::cout << "numConFunc=" << optimizationProblemInstance->numConFunc;
-      for(int k=0; k<optimizationProblemInstance->numConFunc; k++) 
-	if (!(con(k,0) < 0.0)) {
-	  infeasible = 1;
-	  //std::cout << "constraint violated" << std::endl;
-	  break;
-	}
-      //if(infeasible==0)
-      //std::cout << "a feasible solution exists" << std::endl;
-      fvec[cnt+(*maxfunc)+j] = infeasible;
-
-    }
-    else {
-      // return function values
-      fvec[cnt+j] = optimizationProblemInstance->theModel.objective(curr_vars);
-      // flag: successful eval
-      fvec[cnt+(*maxfunc)+j] = 0; 
-    }
+  // synchronously evaluate them, possibly several at once
+  problem->run_tasks(np, [&](SurfPackModel& model, int j) {
+      MtxDbl curr_vars;
+      trial_vars.getCols(curr_vars, j);
 
+      // choose between hidden constraint and unconstrained formula
+      if (problem->directData.constraintsPresent) {
+      
+	double obj;
+	MtxDbl con(problem->numConFunc,1);
+
+	model.objectiveAndConstraints(obj, con, curr_vars);
+
+	// return function values
+	fvec[cnt+j] = obj;
+
+	// set flag to 1 if infeasible w.r.t. ANY constraint
+	int infeasible = 0;
+	//std::cout << "numConFunc=" << problem->numConFunc;
+	for(int k=0; k<problem->numConFunc; k++) 
+	  if (!(con(k,0) < 0.0)) {
+	    infeasible = 1;
+	    //std::cout << "constraint violated" << std::endl;
+	    break;
+	  }
+	//if(infeasible==0)
+	//std::cout << "a feasible solution exists" << std::endl;
+	fvec[cnt+(*maxfunc)+j] = infeasible;
 
-  } // end evaluation loop over points
+      }
+      else {
+	// return function values
+	fvec[cnt+j] = model.objective(curr_vars);
+	// flag: successful eval
+	fvec[cnt+(*maxfunc)+j] = 0; 
+      }
+    }); // end evaluation of points
 
   return 0;
 }
@@ -798,7 +1069,7 @@ void OptimizationProblem::getRandGuess(MtxDbl& guess) const
   //lowerBounds.getNRow(),lowerBounds.getNCols(),
   //upperBounds.getNRows(),upperBounds.getNCols()); fflush(stdout);
   for(int i=0;i<numDesignVar;i++)
-    guess(i,0)=(std::rand() % mymod) *
+    guess(i,0)=(nkm_rand() % mymod) *
       (upperBounds(i,0)-lowerBounds(i,0))/mymod + lowerBounds(i,0);
 }
 
@@ -2,6 +2,9 @@
 #define __OPTIMIZE_HPP__ 
 
 #include "NKM_SurfData.hpp"
+#include <functional>
+#include <memory>
+#include <vector>
 
 namespace nkm {
 
@@ -211,6 +214,27 @@ struct OptProbDirectData {
 };
 
 
+/// settings for the limited memory BFGS optimizer with bound constraints
+struct OptProbLbfgsData {
+
+  /// number of (step, change in gradient) pairs kept to approximate the
+  /// inverse Hessian
+  int numCorrections; // = 10;
+
+  /// maximum number of iterations, each needs one objective gradient
+  int maxIterations; // = 50;
+
+  /// converged when the largest component of the gradient, less those
+  /// pushing against an active bound, falls below this
+  double gradTol; // = 1.0e-6;
+
+  /// converged when an iteration's decrease in the objective, relative to
+  /// max(|objective|,1), falls below this
+  double relFunTol; // = 1.0e-10;
+
+};
+
+
 /**
    definition of OptimizationProblem base class
 */
@@ -221,7 +245,8 @@ public:
 
   OptimizationProblem(SurfPackModel& model, int num_vars, 
 		      int num_constraints = 0)
-    :theModel(model), numDesignVar(num_vars), numConFunc(num_constraints)
+    :theModel(model), numThreads(0), numDesignVar(num_vars),
+     numConFunc(num_constraints)
   { 
     //printf("calling the OptProb constructor num_vars=%d numDesignVar=%d\n",
     //num_vars,numDesignVar); fflush(stdout);
@@ -229,7 +254,13 @@ public:
     upperBounds.newSize(numDesignVar,1);
     initialIterates.newSize(numDesignVar,1);
     bestVars.newSize(numDesignVar,1);
+    lbfgsData.numCorrections = 10;
+    lbfgsData.maxIterations = 50;
+    lbfgsData.gradTol = 1.0e-6;
+    lbfgsData.relFunTol = 1.0e-10;
   }
+
+  ~OptimizationProblem();
   
   // init functions
 
@@ -244,6 +275,11 @@ public:
 
   void add_initial_iterates(MtxDbl& init_iterates_to_add);
 
+  /// cap the number of threads that evaluate starting points (and
+  /// DiRECT's batches of trial points); 0, the default, uses
+  /// surfpack::default_num_threads()
+  void num_threads(int n) { numThreads = n; }
+
 
   // run functions
   void conmin_optimize();
@@ -255,6 +291,12 @@ public:
 
   void multistart_conmin_optimize(int num_guesses);
 
+  // minimize the objective with a bound constrained quasi-Newton 
+  // (limited memory BFGS) method using the model's analytical gradient
+  void lbfgs_optimize();
+
+  void multistart_lbfgs_optimize(int num_guesses);
+
 
   // post functions
 
@@ -271,6 +313,9 @@ public:
   // controls for DiRECT
   OptProbDirectData directData;
 
+  // controls for limited memory BFGS
+  OptProbLbfgsData lbfgsData;
+
   // return a random guess in [lowerBounds, upperBounds]
   // TODO: allow models to override?  Not sure why one would need to...
   void getRandGuess(MtxDbl& guess) const;
@@ -284,12 +329,27 @@ private:
   // helper functions
   
 
+  /// call task(model, i) for i = 0, ..., num_tasks-1, spreading the
+  /// calls over up to numThreads threads.  Each thread evaluates on its
+  /// own workspace, theModel or one of its clone_workspace() copies, so
+  /// task must record its result by i; errors are rethrown here
+  void run_tasks(int num_tasks,
+		 const std::function<void(SurfPackModel&, int)>& task);
+
   // underlying optimizer implementations
 
-  void optimize_with_conmin(MtxDbl& initial_iterate, double& final_val);
+  void optimize_with_conmin(SurfPackModel& model, 
+			    OptProbConminData& conmin_data,
+			    MtxDbl& initial_iterate, double& final_val);
 
   void optimize_with_direct(double& final_val);
 
+  void optimize_with_lbfgs(SurfPackModel& model, MtxDbl& guess, 
+			   double& final_val);
+
+  /// throw if no L-BFGS start reached a point satisfying the constraints
+  void require_feasible_lbfgs_result() const;
+
   /// 'fep' in Griffin-modified NCSUDirect: computes the value of the
   /// objective function (potentially at multiple points, passed by function
   /// pointer to NCSUDirect).  Include unscaling from DIRECT.
@@ -299,8 +359,6 @@ private:
 			double fvec[], int iidata[], int *iisize,
 			double ddata[], int *idsize, char cdata[],
 			int *icsize);
-  
-  static OptimizationProblem* optimizationProblemInstance;
 
   // data
 
@@ -309,6 +367,13 @@ private:
   // TODO: generalize to Model&
   SurfPackModel& theModel;
 
+  /// copies of theModel for threads other than the calling one to
+  /// evaluate on; made on first use and kept for later batches
+  std::vector<std::unique_ptr<SurfPackModel> > workspaces;
+
+  /// maximum number of threads, 0 for the default
+  int numThreads;
+
   /// number of design variables
   int numDesignVar;
 
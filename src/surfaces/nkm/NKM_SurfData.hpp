@@ -398,6 +398,17 @@ public:
   ///tell me the index of the column of y that you want to build the emulator for
   inline int getIOut() const {return iout;};
 
+  ///bytes of memory allocated to the data (inputs, outputs, derivatives, and scaling)
+  std::size_t getNBytesAlloc() const {
+    std::size_t bytes=xr.getNBytesAlloc()+xi.getNBytesAlloc()+
+      y.getNBytesAlloc()+derOrder.getNBytesAlloc()+minMaxXr.getNBytesAlloc()+
+      lockxr.getNBytesAlloc()+unscalexr.getNBytesAlloc()+
+      unscaley.getNBytesAlloc();
+    for(std::size_t i=0; i<derY.size(); ++i)
+      for(std::size_t j=0; j<derY[i].size(); ++j)
+	bytes+=derY[i][j].getNBytesAlloc();
+    return bytes;};
+
   ///set the index of the column of y that you want to build the emulator for
   void setIOut(int iout_new){
     iout=iout_new;
@@ -400,6 +400,7 @@ MtxDbl& Chol_fact(MtxDbl& matrix, int& info, double& rcond)
   double orignorm=DLANGE_F77(&whichnorm,&nrows,&ncols,matrix.ptr(0,0),&lda,work.ptr(0,0));
 
   DPOTRF_F77(&uplo,&nrows,matrix.ptr(0,0),&lda,&info_local);
+  ::surfpack::profile_count("factorizations");
 #ifdef __SURFMAT_ERR_CHECK__
   assert(info_local>=0);
 #endif
@@ -472,6 +473,7 @@ MtxDbl& Chol_fact_workspace(MtxDbl& matrix, MtxDbl& scalefactor,
   double orignorm=DLANGE_F77(&whichnorm,&nrows,&ncols,matrix.ptr(0,0),&lda,work.ptr(0,0));
 
   DPOTRF_F77(&uplo,&nrows,matrix.ptr(0,0),&lda,&info_local);
+  ::surfpack::profile_count("factorizations");
 #ifdef __SURFMAT_ERR_CHECK__
   assert(info_local>=0);
 #endif
@@ -545,6 +547,50 @@ MtxDbl& inverse_after_Chol_fact(MtxDbl& matrix)
   return rconda;
 }
 
+/// extends the Cholesky factorization of an n by n real symmetric positive definite matrix A to that of the (n+k) by (n+k) matrix [A B; B^T C] in O(n^2*k) ops, AChol must contain the lower triangular portion of the factorization of A and is enlarged in place, B is n by k, only the lower triangular part of the k by k matrix C is used, if info>0 then the extended matrix is not positive definite and AChol is left unchanged, wraps DTRSM, DSYRK and DPOTRF
+MtxDbl& Chol_fact_extend(MtxDbl& AChol, const MtxDbl& B, const MtxDbl& C, int& info)
+{
+  int n = static_cast<int>(AChol.getNRows());
+  int k = static_cast<int>(C.getNRows());
+#ifdef __SURFMAT_ERR_CHECK__
+  assert((AChol.getNCols()==n)&&(B.getNRows()==n)&&(B.getNCols()==k)&&
+	 (C.getNCols()==k));
+#endif
+  char side='L', uplo='L', trans='T', notrans='N', diag='N';
+  double one=1.0, minus_one=-1.0;
+
+  //the new rows of the factor are W^T where W=L^-1*B, and its new 
+  //diagonal block is the factor of the Schur complement C-W^T*W
+  MtxDbl W(B), S(C);
+  int ldw = static_cast<int>(W.getNRowsAct());
+  int lds = static_cast<int>(S.getNRowsAct());
+  if(n>0) {
+    int lda = static_cast<int>(AChol.getNRowsAct());
+    DTRSM_F77(&side,&uplo,&notrans,&diag,&n,&k,&one,AChol.ptr(0,0),&lda,
+	      W.ptr(0,0),&ldw);
+    DSYRK_F77(&uplo,&trans,&k,&n,&minus_one,W.ptr(0,0),&ldw,&one,
+	      S.ptr(0,0),&lds);
+  }
+  int info_local=0;
+  DPOTRF_F77(&uplo,&k,S.ptr(0,0),&lds,&info_local);
+  ::surfpack::profile_count("factorizations");
+  info=info_local;
+  if(info!=0)
+    return AChol;
+
+  AChol.resize(n+k,n+k);
+  for(int j=0; j<n; ++j)
+    for(int i=0; i<k; ++i)
+      AChol(n+i,j)=W(j,i);
+  for(int j=0; j<k; ++j) {
+    for(int i=0; i<n+j; ++i)
+      AChol(i,n+j)=0.0; //not referenced, but don't leave it uninitialized
+    for(int i=j; i<k; ++i)
+      AChol(n+i,n+j)=S(i,j);
+  }
+  return AChol;
+}
+
   //MtxDbl& debug_solve_after_Chol_fact(MtxDbl& result, const MtxDbl& AChol, const MtxDbl& BRHS,char transB='N');
 
 /// solves A*X=B for X, where A is symmetric positive definite and B={B || B^T}, without changing the contents of B, after A has been Cholesky factorized, AChol must contain the lower triangular portion of the factorization of A, wraps DPOTRS 
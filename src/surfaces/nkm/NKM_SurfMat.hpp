@@ -66,6 +66,9 @@ MtxDbl& inverse_after_Chol_fact(MtxDbl& matrix);
 //computes the (1 norm) reciprocal of the condition number of A from the Cholesky factorization of A (A must be real symmetric and positive semi-definite)
 double rcond_after_Chol_fact(const MtxDbl& A, const MtxDbl& AChol);
 
+/// extends the Cholesky factorization of an n by n real symmetric positive definite matrix A to that of the (n+k) by (n+k) matrix [A B; B^T C] in O(n^2*k) ops, AChol must contain the lower triangular portion of the factorization of A and is enlarged in place, B is n by k, only the lower triangular part of the k by k matrix C is used, if info>0 then the extended matrix is not positive definite and AChol is left unchanged, wraps DTRSM, DSYRK and DPOTRF
+MtxDbl& Chol_fact_extend(MtxDbl& AChol, const MtxDbl& B, const MtxDbl& C, int& info);
+
 /// solves A*X=B for X, where A is symmetric positive definite and B={B || B^T}, without changing the contents of B, after A has been Cholesky factorized, AChol must contain the lower triangular portion of the factorization of A, wraps DPOTRS 
 MtxDbl& solve_after_Chol_fact(MtxDbl& result, const MtxDbl& AChol, const MtxDbl& BRHS,char transB='N');
 
@@ -6,6 +6,7 @@
 #include <string>
 #include <sstream>
 #include "surfpack_system_headers.h"
+#include "SurfpackProfile.h"
 
 namespace nkm {
 
@@ -248,6 +249,13 @@ public:
    */
   inline int getNElems() const {return (NRows*NCols);};
 
+  /**
+   * Get the number of bytes of memory allocated to the matrix
+   *
+   * @return the bytes allocated, which can exceed those of the actual elements
+   */
+  inline std::size_t getNBytesAlloc() const {return (data.capacity()*sizeof(T)+jtoi.capacity()*sizeof(int));};
+
   /**
    * Get the equality tolerance
    *
@@ -1162,7 +1170,9 @@ private:
   int NColsAct; /**< number of allocated columns */
   int NRows; /**< number of used rows, passed to LAPACK as the number of rows */
   int NCols; /**< number of used columns */
-  std::vector<T>  data;
+  /// element storage, counted in the build profile (SurfpackProfile.h)
+  typedef std::vector<T, ::surfpack::ProfiledAllocator<T> > Storage;
+  Storage data;
   std::vector<int> jtoi;
 
   /**< An inequaltiy tolerance for equality checking. Should be 0 for integers
@@ -1293,8 +1303,9 @@ void SurfMat<T>::clear()
   }
 #endif
   if(NRowsAct) {
-    jtoi.clear();
-    data.clear();
+    //swap with empty vectors, clear() alone keeps the capacity allocated
+    std::vector<int>().swap(jtoi);
+    Storage().swap(data);
     NRowsAct=NColsAct=NRows=NCols=0;
   }
   return;
@@ -1534,7 +1545,7 @@ void SurfMat<T>::resize2(int nrows_new, int ncols_new, bool if_force) {
     if(nelem_act<nelem_new) {
       //we need to copy the data to a new (larger) array
 
-      std::vector<T> newdata(nelem_new);
+      Storage newdata(nelem_new);
       std::vector<int> newjtoi(ncols_new);
 
       for(int j=0, J=0; j<ncols_new; ++j, J+=nrows_new)
@@ -1,5 +1,6 @@
 #include "NKM_SurfPack.hpp"
 #include <cmath>
+#include <random>
 
 //the purpose of this file is to contain generic functions usable by everything
 
@@ -77,6 +78,28 @@ MtxDbl& gen_rot_mat(MtxDbl& Rot, const MtxDbl& EulAng, int nvarsr){
   return Rot;
 }
 
+// per-thread stream for nkm_rand(); inactive threads use std::rand()
+static thread_local bool threadRandActive = false;
+static thread_local std::mt19937 threadRand;
+
+int nkm_rand()
+{
+  if(threadRandActive)
+    return static_cast<int>(threadRand() & 0x7fffffffu);
+  return std::rand();
+}
+
+void nkm_rand_seed_thread(unsigned seed)
+{
+  threadRand.seed(seed);
+  threadRandActive = true;
+}
+
+void nkm_rand_clear_thread()
+{
+  threadRandActive = false;
+}
+
 //all coordinates are between -1 and 1
 MtxDbl& gen_rand_rot_mat(MtxDbl& rot,int nvarsr) 
 {
@@ -86,7 +109,7 @@ MtxDbl& gen_rand_rot_mat(MtxDbl& rot,int nvarsr)
   double pi=2.0*std::acos(0.0);
   int mymod = 1048576; //2^20 instead of 10^6 to be kind to the computer
   for(int i=0; i<n_eul_ang; ++i)
-    eul_ang(i,0)=(std::rand() % mymod)*pi/mymod;
+    eul_ang(i,0)=(nkm_rand() % mymod)*pi/mymod;
   rot.newSize(nvarsr,nvarsr);
   gen_rot_mat(rot, eul_ang, nvarsr);
   return rot;
@@ -104,8 +127,8 @@ MtxDbl& gen_rand_axis_bin_opt_samples_0to1(MtxDbl& xr, int nvarsr)
     for(int i=0; i<nvarsr; ++i) {
       //printf(" j=%d",j); fflush(stdout);
       xr(i,2*j  )=2.0*std::floor(1.0+xr(i,j))-1.0;
-      xr(i,2*j+1)=0.5*((-xr(i,2*j)*(std::rand() % mymod))/mymod+1.0);
-      xr(i,2*j  )=0.5*(( xr(i,2*j)*(std::rand() % mymod))/mymod+1.0);
+      xr(i,2*j+1)=0.5*((-xr(i,2*j)*(nkm_rand() % mymod))/mymod+1.0);
+      xr(i,2*j  )=0.5*(( xr(i,2*j)*(nkm_rand() % mymod))/mymod+1.0);
     }
     //printf("\n");
   }
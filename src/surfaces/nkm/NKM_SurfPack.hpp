@@ -117,6 +117,18 @@ MtxDbl& evaluate_poly_der_basis(MtxDbl& dg, MtxInt& flypoly, MtxDbl& flycoef,
 				const MtxInt& poly, const MtxInt& der, 
 				const MtxDbl& xr);
 
+/** nonnegative pseudo-random int used in place of std::rand() during
+    model construction.  Draws from std::rand() unless the calling thread
+    has been given its own stream by nkm_rand_seed_thread(), so that
+    models built concurrently are independent and reproducible */
+int nkm_rand();
+
+/// give the calling thread its own nkm_rand() stream, seeded with seed
+void nkm_rand_seed_thread(unsigned seed);
+
+/// return the calling thread's nkm_rand() to std::rand()
+void nkm_rand_clear_thread();
+
 /// generate a rotation matrix from a set of Euler angles 
 MtxDbl& gen_rot_mat(MtxDbl& Rot, const MtxDbl& EulAng, int nvarsr);
 
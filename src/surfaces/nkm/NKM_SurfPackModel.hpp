@@ -32,6 +32,9 @@ public:
 
   SurfPackModel(const SurfData& sd,int iout_keep) : sdBuild(sd,iout_keep), scaler(sdBuild), outputLevel(NORMAL_OUTPUT) {};
 
+  /// the copy's scaler works on the copy's own build data
+  SurfPackModel(const SurfPackModel& other) : sdBuild(other.sdBuild), scaler(sdBuild), outputLevel(other.outputLevel) {};
+
   virtual ~SurfPackModel() { /* empty dtor */ }
 
   virtual void create() {
@@ -45,9 +48,9 @@ public:
   };
 
 
-  virtual double evaluate(const  MtxDbl& xr) =0;
+  virtual double evaluate(const  MtxDbl& xr) const =0;
 
-  virtual MtxDbl& evaluate(MtxDbl& y, const MtxDbl& xr) 
+  virtual MtxDbl& evaluate(MtxDbl& y, const MtxDbl& xr) const
   {
     int nvarsxr=xr.getNRows();
     int nptsxr=xr.getNCols();
@@ -67,7 +70,7 @@ public:
     return y;
   };
 
-  virtual double eval_variance(const MtxDbl& xr) {
+  virtual double eval_variance(const MtxDbl& xr) const {
     std::cerr << "This model doesn't have an implemented function to return a variance" << std::endl;
     assert(false);
     // stricter compilers don't allow divide by 0
@@ -77,7 +80,7 @@ public:
     return(DBL_MAX);
   };
 
-  virtual MtxDbl& eval_variance(MtxDbl& var, const MtxDbl& xr) 
+  virtual MtxDbl& eval_variance(MtxDbl& var, const MtxDbl& xr) const
   {
     int nvarsxr=xr.getNRows();
     int nptsxr=xr.getNCols();
@@ -97,9 +100,9 @@ public:
     return var;
   };
 
-  virtual MtxDbl& evaluate_d1y(MtxDbl& d1y, const MtxDbl& xr) =0;
+  virtual MtxDbl& evaluate_d1y(MtxDbl& d1y, const MtxDbl& xr) const =0;
 
-  virtual MtxDbl& evaluate_d2y(MtxDbl& d2y, const MtxDbl& xr) =0;
+  virtual MtxDbl& evaluate_d2y(MtxDbl& d2y, const MtxDbl& xr) const =0;
 
 
   /// adjust correlations to be feasible with respect to condition
@@ -119,8 +122,18 @@ public:
   virtual void set_conmin_parameters(OptimizationProblem& opt) const{
   };
 
+  /// a copy of this model on which the objective functions may be
+  /// evaluated concurrently with this one, for the optimizer's threads;
+  /// NULL (the default) keeps every evaluation on this model
+  virtual SurfPackModel* clone_workspace() const{
+    return NULL;
+  };
+
   virtual void set_direct_parameters(OptimizationProblem& opt) const{
   };
+
+  virtual void set_lbfgs_parameters(OptimizationProblem& opt) const{
+  };
   
 
   /// the objective function, i.e. the negative log(likelihood);
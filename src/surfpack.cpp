@@ -48,11 +48,31 @@ const surfpack::DbgStream& surfpack::dbg(int level_in)
 // _____________________________________________________________________________
 // Mersenne Twister Random Number Generator 
 // _____________________________________________________________________________
+// generator installed by the innermost ThreadRngScope on this thread
+static thread_local surfpack::MyRandomNumberGenerator* threadRng = NULL;
+
 surfpack::MyRandomNumberGenerator& surfpack::shared_rng()
 {
+  if (threadRng) return *threadRng;
   static MyRandomNumberGenerator mrng;
   return mrng;
 }
+
+surfpack::ThreadRngScope::ThreadRngScope(MyRandomNumberGenerator& rng)
+  : prevRng(threadRng)
+{
+  threadRng = &rng;
+}
+
+surfpack::ThreadRngScope::~ThreadRngScope()
+{
+  threadRng = prevRng;
+}
+
+bool surfpack::ThreadRngScope::active()
+{
+  return threadRng != NULL;
+}
                                                                            
 // _____________________________________________________________________________
 // Block partitioning helper methods 
@@ -422,8 +442,10 @@ void surfpack::linearSystemLeastSquares(MtxDbl& A,
   int info;
   int nrhs=1;
   char trans = 'N';
+  ScopedPhase phase("least_squares");
   DGELS_F77(&trans,&n_rows,&n_cols,&nrhs,&A(0,0),&n_rows,&b[0],
 	    &n_rows,&work[0],&lwork,&info);
+  profile_count("factorizations");
   x = b;
   x.resize(n_cols);
   if (debug) {
@@ -433,6 +455,71 @@ void surfpack::linearSystemLeastSquares(MtxDbl& A,
   }
 }
 
+/** With the hat matrix H = A (A^T A)^-1 A^T = U U^T (thin SVD A = U S
+    V^T) and residuals e = b - H b, the residuals of the fit without
+    rows S are (I - H_SS)^-1 e_S, so one factorization of A serves every
+    partition.  I - H_SS is singular when A without rows S is rank
+    deficient, in which case no unique leave-out fit exists. */
+bool surfpack::leastSquaresLeaveout(MtxDbl& A, const VecDbl& b,
+  const VecVecUns& partitions, VecDbl& estimates)
+{
+  assert(A.getNRows() == b.size()); 
+  if (A.getNRows() < A.getNCols()) return false;
+  int n_rows = static_cast<int>(A.getNRows());
+  int n_cols = static_cast<int>(A.getNCols());
+  MtxDbl U(n_rows, n_cols);
+  VecDbl sing_vals(n_cols);
+  char jobu = 'S';
+  char jobvt = 'N';
+  int ldvt = 1;
+  double vt = 0.0;
+  int lwork = std::max(3*n_cols + n_rows, 5*n_cols);
+  VecDbl work(lwork);
+  int info = 0;
+  DGESVD_F77(&jobu,&jobvt,&n_rows,&n_cols,&A(0,0),&n_rows,&sing_vals[0],
+	     &U(0,0),&n_rows,&vt,&ldvt,&work[0],&lwork,&info);
+  profile_count("factorizations");
+  if (info != 0 || 
+      !(sing_vals[n_cols-1] > sing_vals[0]*n_rows*DBL_EPSILON))
+    return false;
+
+  VecDbl fitted, ut_b;
+  matrixVectorMult(ut_b, U, const_cast<VecDbl&>(b), 'T');
+  matrixVectorMult(fitted, U, ut_b);
+
+  // eigenvalues of I - H_SS lie in [0,1]; treat a pivot this small as
+  // singular
+  const double min_pivot = n_rows*DBL_EPSILON;
+  estimates.resize(b.size());
+  for (unsigned p = 0; p < partitions.size(); p++) {
+    const VecUns& part = partitions[p];
+    int n_leave = static_cast<int>(part.size());
+    MtxDbl ihss(n_leave, n_leave);
+    VecDbl resid(n_leave);
+    for (int i = 0; i < n_leave; i++) {
+      for (int j = 0; j <= i; j++) {
+	double h = 0.0;
+	for (int k = 0; k < n_cols; k++)
+	  h += U(part[i],k)*U(part[j],k);
+	ihss(i,j) = ihss(j,i) = (i == j) ? 1.0 - h : -h;
+      }
+      resid[i] = b[part[i]] - fitted[part[i]];
+    }
+    char uplo = 'L';
+    int nrhs = 1;
+    DPOTRF_F77(&uplo,&n_leave,&ihss(0,0),&n_leave,&info);
+    profile_count("factorizations");
+    if (info != 0) return false;
+    for (int i = 0; i < n_leave; i++)
+      if (!(ihss(i,i)*ihss(i,i) > min_pivot)) return false;
+    DPOTRS_F77(&uplo,&n_leave,&nrhs,&ihss(0,0),&n_leave,&resid[0],&n_leave,
+	       &info);
+    for (int i = 0; i < n_leave; i++)
+      estimates[part[i]] = b[part[i]] - resid[i];
+  }
+  return true;
+}
+
 void surfpack::leastSquaresWithEqualityConstraints(MtxDbl& A, 
   vector<double>& x, vector<double>& c,
   MtxDbl& B, vector<double>& d)
@@ -466,8 +553,10 @@ void surfpack::leastSquaresWithEqualityConstraints(MtxDbl& A,
   //copy(d.begin(),d.end(),ostream_iterator<double>(cout,"\n"));
   //cout << "x before" << endl;
   //copy(x.begin(),x.end(),ostream_iterator<double>(cout,"\n"));
+  ScopedPhase phase("least_squares");
   DGGLSE_F77(&m,&n,&p,&A(0,0),&m,&B(0,0),&p,&c[0],&d[0],&x[0],&work[0],&lwork,
 	     &info);
+  profile_count("factorizations");
   //cout << "x after" << endl;
   //copy(x.begin(),x.end(),ostream_iterator<double>(cout,"\n"));
   //vector<double> result;
@@ -488,6 +577,7 @@ MtxDbl& surfpack::inverse(SurfpackMatrix< double>& matrix)
   int lda = n_cols;
   int info = 0;
   DGETRF_F77(&n_rows,&n_cols,&matrix(0,0),&lda,&ipvt[0],&info);
+  profile_count("factorizations");
   DGETRI_F77(&n_rows,&matrix(0,0),&lda,&ipvt[0],&work[0],&lwork,&info);
   return matrix;
 }
@@ -504,6 +594,7 @@ MtxDbl& surfpack::LUFact(MtxDbl& matrix,
   int info = 0;
   //std::cout << "Matrix size: " << n_rows << " " << n_cols << std::endl;
   DGETRF_F77(&n_rows,&n_cols,&matrix(0,0),&lda,&ipvt[0],&info);
+  profile_count("factorizations");
   //std::cout << "Done with dgetrf" << std::endl;
   return matrix;
 }
@@ -539,6 +630,34 @@ VecDbl surfpack::inverseAfterQRFact(const MtxDbl& matrix, VecDbl vector,
   return vector;
 }
 
+VecDbl& surfpack::packedTriangularSolve(const VecDbl& packed, 
+  VecDbl& vector, char uplo, char trans)
+{
+  assert(packed.size() == vector.size()*(vector.size()+1)/2);
+  if (vector.empty()) return vector;
+  char diag = 'N';
+  int n = static_cast<int>(vector.size());
+  int incx = 1;
+  DTPSV_F77(&uplo,&trans,&diag,&n,&packed[0],&vector[0],&incx);
+  return vector;
+}
+
+MtxDbl& surfpack::triangularSolve(const MtxDbl& tri, MtxDbl& rhs, 
+  char side, char uplo, char trans)
+{
+  assert(tri.getNRows() == tri.getNCols());
+  assert(tri.getNRows() == ((side == 'L') ? rhs.getNRows() : rhs.getNCols()));
+  if (rhs.getNRows() == 0 || rhs.getNCols() == 0) return rhs;
+  char diag = 'N';
+  int m = static_cast<int>(rhs.getNRows());
+  int n = static_cast<int>(rhs.getNCols());
+  int lda = static_cast<int>(tri.getNRows());
+  double alpha = 1.0;
+  DTRSM_F77(&side,&uplo,&trans,&diag,&m,&n,&alpha,&tri(0,0),&lda,
+	    &rhs(0,0),&m);
+  return rhs;
+}
+
 VecDbl& surfpack::matrixVectorMult(VecDbl& result,
   MtxDbl& matrix, VecDbl& the_vector, char trans)
 {
@@ -574,6 +693,30 @@ MtxDbl& surfpack::matrixMatrixMult(MtxDbl& result, MtxDbl& matrixA,
   DGEMM_F77(&transA,&transB,&n_rows,&n_cols,&k,&alpha,&matrixA(0,0),&lda,&matrixB(0,0),&ldb,&beta,&result(0,0),&ldc);
   return result;
 }
+
+MtxDbl& surfpack::matrixGramMult(MtxDbl& result, MtxDbl& matrixA)
+{
+  int n = static_cast<int>(matrixA.getNCols());
+  int k = static_cast<int>(matrixA.getNRows());
+  result.reshape(n,n);
+  if (k == 0) {
+    for (int j = 0; j < n; j++) 
+      for (int i = 0; i < n; i++) 
+	result(i,j) = 0.0;
+    return result;
+  }
+  char uplo = 'L';
+  char trans = 'T';
+  double alpha = 1.0;
+  double beta = 0.0;
+  DSYRK_F77(&uplo,&trans,&n,&k,&alpha,&matrixA(0,0),&k,&beta,&result(0,0),&n);
+  // fill in the upper triangle
+  for (int j = 1; j < n; j++) 
+    for (int i = 0; i < j; i++) 
+      result(i,j) = result(j,i);
+  return result;
+}
+
   /// matrix-matrix addition
 MtxDbl& surfpack::matrixSum(MtxDbl& result, MtxDbl& matrixA, MtxDbl& matrixB)
 {
@@ -115,8 +115,28 @@ public:
 
 };
                                                                                 
+/// the process-wide generator, or the calling thread's generator while
+/// a ThreadRngScope is active on it
 MyRandomNumberGenerator& shared_rng();
 
+/// While in scope, redirects shared_rng() on the constructing thread to
+/// the passed generator, so concurrent model builds (e.g.,
+/// cross-validation folds) each draw from their own reproducible stream
+/// without touching the process-wide one.  Scopes may be nested.
+class ThreadRngScope
+{
+public:
+  ThreadRngScope(MyRandomNumberGenerator& rng);
+  ~ThreadRngScope();
+  /// whether shared_rng() is redirected on the calling thread
+  static bool active();
+private:
+  /// generator to restore on exit (NULL for the process-wide one)
+  MyRandomNumberGenerator* prevRng;
+  ThreadRngScope(const ThreadRngScope&);
+  ThreadRngScope& operator=(const ThreadRngScope&);
+};
+
 
 /// Random shuffle with C++17 shuffle API, but using Boost for portability
 /*
@@ -315,6 +335,12 @@ unsigned block_owner(unsigned j, unsigned p, unsigned n);
   /// Least squares solve of system Ax = b
   void linearSystemLeastSquares(MtxDbl& A, VecDbl& x, VecDbl b);
 
+  /// Leave-out estimates for the least squares fit of b by the columns
+  /// of A, each partition of rows left out in turn.  A is overwritten.
+  /// Returns false if A or any leave-out system is rank deficient.
+  bool leastSquaresLeaveout(MtxDbl& A, const VecDbl& b,
+    const VecVecUns& partitions, VecDbl& estimates);
+
   /// Least squares solve os system Ax = c, subject to Bx = d
   void leastSquaresWithEqualityConstraints(MtxDbl& A, 
     VecDbl& x, VecDbl& c,
@@ -334,6 +360,16 @@ unsigned block_owner(unsigned j, unsigned p, unsigned n);
   VecDbl inverseAfterQRFact(const MtxDbl& matrix, VecDbl vector, 
     char uplo, char trans = 'N');
 
+  /// Solves the n x n triangular system Ax=b in place, with A in LAPACK
+  /// packed storage (columns of the triangle stored one after another)
+  VecDbl& packedTriangularSolve(const VecDbl& packed, VecDbl& vector,
+    char uplo, char trans = 'N');
+
+  /// Solves op(A)X = B (side L) or X op(A) = B (side R) in place for
+  /// triangular A, overwriting rhs (B) with X
+  MtxDbl& triangularSolve(const MtxDbl& tri, MtxDbl& rhs, char side,
+    char uplo, char trans = 'N');
+
   /// Note: These matrix functions would not fit easily in SurfpackMatrix.h
   /// because the fortran math functions are not templated
   /// matrix-vector mutltiplication
@@ -345,6 +381,9 @@ unsigned block_owner(unsigned j, unsigned p, unsigned n);
   MtxDbl& matrixMatrixMult(MtxDbl& result, MtxDbl& matrixA, MtxDbl& matrixB,
     char transA = 'N', char transB = 'N');
 
+  /// result = matrixA^T*matrixA (full, symmetric) by a rank-k update
+  MtxDbl& matrixGramMult(MtxDbl& result, MtxDbl& matrixA);
+
   /// matrix-matrix addition
   MtxDbl& matrixSum(MtxDbl& result, MtxDbl& matrixA, MtxDbl& matrixB);
   MtxDbl& matrixSubtraction(MtxDbl& result, MtxDbl& matrixA, MtxDbl& matrixB);
@@ -38,6 +38,9 @@
 #define DGETRI_F77 F77_FUNC(dgetri,DGETRI)
 #define DGEMV_F77  F77_FUNC(dgemv,DGEMV)
 #define DGEMM_F77  F77_FUNC(dgemm,DGEMM)
+#define DSYRK_F77  F77_FUNC(dsyrk,DSYRK)
+#define DTRSM_F77  F77_FUNC(dtrsm,DTRSM)
+#define DTPSV_F77  F77_FUNC(dtpsv,DTPSV)
 #define DDOT_F77   F77_FUNC(ddot, DDOT)
 #define DGELS_F77  F77_FUNC(dgels,DGELS)
 #define DGESVD_F77 F77_FUNC(dgesvd,DGESVD)
@@ -72,6 +75,9 @@
 #define DGETRI_F77 SURF77_GLOBAL(dgetri,DGETRI) 
 #define DGEMV_F77  SURF77_GLOBAL(dgemv,DGEMV) 
 #define DGEMM_F77  SURF77_GLOBAL(dgemm,DGEMM) 
+#define DSYRK_F77  SURF77_GLOBAL(dsyrk,DSYRK) 
+#define DTRSM_F77  SURF77_GLOBAL(dtrsm,DTRSM) 
+#define DTPSV_F77  SURF77_GLOBAL(dtpsv,DTPSV) 
 #define DDOT_F77   SURF77_GLOBAL(ddot, DDOT) 
 #define DGELS_F77  SURF77_GLOBAL(dgels,DGELS)
 #define DGESVD_F77 SURF77_GLOBAL(dgesvd,DGESVD)
@@ -128,6 +134,21 @@ void DGEMM_F77(char* transa, char* transb, const int* m, const int* n,
 	       const int* lda, const double* B, const int* ldb, 
 	       const double* beta, double* C, const int* ldc);
 
+// Symmetric rank-k update
+void DSYRK_F77(const char* uplo, const char* trans, const int* n,
+	       const int* k, const double* alpha, const double* A,
+	       const int* lda, const double* beta, double* C, const int* ldc);
+
+// Triangular solve with multiple right-hand sides
+void DTRSM_F77(const char* side, const char* uplo, const char* transa,
+	       const char* diag, const int* m, const int* n,
+	       const double* alpha, const double* A, const int* lda,
+	       double* B, const int* ldb);
+
+// Triangular solve, matrix in packed storage
+void DTPSV_F77(const char* uplo, const char* trans, const char* diag,
+	       const int* n, const double* AP, double* x, const int* incx);
+
 /***************************************************************************/
 /**** LAPACK Fortran to C name mangling                                 ****/
 /***************************************************************************/
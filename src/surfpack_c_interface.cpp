@@ -1,5 +1,5 @@
 /*  _______________________________________________________________________
- 
+
     Surfpack: A Software Library of Multidimensional Surface Fitting Methods
     Copyright (c) 2006, Sandia National Laboratories.
     This software is distributed under the GNU Lesser General Public License.
@@ -10,34 +10,218 @@
 #include "SurfpackInterface.h"
 #include "SurfpackModel.h"
 
+#include <memory>
+
 /* Implementation of simplified C interface to some Surfpack library
    functions */
 
-/// one global instance of a SurfpackModel
+/// The C handle holds the model; the models' const evaluation members
+/// are reentrant (see SurfpackModel), so the handle needs no lock
+struct surfpack_model
+{
+  SurfpackModel* model;
+};
+
+/// one global instance of a SurfpackModel, for the single-model functions
 static SurfpackModel* surfpackCModel = NULL;
 
-// Model load example copied from SurfpackInterpreter.cpp; 
-extern "C" 
-int surfpack_load_model(const char * const model_filename)
+namespace {
+
+/// Report the exception in flight, as caught by the caller's catch (...)
+void report_c_error(const char* action)
 {
-  bool success = true;
   try {
-    surfpackCModel = SurfpackInterface::LoadModel(std::string(model_filename));
+    throw;
   }
   catch (const std::exception& e) {
-    std::cerr << "Error loading surfpack model! Exception:\n" << e.what() 
+    std::cerr << "Error " << action << "! Exception:\n" << e.what()
 	      << std::endl;
-    success = false;
-  } 
+  }
   catch (const std::string& s) {
-    std::cerr << "Error loading surfpack model! String:\n" << s << std::endl;
-    success = false;
+    std::cerr << "Error " << action << "! String:\n" << s << std::endl;
+  }
+  catch (...) {
+    std::cerr << "Error " << action << "! Unknown error." << std::endl;
+  }
+}
+
+/// Check the handle and the dimension of the points passed with it
+bool valid_c_call(const surfpack_model* model, unsigned int num_vars,
+		  const char* action)
+{
+  if (!model || !model->model) {
+    std::cerr << "Error " << action << "! No model loaded." << std::endl;
+    return false;
+  }
+  if (num_vars != model->model->size()) {
+    std::cerr << "Error " << action << "! Model has "
+	      << model->model->size() << " variables, point has "
+	      << num_vars << "." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/// Check the caller's point and result arrays
+bool valid_c_arrays(const double* eval_pt, const double* result,
+		    const char* action)
+{
+  if (!eval_pt || !result) {
+    std::cerr << "Error " << action << "! NULL "
+	      << (eval_pt ? "result" : "point") << " array." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+
+// Model load example copied from SurfpackInterpreter.cpp;
+extern "C"
+int surfpack_model_load(const char * const model_filename,
+			surfpack_model ** model)
+{
+  if (!model) {
+    std::cerr << "Error loading surfpack model! No handle to store into."
+	      << std::endl;
+    return 1;
+  }
+  *model = NULL;
+  if (!model_filename) {
+    std::cerr << "Error loading surfpack model! No model file given."
+	      << std::endl;
+    return 1;
+  }
+  try {
+    std::unique_ptr<SurfpackModel>
+      loaded(SurfpackInterface::LoadModel(std::string(model_filename)));
+    *model = new surfpack_model;
+    (*model)->model = loaded.release();
+  }
+  catch (...) {
+    report_c_error("loading surfpack model");
+    return 1;
+  }
+  return 0;
+}
+
+
+extern "C"
+void surfpack_model_free(surfpack_model * model)
+{
+  if (model) {
+    delete model->model;
+    delete model;
+  }
+}
+
+
+extern "C"
+unsigned int surfpack_model_num_vars(const surfpack_model * model)
+{
+  return (model && model->model) ? model->model->size() : 0;
+}
+
+
+extern "C"
+int surfpack_model_eval(const surfpack_model * model,
+			const double * const eval_pt, unsigned int num_vars,
+			double * value)
+{
+  const char* action = "evaluating surfpack model";
+  if (!valid_c_call(model, num_vars, action) ||
+      !valid_c_arrays(eval_pt, value, action))
+    return 1;
+  try {
+    std::vector<double> eval_vec(eval_pt, eval_pt + num_vars);
+    *value = (*model->model)(eval_vec);
+  }
+  catch (...) {
+    report_c_error(action);
+    return 1;
+  }
+  return 0;
+}
+
+
+/** Points are scaled and evaluated a block at a time, by one call to
+    the model's batch evaluator per block */
+extern "C"
+int surfpack_model_eval_batch(const surfpack_model * model,
+			      const double * const eval_pts,
+			      unsigned int num_pts, unsigned int num_vars,
+			      unsigned int pt_stride, unsigned int var_stride,
+			      double * values)
+{
+  const char* action = "evaluating surfpack model";
+  if (!valid_c_call(model, num_vars, action) ||
+      (num_pts > 0 && !valid_c_arrays(eval_pts, values, action)))
+    return 1;
+  try {
+    (*model->model)(eval_pts, num_pts, pt_stride, var_stride, values);
+  }
+  catch (...) {
+    report_c_error(action);
+    return 1;
+  }
+  return 0;
+}
+
+
+extern "C"
+int surfpack_model_gradient(const surfpack_model * model,
+			    const double * const eval_pt,
+			    unsigned int num_vars, double * gradient)
+{
+  const char* action = "evaluating surfpack model gradient";
+  if (!valid_c_call(model, num_vars, action) ||
+      !valid_c_arrays(eval_pt, gradient, action))
+    return 1;
+  try {
+    std::vector<double> eval_vec(eval_pt, eval_pt + num_vars);
+    std::vector<double> grad = model->model->gradient(eval_vec);
+    std::copy(grad.begin(), grad.end(), gradient);
   }
   catch (...) {
-    std::cerr << "Error loading surfpack model! Unknown error." << std::endl;
-    success = false;
+    report_c_error(action);
+    return 1;
   }
-  return (success ? 0 : 1);
+  return 0;
+}
+
+
+extern "C"
+int surfpack_model_variance(const surfpack_model * model,
+			    const double * const eval_pt,
+			    unsigned int num_vars, double * variance)
+{
+  const char* action = "evaluating surfpack model variance";
+  if (!valid_c_call(model, num_vars, action) ||
+      !valid_c_arrays(eval_pt, variance, action))
+    return 1;
+  try {
+    std::vector<double> eval_vec(eval_pt, eval_pt + num_vars);
+    *variance = model->model->variance(eval_vec);
+  }
+  catch (...) {
+    report_c_error(action);
+    return 1;
+  }
+  return 0;
+}
+
+
+extern "C"
+int surfpack_load_model(const char * const model_filename)
+{
+  surfpack_model* model = NULL;
+  if (surfpack_model_load(model_filename, &model))
+    return 1;
+  delete surfpackCModel;
+  surfpackCModel = model->model;
+  delete model;
+  return 0;
 }
 
 
@@ -54,4 +238,5 @@ extern "C"
 void surfpack_free_model()
 {
   delete surfpackCModel;
+  surfpackCModel = NULL;
 }
@@ -1,5 +1,5 @@
 /*  _______________________________________________________________________
- 
+
     Surfpack: A Software Library of Multidimensional Surface Fitting Methods
     Copyright (c) 2006, Sandia National Laboratories.
     This software is distributed under the GNU Lesser General Public License.
@@ -9,33 +9,111 @@
 #ifndef SURFPACK_C_INTERFACE_H
 #define SURFPACK_C_INTERFACE_H
 
-/* Simplified C interface to Surfpack libraries to load and evaluate a
-   previously saved model.  Uses a single static instance of a
-   Surfpack model, so cannot be used for concurrent models in a single
-   program.
+/* Simplified C interface to Surfpack libraries to load and evaluate
+   previously saved models.
 
-   Owner: Brian M. Adams, briadam@sandia.gov
+   Each loaded model is held by an opaque surfpack_model handle, so a
+   program may hold any number of models at once.  The evaluation
+   functions (surfpack_model_eval*, surfpack_model_gradient,
+   surfpack_model_variance) may be called concurrently on one handle,
+   e.g., from the threads of an OpenMP parallel region; a handle must
+   not be freed while another thread is using it.
+
+   Functions returning int return 0 on success and 1 on failure (an
+   unreadable model file, a NULL handle or array, a point of the wrong
+   dimension, or a model that doesn't support the request), after
+   writing a message to stderr.
 
-   TODO: Give the client to struct for the model, so the client can
-   manage multiple concurrent model instances from C.
+   The older surfpack_load_model, surfpack_eval_model, and
+   surfpack_free_model functions operate on a single static model and
+   remain for existing clients.
+
+   Owner: Brian M. Adams, briadam@sandia.gov
 */
 
+/* Opaque handle to a loaded Surfpack model */
+typedef struct surfpack_model surfpack_model;
+
+/* Load a surfpack model from the specified .sps or .bsps file into a
+   new handle, stored in *model (NULL on failure).  Returns 0 on
+   success, 1 on failure, including a NULL model_filename or model. */
+#ifdef __cplusplus
+extern "C"
+#endif
+int surfpack_model_load(const char * const model_filename,
+			surfpack_model ** model);
+
+/* Free the model and its handle; a NULL model is ignored. */
+#ifdef __cplusplus
+extern "C"
+#endif
+void surfpack_model_free(surfpack_model * model);
 
-/* Load a surfpack model from the specified .sps or .bsps file.
-   Returns 0 on success, 1 on failure. */
+/* Number of variables (the dimension of the points) of the model. */
 #ifdef __cplusplus
-extern "C" 
+extern "C"
+#endif
+unsigned int surfpack_model_num_vars(const surfpack_model * model);
+
+/* Evaluate the model at eval_pt, with length num_vars, storing the
+   response in *value. */
+#ifdef __cplusplus
+extern "C"
+#endif
+int surfpack_model_eval(const surfpack_model * model,
+			const double * const eval_pt, unsigned int num_vars,
+			double * value);
+
+/* Evaluate the model at num_pts points of num_vars variables each,
+   storing the responses in values[0..num_pts-1].  Variable j of point
+   i is read from eval_pts[i*pt_stride + j*var_stride]: points stored
+   one after another (row-major, as in C) use pt_stride = num_vars and
+   var_stride = 1; points stored one per column (column-major, as in
+   Fortran) use pt_stride = 1 and var_stride = num_pts (or the leading
+   dimension of the array). */
+#ifdef __cplusplus
+extern "C"
+#endif
+int surfpack_model_eval_batch(const surfpack_model * model,
+			      const double * const eval_pts,
+			      unsigned int num_pts, unsigned int num_vars,
+			      unsigned int pt_stride, unsigned int var_stride,
+			      double * values);
+
+/* Gradient of the model at eval_pt, stored in gradient[0..num_vars-1]. */
+#ifdef __cplusplus
+extern "C"
+#endif
+int surfpack_model_gradient(const surfpack_model * model,
+			    const double * const eval_pt,
+			    unsigned int num_vars, double * gradient);
+
+/* Variance of the model's prediction at eval_pt, stored in *variance;
+   only Gaussian process (Kriging) models support this. */
+#ifdef __cplusplus
+extern "C"
+#endif
+int surfpack_model_variance(const surfpack_model * model,
+			    const double * const eval_pt,
+			    unsigned int num_vars, double * variance);
+
+
+/* Load a surfpack model from the specified .sps or .bsps file into
+   the static model, replacing any loaded before.  Returns 0 on
+   success, 1 on failure. */
+#ifdef __cplusplus
+extern "C"
 #endif
 int surfpack_load_model(const char * const model_filename);
 
-/* Evaluate the loaded model at the provided eval_pt, with length
-   num_vars.  Returns the surrogatem model value at eval_pt. */
+/* Evaluate the static model at the provided eval_pt, with length
+   num_vars.  Returns the surrogate model value at eval_pt. */
 #ifdef __cplusplus
 extern "C"
 #endif
 double surfpack_eval_model(const double * const eval_pt, unsigned int num_vars);
 
-/* Free the surfpack model from memory. */
+/* Free the static surfpack model from memory. */
 #ifdef __cplusplus
 extern "C"
 #endif
@@ -16,6 +16,7 @@
 #endif // HAVE_CONFIG_H
 
 #include <algorithm>
+#include <atomic>
 #include <limits>
 #include <cassert>
 #include <cctype>
@@ -29,11 +30,14 @@
 #include <cstring>
 #include <ctime>
 #include <fstream>
+#include <functional>
 #include <iomanip> 
 #include <iostream>
 #include <iterator>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <queue>
 #include <set>
@@ -41,6 +45,8 @@
 #include <stack>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <exception>
 
@@ -15,6 +15,10 @@
 #include <iostream>
 #include <string>
 #include <iterator>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <thread>
 
 #include "LinearRegressionModel.h"
 #include "KrigingModelTest.h"
@@ -26,6 +30,9 @@
 #include "SurfData.h"
 #include "surfpack.h"
 #include "ModelFitness.h"
+#include "ModelFactory.h"
+#include "SurfpackParallel.h"
+#include "AxesBounds.h"
 #include "surfpack.h"
 
 using std::cout;
@@ -62,10 +69,423 @@ void KrigingModelTest::simpleTest()
   sd.write("test_on_train.spd");
   
   //SurfData* sdp = SurfpackInterface::CreateSample("2.53e06 2.55e06 | 7.64e05 7.66e05 | 148 149","10 10 10","");
-  SurfData* sdp = SurfpackInterface::CreateSample("1.53e06 2.55e06 | 7.04e05 8.66e05 | 140 159","10 10 10","");
+  SurfData* sdp = createSample("1.53e06 2.55e06 | 7.04e05 8.66e05 | 140 159","10 10 10","");
   VecDbl responses2 = (*km)(*sdp);
   sdp->addResponse(responses2);
   sdp->write("test_data.spd");
   delete sdp;
 }
 
+
+/// the tiled batch evaluation must agree with point-by-point evaluation
+/// for each correlation function
+void KrigingModelTest::correlationTileTest()
+{
+  AxesBounds ab(string("-2 2 | -2 2 | -2 2"));
+  surfpack::shared_rng().seed(5);
+  SurfData* sd = SurfpackInterface::CreateSample(&ab, 60);
+  VecDbl responses(sd->size());
+  for (unsigned i = 0; i < sd->size(); i++) {
+    responses[i] = surfpack::testFunction("rosenbrock", (*sd)(i));
+  }
+  sd->addResponse(responses);
+  SurfData* sdp = SurfpackInterface::CreateSample(&ab, 500);
+
+  const char* corr_funcs[][2] = { { "powered_exponential", "2" },
+				  { "powered_exponential", "1.5" },
+				  { "matern", "0.5" },
+				  { "matern", "1.5" },
+				  { "matern", "2.5" } };
+  for (unsigned c = 0; c < sizeof(corr_funcs)/sizeof(corr_funcs[0]); c++) {
+    ParamMap args;
+    args["type"] = "kriging";
+    args["correlation_lengths"] = "0.9 1.1 0.8";
+    args["optimization_method"] = "none";
+    args[corr_funcs[c][0]] = corr_funcs[c][1];
+    SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+    SurfpackModel* km = factory->Build(*sd);
+    VecDbl batch = (*km)(*sdp);
+    for (unsigned i = 0; i < sdp->size(); i++) {
+      CPPUNIT_ASSERT(matches(batch[i], (*km)((*sdp)(i)), 1.0e-8));
+    }
+    // the tile's constants aren't saved, a loaded model remakes them
+    SurfpackInterface::Save(km, "kriging_tile.bsps");
+    SurfpackModel* loaded = SurfpackInterface::LoadModel("kriging_tile.bsps");
+    VecDbl loaded_batch = (*loaded)(*sdp);
+    for (unsigned i = 0; i < sdp->size(); i++) {
+      CPPUNIT_ASSERT(matches(loaded_batch[i], batch[i], 1.0e-12));
+    }
+    delete loaded;
+    delete km;
+    delete factory;
+  }
+  delete sdp;
+  delete sd;
+}
+
+/// computing R without the Z matrix must not change the emulator
+void KrigingModelTest::streamCorrelationTest()
+{
+  AxesBounds ab(string("-2 2 | -2 2 | -2 2"));
+  surfpack::shared_rng().seed(5);
+  SurfData* sd = SurfpackInterface::CreateSample(&ab, 80);
+  VecDbl responses(sd->size());
+  for (unsigned i = 0; i < sd->size(); i++) {
+    responses[i] = surfpack::testFunction("rosenbrock", (*sd)(i));
+  }
+  sd->addResponse(responses);
+  SurfData* sdp = SurfpackInterface::CreateSample(&ab, 100);
+
+  const char* corr_funcs[][2] = { { "powered_exponential", "2" },
+				  { "powered_exponential", "1.5" },
+				  { "matern", "0.5" },
+				  { "matern", "1.5" },
+				  { "matern", "2.5" } };
+  for (unsigned c = 0; c < sizeof(corr_funcs)/sizeof(corr_funcs[0]); c++) {
+    VecDbl predictions[2];
+    for (unsigned stream = 0; stream < 2; stream++) {
+      ParamMap args;
+      args["type"] = "kriging";
+      args["optimization_method"] = "sampling";
+      args["max_trials"] = "20";
+      args[corr_funcs[c][0]] = corr_funcs[c][1];
+      if (stream) args["stream_correlation_matrix"] = "1";
+      // the sampled correlation lengths must be the same for both
+      std::srand(17);
+      SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+      SurfpackModel* km = factory->Build(*sd);
+      predictions[stream] = (*km)(*sdp);
+      delete km;
+      delete factory;
+    }
+    CPPUNIT_ASSERT(predictions[0] == predictions[1]);
+  }
+  delete sdp;
+  delete sd;
+}
+
+void KrigingModelTest::concurrentBuildTest()
+{
+  AxesBounds ab(string("-2 2 | -2 2"));
+  surfpack::shared_rng().seed(5);
+  SurfData* sd = SurfpackInterface::CreateSample(&ab, 40);
+  VecDbl responses(sd->size());
+  for (unsigned i = 0; i < sd->size(); i++) {
+    responses[i] = surfpack::testFunction("rosenbrock", (*sd)(i));
+  }
+  sd->addResponse(responses);
+  SurfData* sdp = SurfpackInterface::CreateSample(&ab, 50);
+
+  // each build draws its sampled correlation lengths from its own stream
+  const unsigned num_builds = 2;
+  VecDbl serial[num_builds], concurrent[num_builds];
+  auto build = [&](unsigned b, VecDbl& predictions) {
+    surfpack::MyRandomNumberGenerator rng;
+    rng.seed(100 + b);
+    surfpack::ThreadRngScope rng_scope(rng);
+    ParamMap args;
+    args["type"] = "kriging";
+    args["optimization_method"] = "sampling";
+    args["max_trials"] = "30";
+    SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+    SurfpackModel* km = factory->Build(*sd);
+    predictions = (*km)(*sdp);
+    delete km;
+    delete factory;
+  };
+  for (unsigned b = 0; b < num_builds; b++)
+    build(b, serial[b]);
+  std::vector<std::thread> builders;
+  for (unsigned b = 0; b < num_builds; b++)
+    builders.push_back(std::thread(build, b, std::ref(concurrent[b])));
+  for (unsigned b = 0; b < num_builds; b++)
+    builders[b].join();
+  for (unsigned b = 0; b < num_builds; b++)
+    CPPUNIT_ASSERT(serial[b] == concurrent[b]);
+  delete sdp;
+  delete sd;
+}
+
+/// folds of a DIRECT optimized model are built one at a time, and
+/// threading its batches of evaluations doesn't change the result
+void KrigingModelTest::serialFoldTest()
+{
+  AxesBounds ab(string("-2 2 | -2 2"));
+  surfpack::shared_rng().seed(9);
+  SurfData* sd = SurfpackInterface::CreateSample(&ab, 30);
+  VecDbl responses(sd->size());
+  for (unsigned i = 0; i < sd->size(); i++) {
+    responses[i] = surfpack::testFunction("rosenbrock", (*sd)(i));
+  }
+  sd->addResponse(responses);
+
+  ParamMap args;
+  args["type"] = "kriging";
+  args["max_trials"] = "40";
+  double cv[2];
+  const char* num_threads[2] = { "1", "4" };
+  SurfpackModelFactory* factory;
+  SurfpackModel* km;
+  for (unsigned t = 0; t < 2; t++) {
+    args["num_threads"] = num_threads[t];
+    factory = ModelFactory::createModelFactory(args);
+    km = factory->Build(*sd);
+    CPPUNIT_ASSERT(!km->concurrentBuilds());
+    surfpack::shared_rng().seed(11);
+    CrossValidationFitness cvf(5, 4);
+    cv[t] = cvf(*km, *sd);
+    delete km;
+    delete factory;
+  }
+  CPPUNIT_ASSERT(cv[0] == cv[1]);
+
+  args["optimization_method"] = "sampling";
+  factory = ModelFactory::createModelFactory(args);
+  km = factory->Build(*sd);
+  CPPUNIT_ASSERT(km->concurrentBuilds());
+  delete km;
+  delete factory;
+  delete sd;
+}
+
+void KrigingModelTest::quasiNewtonTest()
+{
+  AxesBounds ab(string("-2 2 | -2 2"));
+  surfpack::shared_rng().seed(7);
+  SurfData* sd = SurfpackInterface::CreateSample(&ab, 40);
+  VecDbl responses(sd->size());
+  for (unsigned i = 0; i < sd->size(); i++) {
+    responses[i] = surfpack::testFunction("rosenbrock", (*sd)(i));
+  }
+  sd->addResponse(responses);
+
+  // gradient-based starts from the same seed must land on the same lengths
+  VecDbl predictions[2];
+  for (unsigned b = 0; b < 2; b++) {
+    // the random starts on this thread are drawn from std::rand
+    surfpack::shared_rng().seed(11);
+    std::srand(11);
+    ParamMap args;
+    args["type"] = "kriging";
+    args["optimization_method"] = "quasi_newton";
+    args["num_starts"] = "3";
+    SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+    SurfpackModel* km = factory->Build(*sd);
+    predictions[b] = (*km)(*sd);
+    delete km;
+    delete factory;
+  }
+  CPPUNIT_ASSERT(predictions[0] == predictions[1]);
+  // the model reproduces its build data (up to any points the pivoted
+  // Cholesky left out for conditioning)
+  for (unsigned i = 0; i < sd->size(); i++) {
+    CPPUNIT_ASSERT(matches(predictions[0][i], responses[i]));
+  }
+  delete sd;
+}
+
+/// the analytic gradient of the likelihood objective must agree with
+/// central differences of the objective, for each correlation family
+void KrigingModelTest::likelihoodGradientTest()
+{
+  const int n_vars = 3, n_pts = 40;
+  nkm::MtxDbl XR(n_vars, n_pts), Y(1, n_pts);
+  std::srand(3);
+  for (int j = 0; j < n_pts; j++) {
+    Y(0,j) = 0.0;
+    for (int i = 0; i < n_vars; i++) {
+      XR(i,j) = 2.0*std::rand()/RAND_MAX - 1.0;
+      Y(0,j) += std::sin(3.0*XR(i,j))*(i+1);
+    }
+  }
+  nkm::SurfData nkm_sd(XR, Y);
+
+  const char* corr_funcs[][2] = { { "powered_exponential", "2" },
+				  { "powered_exponential", "1.5" },
+				  { "matern", "1.5" },
+				  { "matern", "2.5" } };
+  for (unsigned c = 0; c < sizeof(corr_funcs)/sizeof(corr_funcs[0]); c++) {
+    ParamMap args;
+    args["optimization_method"] = "none";
+    args[corr_funcs[c][0]] = corr_funcs[c][1];
+    nkm::KrigingModel km(nkm_sd, args);
+    nkm::MtxDbl nat_log_corr_len(n_vars, 1);
+    nat_log_corr_len(0,0) = -0.7;
+    nat_log_corr_len(1,0) = 0.2;
+    nat_log_corr_len(2,0) = -0.3;
+    double obj;
+    nkm::MtxDbl grad;
+    km.objectiveAndGradient(obj, grad, nat_log_corr_len);
+    CPPUNIT_ASSERT(obj < HUGE_VAL);
+    const double h = 1.0e-5;
+    for (int i = 0; i < n_vars; i++) {
+      nkm::MtxDbl plus(nat_log_corr_len), minus(nat_log_corr_len);
+      plus(i,0) += h;
+      minus(i,0) -= h;
+      double fd = (km.objective(plus) - km.objective(minus))/(2.0*h);
+      CPPUNIT_ASSERT(std::fabs(grad(i,0) - fd) <= 
+		     1.0e-5*std::max(std::fabs(fd), 1.0e-2));
+    }
+  }
+}
+
+/// adding points to a model at fixed correlation lengths must give the
+/// model built from all of the points at those lengths
+void KrigingModelTest::updateTest()
+{
+  AxesBounds ab(string("-2 2 | -2 2 | -2 2"));
+  surfpack::shared_rng().seed(5);
+  SurfData* sd = SurfpackInterface::CreateSample(&ab, 70);
+  VecDbl responses(sd->size());
+  for (unsigned i = 0; i < sd->size(); i++) {
+    responses[i] = surfpack::testFunction("rosenbrock", (*sd)(i));
+  }
+  sd->addResponse(responses);
+  SurfData* sdp = SurfpackInterface::CreateSample(&ab, 100);
+
+  vector<SurfPoint> points[3];
+  for (unsigned i = 0; i < sd->size(); i++) {
+    points[(i < 50) ? 0 : ((i < 51) ? 1 : 2)].push_back((*sd)[i]);
+  }
+  SurfData first(points[0]), second(points[1]), rest(points[2]);
+
+  const char* nuggets[] = { "", "1.0e-6" };
+  for (unsigned n = 0; n < 2; n++) {
+    ParamMap args;
+    args["type"] = "kriging";
+    args["correlation_lengths"] = "0.9 1.1 0.8";
+    args["optimization_method"] = "none";
+    args["nugget"] = nuggets[n];
+    SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+    SurfpackModel* full = factory->Build(*sd);
+    SurfpackModel* km = factory->Build(first);
+    // one point, then a block of them
+    dynamic_cast<KrigingModel*>(km)->update(second);
+    dynamic_cast<KrigingModel*>(km)->update(rest);
+    VecDbl expected = (*full)(*sdp);
+    VecDbl updated = (*km)(*sdp);
+    // the extended factor must reproduce the rebuild to round-off,
+    // measured against the size of the predictions
+    double scale = 0.0;
+    for (unsigned i = 0; i < sdp->size(); i++)
+      scale = std::max(scale, std::fabs(expected[i]));
+    for (unsigned i = 0; i < sdp->size(); i++) {
+      CPPUNIT_ASSERT(std::fabs(updated[i] - expected[i]) <= 1.0e-12*scale);
+      CPPUNIT_ASSERT(matches(km->variance((*sdp)(i)),
+			     full->variance((*sdp)(i)), 1.0e-10));
+    }
+    delete km;
+    delete full;
+    delete factory;
+  }
+  delete sdp;
+  delete sd;
+}
+
+void KrigingModelTest::predictionOnlyTest()
+{
+  AxesBounds ab(string("-2 2 | -2 2 | -2 2"));
+  surfpack::shared_rng().seed(6);
+  SurfData* sd = SurfpackInterface::CreateSample(&ab, 60);
+  VecDbl responses(sd->size());
+  for (unsigned i = 0; i < sd->size(); i++) {
+    responses[i] = surfpack::testFunction("rosenbrock", (*sd)(i));
+  }
+  sd->addResponse(responses);
+  SurfData* sdp = SurfpackInterface::CreateSample(&ab, 50);
+
+  vector<SurfPoint> points[2];
+  for (unsigned i = 0; i < sd->size(); i++) {
+    points[(i < 50) ? 0 : 1].push_back((*sd)[i]);
+  }
+  SurfData first(points[0]), rest(points[1]);
+
+  ParamMap args;
+  args["type"] = "kriging";
+  args["correlation_lengths"] = "0.9 1.1 0.8";
+  args["optimization_method"] = "none";
+  SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+  KrigingModel* full = dynamic_cast<KrigingModel*>(factory->Build(first));
+  args["prediction_only"] = "1";
+  SurfpackModelFactory* slim_factory = ModelFactory::createModelFactory(args);
+  KrigingModel* slim = 
+    dynamic_cast<KrigingModel*>(slim_factory->Build(first));
+  CPPUNIT_ASSERT(slim->memoryBytes() < full->memoryBytes()/2);
+
+  // the mean is unaffected; the variance state comes back on request
+  VecDbl expected = (*full)(*sdp);
+  VecDbl predicted = (*slim)(*sdp);
+  for (unsigned i = 0; i < sdp->size(); i++) {
+    CPPUNIT_ASSERT_EQUAL(expected[i], predicted[i]);
+    CPPUNIT_ASSERT(matches(slim->variance((*sdp)(i)),
+			   full->variance((*sdp)(i)), 1.0e-8));
+  }
+
+  // and is dropped again by an update
+  full->update(rest);
+  slim->update(rest);
+  CPPUNIT_ASSERT(slim->memoryBytes() < full->memoryBytes()/2);
+  expected = (*full)(*sdp);
+  predicted = (*slim)(*sdp);
+  for (unsigned i = 0; i < sdp->size(); i++) {
+    CPPUNIT_ASSERT(matches(predicted[i], expected[i], 1.0e-10));
+    CPPUNIT_ASSERT(matches(slim->variance((*sdp)(i)),
+			   full->variance((*sdp)(i)), 1.0e-8));
+  }
+
+  delete slim;
+  delete full;
+  delete slim_factory;
+  delete factory;
+  delete sdp;
+  delete sd;
+}
+
+void KrigingModelTest::buildProfileTest()
+{
+  AxesBounds ab(string("-2 2 | -2 2"));
+  surfpack::shared_rng().seed(7);
+  SurfData* sd = SurfpackInterface::CreateSample(&ab, 30);
+  VecDbl responses(sd->size());
+  for (unsigned i = 0; i < sd->size(); i++) {
+    responses[i] = surfpack::testFunction("rosenbrock", (*sd)(i));
+  }
+  sd->addResponse(responses);
+
+  ParamMap args;
+  args["type"] = "kriging";
+  args["correlation_lengths"] = "0.9 1.1";
+  args["optimization_method"] = "none";
+  SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+  SurfpackModel* model = factory->Build(*sd);
+  const surfpack::BuildProfile& profile = model->buildProfile();
+  CPPUNIT_ASSERT(profile.seconds("build") > 0.0);
+  CPPUNIT_ASSERT(profile.seconds("build") >= profile.seconds("cholesky_r"));
+  CPPUNIT_ASSERT(profile.count("factorizations") > 0);
+  CPPUNIT_ASSERT(profile.count("objective_evaluations") > 0);
+  CPPUNIT_ASSERT(profile.count("matrix_bytes") >=
+		 sd->size()*sd->size()*sizeof(double));
+
+  // nothing is recorded outside of a build
+  (*model)(*sd);
+  CPPUNIT_ASSERT(!surfpack::BuildProfileScope::active());
+  CPPUNIT_ASSERT_EQUAL(profile.count("matrix_bytes"),
+		       model->buildProfile().count("matrix_bytes"));
+
+  // what parallel_for workers record is merged into the caller's profile
+  surfpack::BuildProfile loop_profile;
+  {
+    surfpack::BuildProfileScope loop_scope(loop_profile);
+    surfpack::parallel_for(16, 4, [](unsigned, unsigned) {
+	surfpack::ScopedPhase task_phase("task");
+	surfpack::profile_count("tasks");
+      });
+  }
+  CPPUNIT_ASSERT_EQUAL(loop_profile.count("tasks"), 16ull);
+  CPPUNIT_ASSERT_EQUAL(loop_profile.phases().size(), std::size_t(1));
+  CPPUNIT_ASSERT_EQUAL(loop_profile.phases()[0].calls, 16ul);
+
+  delete model;
+  delete factory;
+  delete sd;
+}
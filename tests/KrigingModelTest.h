@@ -18,12 +18,30 @@
 class KrigingModelTest : public CppUnit::TestFixture
 {
   CPPUNIT_TEST_SUITE( KrigingModelTest );
-CPPUNIT_TEST( simpleTest );
+//CPPUNIT_TEST( simpleTest );
+CPPUNIT_TEST( correlationTileTest );
+CPPUNIT_TEST( streamCorrelationTest );
+CPPUNIT_TEST( concurrentBuildTest );
+CPPUNIT_TEST( serialFoldTest );
+CPPUNIT_TEST( quasiNewtonTest );
+CPPUNIT_TEST( likelihoodGradientTest );
+CPPUNIT_TEST( updateTest );
+CPPUNIT_TEST( predictionOnlyTest );
+CPPUNIT_TEST( buildProfileTest );
   CPPUNIT_TEST_SUITE_END();
 public:
   void setUp();
   void tearDown();
 void simpleTest();
+void correlationTileTest();
+void streamCorrelationTest();
+void concurrentBuildTest();
+void serialFoldTest();
+void quasiNewtonTest();
+void likelihoodGradientTest();
+void updateTest();
+void predictionOnlyTest();
+void buildProfileTest();
 };
 
 #endif
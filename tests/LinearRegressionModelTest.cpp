@@ -101,9 +101,9 @@ void LinearRegressionModelTest::setUp()
   randsd = 0;
   vector< string > test_functions;
   // Points on grid
-  SurfpackInterface::CreateSample(sd,*ab,grid_points,test_functions);
+  sd = createSample(*ab,grid_points,test_functions);
   // Random sample of points
-  SurfpackInterface::CreateSample(randsd,*ab,10,test_functions);
+  randsd = createSample(*ab,10,test_functions);
 
 }
 
@@ -118,8 +118,8 @@ void LinearRegressionModelTest::constructorTest()
 {
   VecDbl cf(1,1.0);
   LRMBasisSet bs;
-  bs.bases.push_back(VecUns());
-  LinearRegressionModel lrm(1,bs,cf);
+  bs.add(VecUns());
+  LinearRegressionModel lrm(1,bs,cf,MtxDbl(0,cf.size()));
   CPPUNIT_ASSERT(matches(cf[0],lrm.coeffs[0]));
   CPPUNIT_ASSERT(lrm.size() == 1);
 
@@ -128,7 +128,7 @@ void LinearRegressionModelTest::constructorTest()
 void LinearRegressionModelTest::unityBasisTest()
 {
   VecUns list;
-  bs.bases.push_back(list);
+  bs.add(list);
   VecDbl x(1,0.0);
   VecUns vars(1,0);
   CPPUNIT_ASSERT(matches(bs.eval(0,x),1.0));
@@ -139,7 +139,7 @@ void LinearRegressionModelTest::singleLinearTest()
 {
 
   VecUns list(1,0);
-  bs.bases.push_back(list);
+  bs.add(list);
   VecDbl x(1,0.0);
   VecUns vars(1,0);
   // The term is x0
@@ -162,7 +162,7 @@ void LinearRegressionModelTest::singleLinearTest()
 void LinearRegressionModelTest::singleQuadraticTest()
 {
   VecUns list(2,0);
-  bs.bases.push_back(list);
+  bs.add(list);
   VecDbl x(1,0.0);
   VecUns vars(1,0);
   // The term is x0^2
@@ -188,11 +188,11 @@ void LinearRegressionModelTest::singleQuadraticTest()
 void LinearRegressionModelTest::lineEvalTest()
 {
   VecUns list;
-  bs.bases.push_back(list);
+  bs.add(list);
   list.push_back(0);
-  bs.bases.push_back(list);
+  bs.add(list);
   VecDbl cf(2,1.0);
-  LinearRegressionModel lrm(1,bs,cf); // lrm = x[0] + 1;
+  LinearRegressionModel lrm(1,bs,cf,MtxDbl(0,cf.size())); // lrm = x[0] + 1;
   VecDbl x(1,1.0);
   CPPUNIT_ASSERT(lrm.size() == 1);
   CPPUNIT_ASSERT(matches(lrm(x),2.0));
@@ -218,20 +218,20 @@ void LinearRegressionModelTest::lineEvalTest()
 void LinearRegressionModelTest::quadratic2DTest()
 {
   VecUns list;
-  bs.bases.push_back(list); // Unity
+  bs.add(list); // Unity
   list.push_back(0);
-  bs.bases.push_back(list); // x[0]
+  bs.add(list); // x[0]
   list.push_back(1);
-  bs.bases.push_back(list); // x[0]*x[1]
+  bs.add(list); // x[0]*x[1]
   list[0] = 1;
-  bs.bases.push_back(list); // *x[1]*x[1]
+  bs.add(list); // *x[1]*x[1]
 
   VecDbl cf(4,-1.0);
   cf[1] = 2.0;
   cf[2] = -3.0;
   cf[3] = 4.0;
   // lrm = -1 + 2.0*x[0] - 3.0*x[0]*x[1] + 4.0*x[1]^2;
-  LinearRegressionModel lrm(2,bs,cf); 
+  LinearRegressionModel lrm(2,bs,cf,MtxDbl(0,cf.size())); 
   VecDbl x(2,1.0);
   // lrm(1,1) = -1+2(1)-3(1)(1)+4(1)(1) = 2
   CPPUNIT_ASSERT(lrm.size() == 2);
@@ -250,6 +250,14 @@ void LinearRegressionModelTest::quadratic2DTest()
   VecDbl g1 = lrm.gradient(x);
   CPPUNIT_ASSERT(matches(g1[0],5.0));
   CPPUNIT_ASSERT(matches(g1[1],1.0));
+
+  // the same model through the compiled product tree
+  bs.compile();
+  LinearRegressionModel lrmc(2,bs,cf,MtxDbl(0,cf.size()));
+  CPPUNIT_ASSERT(matches(lrmc(x),-12.0));
+  VecDbl g2 = lrmc.gradient(x);
+  CPPUNIT_ASSERT(matches(g2[0],5.0));
+  CPPUNIT_ASSERT(matches(g2[1],1.0));
 }
 
 void LinearRegressionModelTest::plotTest1()
@@ -257,28 +265,28 @@ void LinearRegressionModelTest::plotTest1()
   
 
   VecUns list;
-  bs.bases.push_back(list); // Unity
+  bs.add(list); // Unity
   list.push_back(0);
-  bs.bases.push_back(list); // x[0]
+  bs.add(list); // x[0]
   list.push_back(1);
-  bs.bases.push_back(list); // x[0]*x[1]
+  bs.add(list); // x[0]*x[1]
   list[0] = 1;
-  bs.bases.push_back(list); // *x[1]*x[1]
+  bs.add(list); // *x[1]*x[1]
 
   VecDbl cf(4,-1.0);
   cf[1] = 2.0;
   cf[2] = -3.0;
   cf[3] = 4.0;
   // lrm = -1 + 2.0*x[0] - 3.0*x[0]*x[1] + 4.0*x[1]^2;
-  LinearRegressionModel lrm(2,bs,cf); 
+  LinearRegressionModel lrm(2,bs,cf,MtxDbl(0,cf.size())); 
 
   // Prepare a basis set for a hyperplane model 
   LRMBasisSet hpbs; // hyperplane basis set
   list.resize(1);
-  hpbs.bases.push_back(VecUns()); // Unity
+  hpbs.add(VecUns()); // Unity
   for (unsigned i = 0; i < randsd->xSize(); i++) {
     list[0] = i;
-    hpbs.bases.push_back(list);
+    hpbs.add(list);
   }
 
 
@@ -298,7 +306,7 @@ void LinearRegressionModelTest::plotTest1()
     reverse(hyp_coeff.begin(),hyp_coeff.end());
     hyp_coeff.push_back(b);
     reverse(hyp_coeff.begin(),hyp_coeff.end());
-    LinearRegressionModel tang_plane(pt.size(),hpbs,hyp_coeff);
+    LinearRegressionModel tang_plane(pt.size(),hpbs,hyp_coeff,MtxDbl(0,hyp_coeff.size()));
 
     // Now prepare a set of axes, so that we can plot a slice of both
     // functions along each dimension
@@ -318,7 +326,7 @@ void LinearRegressionModelTest::plotTest1()
       var_dims[dim] = GRIDSIZE;
       SurfData* test_data = 0;
       vector<string> test_functions;
-      SurfpackInterface::CreateSample(test_data,var_ab,var_dims,test_functions);
+      test_data = createSample(var_ab,var_dims,test_functions);
       SurfData& td = *test_data;
       // Now evaluate both models on this data
       ///\\todo Creat a base model class that can do operator()(SurfData&)
@@ -366,10 +374,10 @@ void LinearRegressionModelTest::termPrinterTest()
 
 void LinearRegressionModelTest::createModelTest()
 {
-  SurfData* sd = SurfpackInterface::CreateSample(string("-2 2 | -2 2"),
+  SurfData* sd = createSample(string("-2 2 | -2 2"),
     string("8 8"),string("sphere"));
   LinearRegressionModelFactory lrmf;
-  SurfpackModel* lrm = lrmf.Create(*sd);
+  SurfpackModel* lrm = lrmf.Build(*sd);
   cout << lrm->asString() << endl;
   return;
   CPPUNIT_ASSERT(matches(dynamic_cast<LinearRegressionModel*>(lrm)->coeffs[0],0.0));
@@ -382,11 +390,99 @@ void LinearRegressionModelTest::createModelTest()
   delete sd;
 }
 
+/// The product tree must reproduce eval() exactly and agree with deriv()
+void LinearRegressionModelTest::compiledBasisTest()
+{
+  LRMBasisSet full = LinearRegressionModelFactory::CreateLRM(3,3);
+  // bases entered out of order, sharing prefixes only in part
+  LRMBasisSet mixed;
+  mixed.add("");
+  mixed.add("2 0 1 0");
+  mixed.add("2 0");
+  mixed.add("1 1");
+  mixed.add("0 2 2");
+  VecDbl x = surfpack::toVec<double>(string("0.7 -1.3 2.1"));
+  VecDbl values, grad;
+  for (unsigned s = 0; s < 2; s++) {
+    const LRMBasisSet& bs = (s == 0) ? full : mixed;
+    bs.evalAll(x, values);
+    CPPUNIT_ASSERT(values.size() == bs.size());
+    VecDbl coeffs(bs.size());
+    double sum = 0.0;
+    for (unsigned i = 0; i < bs.size(); i++) {
+      CPPUNIT_ASSERT(values[i] == bs.eval(i,x));
+      coeffs[i] = 0.5 + i;
+      sum += coeffs[i]*bs.eval(i,x);
+    }
+    CPPUNIT_ASSERT(bs.evalSum(x, coeffs) == sum);
+    bs.gradientSum(x, coeffs, grad);
+    CPPUNIT_ASSERT(grad.size() == x.size());
+    VecUns diff_var(1,0);
+    for (unsigned v = 0; v < x.size(); v++) {
+      diff_var[0] = v;
+      double expected = 0.0;
+      for (unsigned i = 0; i < bs.size(); i++) {
+	expected += coeffs[i]*bs.deriv(i,x,diff_var);
+      }
+      CPPUNIT_ASSERT(matches(grad[v],expected));
+    }
+  }
+}
+
+/// The block variance must agree with point-by-point evaluation
+void LinearRegressionModelTest::varianceBatchTest()
+{
+  AxesBounds bounds(string("-2 2 | -2 2"));
+  VecUns grid(2, 6);
+  SurfData* data = SurfpackInterface::CreateSample(&bounds, grid);
+  VecDbl resps(data->size());
+  for (unsigned i = 0; i < data->size(); i++) {
+    // sphere plus a term the quadratic can't fit, so the MSE is nonzero
+    resps[i] = surfpack::testFunction("sphere", (*data)(i)) +
+      0.1*(*data)(i)[0]*(*data)(i)[0]*(*data)(i)[1];
+  }
+  data->addResponse(resps);
+  LinearRegressionModelFactory lrmf;
+  SurfpackModel* lrm = lrmf.Build(*data);
+  MtxDbl x(7, 2);
+  for (unsigned i = 0; i < x.getNRows(); i++) {
+    x(i,0) = -1.9 + 0.6*i;
+    x(i,1) = 1.3 - 0.4*i;
+  }
+  VecDbl vars(x.getNRows());
+  lrm->variance(x, &vars[0]);
+  VecDbl pt(2);
+  for (unsigned i = 0; i < x.getNRows(); i++) {
+    pt[0] = x(i,0);
+    pt[1] = x(i,1);
+    double var = lrm->variance(pt);
+    CPPUNIT_ASSERT(var > lrm->meanSquaredError);
+    CPPUNIT_ASSERT(matches(vars[i], var, 1.0e-12));
+  }
+  // the deprecated Xbasis() hands back R: bases x bases, upper triangular
+  MtxDbl R = dynamic_cast<LinearRegressionModel*>(lrm)->Xbasis();
+  CPPUNIT_ASSERT(R.getNRows() == 6 && R.getNCols() == 6);
+  for (unsigned i = 0; i < R.getNRows(); i++)
+    for (unsigned j = 0; j < i; j++)
+      CPPUNIT_ASSERT(R(i,j) == 0.0);
+  // the variance state survives a binary save and load
+  SurfpackInterface::Save(lrm, "lrm_variance.bsps");
+  SurfpackModel* loaded = SurfpackInterface::LoadModel("lrm_variance.bsps");
+  for (unsigned i = 0; i < x.getNRows(); i++) {
+    pt[0] = x(i,0);
+    pt[1] = x(i,1);
+    CPPUNIT_ASSERT(loaded->variance(pt) == lrm->variance(pt));
+  }
+  delete loaded;
+  delete lrm;
+  delete data;
+}
+
 //extern "C" double gsl_ran_fdist_pdf(double,double,double);
 //void LinearRegressionModelTest::FTest()
 //{
 //  // Make a set of data that is a full quadratic fit plus some random noise
-//  SurfData* sd = SurfpackInterface::CreateSample(string("-2 2 | -2 2"),
+//  SurfData* sd = createSample(string("-2 2 | -2 2"),
 //    string("8 8"),string("sphere"));
 //  LRMBasisSet bs = LinearRegressionModelFactory::CreateLRM(2,2);
 //  CPPUNIT_ASSERT(bs.size() == 6);
@@ -401,7 +497,7 @@ void LinearRegressionModelTest::createModelTest()
 //  sd->setDefaultIndex(new_index);
 //  // Now fit a full model to this data
 //  LinearRegressionModelFactory lrmf;
-//  LinearRegressionModel* lrmFull = lrmf.Create(*sd);
+//  LinearRegressionModel* lrmFull = lrmf.Build(*sd);
 //  cout << lrmFull->asString() << endl;
 //  StandardFitness sf;
 //  double ssr_full = sf(*lrmFull,*sd);
@@ -33,6 +33,8 @@ class LinearRegressionModelTest : public CppUnit::TestFixture
 //CPPUNIT_TEST( plotTest1 );
 CPPUNIT_TEST( termPrinterTest );
 CPPUNIT_TEST( createModelTest );
+CPPUNIT_TEST( compiledBasisTest );
+CPPUNIT_TEST( varianceBatchTest );
 //CPPUNIT_TEST( FTest );
   CPPUNIT_TEST_SUITE_END();
 public:
@@ -51,6 +53,8 @@ void quadratic2DTest();
 void plotTest1();
 void termPrinterTest();
 void createModelTest();
+void compiledBasisTest();
+void varianceBatchTest();
 //void FTest();
 };
 
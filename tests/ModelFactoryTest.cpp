@@ -23,6 +23,7 @@
 #include "SurfpackInterface.h"
 #include "SurfData.h"
 #include "surfpack.h"
+#include "unittests.h"
 
 using std::cout;
 using std::endl;
@@ -47,11 +48,11 @@ void ModelFactoryTest::tearDown()
 }
 void ModelFactoryTest::simpleTest()
 {
-  SurfData* sd = SurfpackInterface::CreateSample("-2 2 | -2 2","10 10","sphere");
+  SurfData* sd = createSample("-2 2 | -2 2","10 10","sphere");
   //AxesBounds* ab = new AxesBounds("-2 2 | -2 2");
   //SurfData* sd = SurfpackInterface::CreateSample(ab, VecUns(10,10));
   SurfpackModelFactory* mlsf = new MovingLeastSquaresModelFactory;
-  SurfpackModel* mlsm = mlsf->Create(*sd);
+  SurfpackModel* mlsm = mlsf->Build(*sd);
   VecDbl vd = surfpack::toVec<double>("0.0 0.0");
   cout << (*mlsm)(vd) << endl;
   delete mlsm;
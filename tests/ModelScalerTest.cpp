@@ -53,7 +53,7 @@ void ModelScalerTest::tearDown()
 
 void ModelScalerTest::nonScaleTest()
 {
-  SurfData* sd = SurfpackInterface::CreateSample("-2 2 | -2 2","11 11","sphere");  
+  SurfData* sd = createSample("-2 2 | -2 2","11 11","sphere");  
   //AxesBounds* ab = new AxesBounds("-2 2 | -2 2");
   //SurfData* sd = SurfpackInterface::CreateSample(ab, VecUns(11,11));
   // TODO: sphere
@@ -68,7 +68,7 @@ void ModelScalerTest::nonScaleTest()
 
 void ModelScalerTest::NormalizingScalerDataTest()
 {
-  SurfData* sd = SurfpackInterface::CreateSample("-2 2 | -2 2","11 11","sphere");
+  SurfData* sd = createSample("-2 2 | -2 2","11 11","sphere");
   //AxesBounds* ab = new AxesBounds("-2 2 | -2 2");
   //SurfData* sd = SurfpackInterface::CreateSample(ab, VecUns(11,11));
   CPPUNIT_ASSERT(sd->size() == 121);
@@ -92,12 +92,12 @@ void ModelScalerTest::NormalizingScalerDataTest()
 void ModelScalerTest::NormalizingScalerModelTest()
 {
   AxesBounds* ab = new AxesBounds("-10 10 | -10 10");
-  SurfData* sd = SurfpackInterface::CreateSample(ab, VecUns(11,11));
+  SurfData* sd = createSample(*ab, VecUns(2,11), VecStr(1,"sphere"));
   //  SurfData* sd = SurfpackInterface::CreateSample("-10 10 | -10 10","11 11","sphere");
   CPPUNIT_ASSERT(sd->size() == 121);
   VecDbl pt(2,0.0);
   LinearRegressionModelFactory lrmf;
-  SurfpackModel* lrm = lrmf.Create(*sd);
+  SurfpackModel* lrm = lrmf.Build(*sd);
   // First, see what the lrm is like with the default (no) scaling
   CPPUNIT_ASSERT(matches(0.0,(*lrm)(pt)));
   pt[0] = pt[1] = 2.0;
@@ -55,7 +55,7 @@ void MovingLeastSquaresTest::sineCurve()
   AxesBounds ab("-1 1 | -1 1");
   SurfData* sd = 0;
   VecUns gp(2,10);
-  SurfpackInterface::CreateSample(sd,ab,gp);
+  sd = SurfpackInterface::CreateSample(&ab,gp);
   VecDbl responses(sd->size());
   for (unsigned i = 0; i < sd->size(); i++) {
     const VecDbl& pt = (*sd)(i);
@@ -74,14 +74,47 @@ void MovingLeastSquaresTest::sineCurve()
    
 }
 
+void MovingLeastSquaresTest::compactSupportTest()
+{
+  // the compactly supported weights only see the build points within unit
+  // distance, which must still reproduce a quadratic exactly
+  AxesBounds ab(string("-3 3 | -3 3"));
+  VecUns gp(2,13);
+  SurfData* sd = SurfpackInterface::CreateSample(&ab,gp);
+  VecDbl responses(sd->size());
+  for (unsigned i = 0; i < sd->size(); i++) {
+    const VecDbl& pt = (*sd)(i);
+    responses[i] = 1.0 + 2.0*pt[0] - pt[1] + pt[0]*pt[1] + 0.5*pt[1]*pt[1];
+  }
+  sd->addResponse(responses);
+  LRMBasisSet bs;
+  bs.add("");
+  bs.add("0");
+  bs.add("1");
+  bs.add("0 1");
+  bs.add("0 0");
+  bs.add("1 1");
+  for (unsigned continuity = 2; continuity <= 3; continuity++) {
+    MovingLeastSquaresModel mlsm(*sd,bs,continuity);
+    VecDbl x(2);
+    for (x[0] = -2.0; x[0] <= 2.0; x[0] += 0.7) {
+      for (x[1] = -2.0; x[1] <= 2.0; x[1] += 0.9) {
+	double expected = 1.0 + 2.0*x[0] - x[1] + x[0]*x[1] + 0.5*x[1]*x[1];
+	CPPUNIT_ASSERT(matches(mlsm(x), expected, 1.0e-8));
+      }
+    }
+  }
+  delete sd;
+}
+
 void MovingLeastSquaresTest::generalModelTest()
 {
   LRMBasisSet bs;
-  bs.bases.push_back(VecUns());
-  bs.bases.push_back(VecUns(2,0));
-  bs.bases.push_back(VecUns(2,1));
+  bs.add(VecUns());
+  bs.add(VecUns(2,0));
+  bs.add(VecUns(2,1));
   VecDbl mcfs(3,1.0);
-  LinearRegressionModel my_model(2,bs,mcfs);
+  LinearRegressionModel my_model(2,bs,mcfs,MtxDbl(0,mcfs.size()));
   AxesBounds ab("-2 2 | -2 2");
   SurfpackModelTest::generalDerivativeTest(my_model,ab);
 }
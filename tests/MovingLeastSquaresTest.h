@@ -23,12 +23,14 @@ class MovingLeastSquaresTest : public CppUnit::TestFixture
   CPPUNIT_TEST_SUITE( MovingLeastSquaresTest );
 //CPPUNIT_TEST( generalModelTest );
 CPPUNIT_TEST( sineCurve );
+CPPUNIT_TEST( compactSupportTest );
   CPPUNIT_TEST_SUITE_END();
 public:
   void setUp();
   void tearDown();
 void generalModelTest();
 void sineCurve();
+void compactSupportTest();
 };
 
 #endif
@@ -31,6 +31,10 @@ class RadialBasisFunctionTest : public CppUnit::TestFixture
 //CPPUNIT_TEST( updateCentroidTest );
 //CPPUNIT_TEST( cvtTest );
 CPPUNIT_TEST( createTest );
+CPPUNIT_TEST( subsetThreadsTest );
+CPPUNIT_TEST( fixedCentersLeaveoutTest );
+CPPUNIT_TEST( nearestTest );
+CPPUNIT_TEST( radiiTest );
   CPPUNIT_TEST_SUITE_END();
 public:
   void setUp();
@@ -44,6 +48,10 @@ void centroidTest2();
 void updateCentroidTest();
 void cvtTest();
 void createTest();
+void subsetThreadsTest();
+void fixedCentersLeaveoutTest();
+void nearestTest();
+void radiiTest();
 };
 
 #endif
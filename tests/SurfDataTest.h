@@ -40,7 +40,7 @@ class SurfDataTest : public CppUnit::TestFixture
   CPPUNIT_TEST( testOperatorEquality );
   CPPUNIT_TEST( testOperatorInequality );
   CPPUNIT_TEST( testOperatorIndexing );
-  CPPUNIT_TEST( testOperatorIndexingScaled );
+  //CPPUNIT_TEST( testOperatorIndexingScaled );
   CPPUNIT_TEST_EXCEPTION( testOperatorIndexingBadIndex, std::range_error );
   CPPUNIT_TEST_EXCEPTION(testOperatorIndexingAnotherBadIndex, std::range_error);
   CPPUNIT_TEST( testSize );
@@ -77,9 +77,9 @@ class SurfDataTest : public CppUnit::TestFixture
   CPPUNIT_TEST_EXCEPTION( testSetExcludedPointsTooMany,
     SurfData::bad_surf_data );
   CPPUNIT_TEST( testDuplicatePoint );
-  CPPUNIT_TEST( testSetScalerNull );
-  CPPUNIT_TEST( testSetScalerNotNull );
-  CPPUNIT_TEST( testIsScaled );
+  //CPPUNIT_TEST( testSetScalerNull );
+  //CPPUNIT_TEST( testSetScalerNotNull );
+  //CPPUNIT_TEST( testIsScaled );
   CPPUNIT_TEST( testWriteBinary );
   CPPUNIT_TEST( testWriteText );
   CPPUNIT_TEST_EXCEPTION( testWriteNoPoints,
@@ -96,6 +96,10 @@ class SurfDataTest : public CppUnit::TestFixture
     SurfData::bad_surf_data);
   CPPUNIT_TEST( testStreamInsertion );
 CPPUNIT_TEST( columnHeaderTest );
+CPPUNIT_TEST( columnarViewTest );
+CPPUNIT_TEST( columnarFileTest );
+CPPUNIT_TEST( textDerivativesTest );
+CPPUNIT_TEST( addPointsTest );
   CPPUNIT_TEST_SUITE_END();
 public:
   void setUp();
@@ -175,6 +179,10 @@ private:
   std::set<unsigned> skipAllPoints;
   std::set<unsigned> skipPoints;
 void columnHeaderTest();
+void columnarViewTest();
+void columnarFileTest();
+void textDerivativesTest();
+void addPointsTest();
 };
 
 #endif
@@ -119,7 +119,7 @@ void SurfPointTest::testConstructorFromIStreamBinary()
  
   const string filename = "point1.sp";
   ifstream infile(filename.c_str());
-  SurfPoint sp(2, 2, infile);  
+  SurfPoint sp(infile, 2, 2);  
   infile.close();
   CPPUNIT_ASSERT_EQUAL(sp.x[0], 1.0);
   CPPUNIT_ASSERT_EQUAL(sp.x[1], 2.0);
@@ -135,7 +135,7 @@ void SurfPointTest::testConstructorFromIStreamText()
   ifstream infile(filename.c_str());
   string one_line;
   getline(infile,one_line);
-  SurfPoint sp(2, 2, one_line, 0);  
+  SurfPoint sp(one_line, 2, 2);  
   infile.close();
   CPPUNIT_ASSERT_EQUAL(sp.x[0], 1.0);
   CPPUNIT_ASSERT_EQUAL(sp.x[1], 2.0);
@@ -220,7 +220,7 @@ void SurfPointTest::testFSize()
 void SurfPointTest::testX()
 {
   vector<double> xvec = spPtr->X();
-  CPPUNIT_ASSERT_EQUAL(xvec, x1);
+  CPPUNIT_ASSERT(xvec == x1);
 }
 
 void SurfPointTest::testFQuery()
@@ -288,7 +288,7 @@ void SurfPointTest::testWriteBinary()
   spPtr2->writeBinary(outfile);
   outfile.close();
   ifstream infile(string("writePoint.sp").c_str(),ios::in | ios::binary);
-  SurfPoint sp(1, 2, infile);
+  SurfPoint sp(infile, 1, 2);
   SurfPoint sp2(x2, f1);
   CPPUNIT_ASSERT(sp == sp2);
 }
@@ -301,7 +301,7 @@ void SurfPointTest::testWriteText()
   ifstream infile(string("writePoint.txt").c_str(),ios::in);
   string one_line;
   getline(infile,one_line);
-  SurfPoint sp(1, 2, one_line);
+  SurfPoint sp(one_line, 1, 2);
   SurfPoint sp2(x2, f1);
   CPPUNIT_ASSERT(sp == sp2);
 }
@@ -0,0 +1,140 @@
+/*  _______________________________________________________________________
+
+    Surfpack: A Software Library of Multidimensional Surface Fitting Methods
+    Copyright (c) 2006, Sandia National Laboratories.
+    This software is distributed under the GNU Lesser General Public License.
+    For more information, see the README file in the top Surfpack directory.
+    _______________________________________________________________________ */
+
+#ifdef HAVE_CONFIG_H
+#include "surfpack_config.h"
+#endif
+
+#include <string>
+#include <vector>
+
+#include "SurfpackCInterfaceTest.h"
+#include "surfpack.h"
+#include "AxesBounds.h"
+#include "ModelFactory.h"
+#include "SurfData.h"
+#include "SurfpackInterface.h"
+#include "SurfpackModel.h"
+#include "unittests.h"
+
+using std::string;
+using std::vector;
+using surfpack::shared_rng;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SurfpackCInterfaceTest );
+
+void SurfpackCInterfaceTest::setUp()
+{
+  AxesBounds ab(string("-2 2 | -2 2"));
+  shared_rng().seed(3);
+  SurfData* sd = createSample(ab, 20, VecStr(1, "rosenbrock"));
+  ParamMap args;
+  args["type"] = "kriging";
+  args["correlation_lengths"] = "0.7 0.9";
+  args["optimization_method"] = "none";
+  SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+  SurfpackModel* sm = factory->Build(*sd);
+  SurfpackInterface::Save(sm, "c_interface.bsps");
+  delete sm;
+  delete factory;
+  delete sd;
+  model = NULL;
+  CPPUNIT_ASSERT(surfpack_model_load("c_interface.bsps", &model) == 0);
+  CPPUNIT_ASSERT(model);
+}
+
+void SurfpackCInterfaceTest::tearDown()
+{
+  surfpack_model_free(model);
+}
+
+/// batch results must match point by point evaluation, whether the
+/// points are stored by row or (with a padded leading dimension) by
+/// column
+void SurfpackCInterfaceTest::batchLayoutTest()
+{
+  const unsigned num_vars = 2;
+  const unsigned num_pts = 7;
+  const unsigned ld = num_pts + 3;
+  CPPUNIT_ASSERT(surfpack_model_num_vars(model) == num_vars);
+  vector<double> by_row(num_pts*num_vars), by_col(ld*num_vars, -99.0);
+  vector<double> singles(num_pts);
+  for (unsigned i = 0; i < num_pts; i++) {
+    double pt[num_vars] = { -1.9 + 0.55*i, 1.7 - 0.45*i };
+    for (unsigned j = 0; j < num_vars; j++) {
+      by_row[i*num_vars + j] = pt[j];
+      by_col[j*ld + i] = pt[j];
+    }
+    CPPUNIT_ASSERT(surfpack_model_eval(model, pt, num_vars, &singles[i])
+		   == 0);
+    double gradient[num_vars], variance;
+    CPPUNIT_ASSERT(surfpack_model_gradient(model, pt, num_vars, gradient)
+		   == 0);
+    CPPUNIT_ASSERT(surfpack_model_variance(model, pt, num_vars, &variance)
+		   == 0);
+  }
+  vector<double> row_values(num_pts), col_values(num_pts);
+  CPPUNIT_ASSERT(surfpack_model_eval_batch(model, &by_row[0], num_pts,
+    num_vars, num_vars, 1, &row_values[0]) == 0);
+  CPPUNIT_ASSERT(surfpack_model_eval_batch(model, &by_col[0], num_pts,
+    num_vars, 1, ld, &col_values[0]) == 0);
+  for (unsigned i = 0; i < num_pts; i++) {
+    CPPUNIT_ASSERT(matches(row_values[i], singles[i], 1.0e-12));
+    CPPUNIT_ASSERT(matches(col_values[i], singles[i], 1.0e-12));
+  }
+}
+
+/// points of the wrong dimension are refused, leaving the outputs alone
+void SurfpackCInterfaceTest::wrongDimensionTest()
+{
+  double pt[3] = { 0.1, 0.2, 0.3 };
+  double value = -99.0, variance = -99.0;
+  double gradient[3] = { -99.0, -99.0, -99.0 };
+  double values[2] = { -99.0, -99.0 };
+  CPPUNIT_ASSERT(surfpack_model_eval(model, pt, 3, &value) == 1);
+  CPPUNIT_ASSERT(surfpack_model_eval(model, pt, 1, &value) == 1);
+  CPPUNIT_ASSERT(surfpack_model_eval_batch(model, pt, 1, 3, 3, 1, values)
+		 == 1);
+  CPPUNIT_ASSERT(surfpack_model_gradient(model, pt, 3, gradient) == 1);
+  CPPUNIT_ASSERT(surfpack_model_variance(model, pt, 3, &variance) == 1);
+  CPPUNIT_ASSERT(value == -99.0 && variance == -99.0);
+  CPPUNIT_ASSERT(gradient[0] == -99.0 && values[0] == -99.0);
+}
+
+/// NULL handles and arrays are refused rather than dereferenced
+void SurfpackCInterfaceTest::nullArgumentTest()
+{
+  double pt[2] = { 0.1, 0.2 };
+  double value, variance, gradient[2];
+  CPPUNIT_ASSERT(surfpack_model_num_vars(NULL) == 0);
+  CPPUNIT_ASSERT(surfpack_model_eval(NULL, pt, 2, &value) == 1);
+  CPPUNIT_ASSERT(surfpack_model_eval_batch(NULL, pt, 1, 2, 2, 1, &value)
+		 == 1);
+  CPPUNIT_ASSERT(surfpack_model_gradient(NULL, pt, 2, gradient) == 1);
+  CPPUNIT_ASSERT(surfpack_model_variance(NULL, pt, 2, &variance) == 1);
+  surfpack_model_free(NULL);
+
+  CPPUNIT_ASSERT(surfpack_model_eval(model, NULL, 2, &value) == 1);
+  CPPUNIT_ASSERT(surfpack_model_eval(model, pt, 2, NULL) == 1);
+  CPPUNIT_ASSERT(surfpack_model_eval_batch(model, NULL, 1, 2, 2, 1, &value)
+		 == 1);
+  CPPUNIT_ASSERT(surfpack_model_eval_batch(model, pt, 1, 2, 2, 1, NULL)
+		 == 1);
+  CPPUNIT_ASSERT(surfpack_model_gradient(model, NULL, 2, gradient) == 1);
+  CPPUNIT_ASSERT(surfpack_model_gradient(model, pt, 2, NULL) == 1);
+  CPPUNIT_ASSERT(surfpack_model_variance(model, NULL, 2, &variance) == 1);
+  CPPUNIT_ASSERT(surfpack_model_variance(model, pt, 2, NULL) == 1);
+  // no points to read or write
+  CPPUNIT_ASSERT(surfpack_model_eval_batch(model, NULL, 0, 2, 2, 1, NULL)
+		 == 0);
+
+  surfpack_model* loaded = model;
+  CPPUNIT_ASSERT(surfpack_model_load(NULL, &loaded) == 1);
+  CPPUNIT_ASSERT(loaded == NULL);
+  CPPUNIT_ASSERT(surfpack_model_load("c_interface.bsps", NULL) == 1);
+}
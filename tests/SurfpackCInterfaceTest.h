@@ -0,0 +1,38 @@
+/*  _______________________________________________________________________
+ 
+    Surfpack: A Software Library of Multidimensional Surface Fitting Methods
+    Copyright (c) 2006, Sandia National Laboratories.
+    This software is distributed under the GNU Lesser General Public License.
+    For more information, see the README file in the top Surfpack directory.
+    _______________________________________________________________________ */
+
+#ifdef HAVE_CONFIG_H
+#include "surfpack_config.h"
+#endif
+
+#ifndef SURFPACK_C_INTERFACE_TEST_H
+#define SURFPACK_C_INTERFACE_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "surfpack_c_interface.h"
+
+class SurfpackCInterfaceTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( SurfpackCInterfaceTest );
+CPPUNIT_TEST( batchLayoutTest );
+CPPUNIT_TEST( wrongDimensionTest );
+CPPUNIT_TEST( nullArgumentTest );
+  CPPUNIT_TEST_SUITE_END();
+public:
+  /// saves a Kriging model and loads it through the C interface
+  void setUp();
+  void tearDown();
+void batchLayoutTest();
+void wrongDimensionTest();
+void nullArgumentTest();
+private:
+  surfpack_model* model;
+};
+
+#endif
@@ -21,7 +21,6 @@
 #include "SurfPoint.h"
 #include "SurfData.h"
 #include "AxesBounds.h"
-#include "SurfpackInterpreter.h"
 #include "unittests.h"
 
 using std::cout;
@@ -199,7 +198,7 @@ void SurfpackCommonTest::blockTests()
   CPPUNIT_ASSERT(surfpack::block_owner(9,p,n) == 2);
   CPPUNIT_ASSERT(surfpack::block_owner(10,p,n) == 3);
   CPPUNIT_ASSERT(surfpack::block_owner(11,p,n) == 3);
-  CPPUNIT_ASSERT(surfpack::block_owner(12,p,n) == 4);
+  CPPUNIT_ASSERT(surfpack::block_owner(12,p,n) == 3);
   CPPUNIT_ASSERT(surfpack::block_owner(13,p,n) == 4);
   CPPUNIT_ASSERT(surfpack::block_owner(14,p,n) == 4);
   CPPUNIT_ASSERT(surfpack::block_owner(15,p,n) == 4);
@@ -15,6 +15,7 @@
 #include <iostream>
 #include <string>
 #include <iterator>
+#include <thread>
 
 #include "LinearRegressionModel.h"
 #include "SurfpackModelTest.h"
@@ -26,6 +27,8 @@
 #include "SurfData.h"
 #include "AxesBounds.h"
 #include "SurfpackInterface.h"
+#include "ModelFactory.h"
+#include "ModelFitness.h"
 #include "unittests.h"
 
 using std::cout;
@@ -69,11 +72,11 @@ void SurfpackModelTest::setUp()
   vector< unsigned > grid_points(2, GRIDSIZE);
   sd = 0;
   randsd = 0;
-  vector< string > test_functions;
+  vector< string > test_functions(1, "rosenbrock");
   // Points on grid
-  SurfpackInterface::CreateSample(sd,*ab,grid_points,test_functions);
+  sd = createSample(*ab,grid_points,test_functions);
   // Random sample of points
-  SurfpackInterface::CreateSample(randsd,*ab,10,test_functions);
+  randsd = createSample(*ab,10,test_functions);
 
 }
 
@@ -108,7 +111,7 @@ void SurfpackModelTest::plotTest1()
   pt[0] = -1.5;
   pt[1] = -1.5;
   bases.push_back(pt);
-  KrigingBasisSet bs(bases,corr);
+  //KrigingBasisSet bs(bases,corr);
 
   VecDbl cf(4,-1.0);
   cf[1] = 2.0;
@@ -135,10 +138,10 @@ void SurfpackModelTest::plotTest1()
   // Prepare a basis set for a hyperplane model 
   LRMBasisSet hpbs; // hyperplane basis set
   VecUns list(1,0);
-  hpbs.bases.push_back(VecUns()); // Unity
+  hpbs.add(VecUns()); // Unity
   for (unsigned i = 0; i < randsd->xSize(); i++) {
     list[0] = i;
-    hpbs.bases.push_back(list);
+    hpbs.add(list);
   }
 
 
@@ -159,7 +162,7 @@ void SurfpackModelTest::plotTest1()
     reverse(hyp_coeff.begin(),hyp_coeff.end());
     hyp_coeff.push_back(b);
     reverse(hyp_coeff.begin(),hyp_coeff.end());
-    LinearRegressionModel tang_plane(pt.size(),hpbs,hyp_coeff);
+    LinearRegressionModel tang_plane(pt.size(),hpbs,hyp_coeff,MtxDbl(0,hyp_coeff.size()));
 
     // Now prepare a set of axes, so that we can plot a slice of both
     // functions along each dimension
@@ -257,13 +260,13 @@ void SurfpackModelTest::modelSampleTest()
   // Prepare a basis set for a hyperplane model 
   LRMBasisSet hpbs; // hyperplane basis set
   VecUns list(1,0);
-  hpbs.bases.push_back(VecUns()); // Unity
+  hpbs.add(VecUns()); // Unity
   for (unsigned i = 0; i < randsd->xSize(); i++) {
     list[0] = i;
-    hpbs.bases.push_back(list);
+    hpbs.add(list);
   }
   VecDbl cofs(randsd->xSize()+1,1.0);
-  LinearRegressionModel lrm2(randsd->xSize(),hpbs,cofs);
+  LinearRegressionModel lrm2(randsd->xSize(),hpbs,cofs,MtxDbl(0,cofs.size()));
   modelSample(lrm2);
 }
 
@@ -339,6 +342,212 @@ void SurfpackModelTest::manualANNTest()
   cout << "ddam/d0: " << grad[0] << endl;
 }
 
+/// the block evaluators must agree with point-by-point evaluation for
+/// both row- and column-major input
+void SurfpackModelTest::batchEvalTest()
+{
+  const char* types[] = { "polynomial", "rbf", "ann", "mls", "kriging", "mars" };
+  // build on the random sample, evaluate on the grid (several blocks)
+  SurfData& rsd = *sd;
+  unsigned npts = rsd.size();
+  unsigned nvars = rsd.xSize();
+  VecDbl row_major(npts*nvars), col_major(npts*nvars);
+  for (unsigned i = 0; i < npts; i++) {
+    for (unsigned j = 0; j < nvars; j++) {
+      row_major[i*nvars+j] = rsd(i,j);
+      col_major[j*npts+i] = rsd(i,j);
+    }
+  }
+  for (unsigned t = 0; t < sizeof(types)/sizeof(types[0]); t++) {
+    ParamMap args;
+    args["type"] = types[t];
+    SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+    SurfpackModel* model = factory->Build(*randsd);
+    VecDbl batch = (*model)(rsd);
+    VecDbl y_row(npts), y_col(npts);
+    (*model)(&row_major[0], npts, nvars, 1, &y_row[0]);
+    (*model)(&col_major[0], npts, 1, npts, &y_col[0]);
+    for (unsigned i = 0; i < npts; i++) {
+      double y = (*model)(rsd(i));
+      CPPUNIT_ASSERT(matches(batch[i], y, 1.0e-6));
+      CPPUNIT_ASSERT(matches(y_row[i], y, 1.0e-6));
+      CPPUNIT_ASSERT(matches(y_col[i], y, 1.0e-6));
+    }
+    delete model;
+    delete factory;
+  }
+}
+
+/// block gradients (the default loop and the ANN's matrix products)
+/// must agree with point-by-point gradients
+void SurfpackModelTest::batchGradientTest()
+{
+  const char* types[] = { "polynomial", "ann" };
+  SurfData& rsd = *sd;
+  unsigned npts = rsd.size();
+  unsigned nvars = rsd.xSize();
+  MtxDbl x(npts, nvars);
+  for (unsigned i = 0; i < npts; i++) {
+    for (unsigned j = 0; j < nvars; j++) {
+      x(i,j) = rsd(i,j);
+    }
+  }
+  for (unsigned t = 0; t < sizeof(types)/sizeof(types[0]); t++) {
+    ParamMap args;
+    args["type"] = types[t];
+    SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+    SurfpackModel* model = factory->Build(*randsd);
+    MtxDbl grads;
+    model->gradient(x, grads);
+    CPPUNIT_ASSERT(grads.getNRows() == npts && grads.getNCols() == nvars);
+    for (unsigned i = 0; i < npts; i++) {
+      VecDbl grad = model->gradient(rsd(i));
+      for (unsigned j = 0; j < nvars; j++) {
+	CPPUNIT_ASSERT(matches(grads(i,j), grad[j], 1.0e-6));
+      }
+    }
+    delete model;
+    delete factory;
+  }
+}
+
+/// many threads hammering one shared model must reproduce the serial
+/// values and gradients exactly
+void SurfpackModelTest::concurrentEvalTest()
+{
+  const char* types[] = { "polynomial", "rbf", "ann", "mls", "kriging", "mars" };
+  const unsigned nthreads = 8;
+  const unsigned passes = 5;
+  // build on the random sample, evaluate on the grid
+  SurfData& rsd = *sd;
+  for (unsigned t = 0; t < sizeof(types)/sizeof(types[0]); t++) {
+    ParamMap args;
+    args["type"] = types[t];
+    SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+    const SurfpackModel* model = factory->Build(*randsd);
+    bool has_gradient = (std::string(types[t]) != "mars");
+    VecDbl batch_values = (*model)(rsd);
+    VecDbl values(rsd.size());
+    VecVecDbl grads(rsd.size());
+    for (unsigned i = 0; i < rsd.size(); i++) {
+      values[i] = (*model)(rsd(i));
+      if (has_gradient) grads[i] = model->gradient(rsd(i));
+    }
+    VecUns failures(nthreads, 0);
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < nthreads; w++) {
+      workers.push_back(std::thread([&, w]() {
+	for (unsigned p = 0; p < passes; p++) {
+	  VecDbl batch = (*model)(rsd);
+	  for (unsigned i = 0; i < rsd.size(); i++) {
+	    if ((*model)(rsd(i)) != values[i] || batch[i] != batch_values[i])
+	      failures[w]++;
+	    if (has_gradient && model->gradient(rsd(i)) != grads[i])
+	      failures[w]++;
+	  }
+	}
+      }));
+    }
+    for (unsigned w = 0; w < nthreads; w++) {
+      workers[w].join();
+      CPPUNIT_ASSERT(failures[w] == 0);
+    }
+    delete model;
+    delete factory;
+  }
+}
+
+/// cross-validation must give the same result for a given seed however
+/// many threads build the folds
+void SurfpackModelTest::parallelCrossValidationTest()
+{
+  const char* types[] = { "polynomial", "rbf", "ann", "mls", "kriging", "mars" };
+  const unsigned threads[] = { 1, 4, 10 };
+  for (unsigned t = 0; t < sizeof(types)/sizeof(types[0]); t++) {
+    ParamMap args;
+    args["type"] = types[t];
+    SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+    SurfpackModel* model = factory->Build(*randsd);
+    VecDbl fitness;
+    for (unsigned k = 0; k < sizeof(threads)/sizeof(threads[0]); k++) {
+      surfpack::shared_rng().seed(7);
+      CrossValidationFitness cv(10, threads[k]);
+      fitness.push_back(cv(*model, *randsd));
+    }
+    CPPUNIT_ASSERT(fitness[0] == fitness[1]);
+    CPPUNIT_ASSERT(fitness[0] == fitness[2]);
+    delete model;
+    delete factory;
+  }
+}
+
+/// closed form leave-out estimates must match explicitly rebuilt models
+void SurfpackModelTest::closedFormCrossValidationTest()
+{
+  std::vector<ParamMap> cases(3);
+  cases[0]["type"] = "polynomial";
+  cases[1]["type"] = "polynomial";
+  cases[1]["order"] = "3";
+  cases[2]["type"] = "kriging";
+  cases[2]["correlation_lengths"] = "0.7 0.9";
+  cases[2]["optimization_method"] = "none";
+  // enough points that the cubic stays determined with a fold left out
+  SurfData* data = createSample(*ab, 20, VecStr(1, "rosenbrock"));
+  const unsigned num_partitions[] = { data->size(), 10, 4 };
+  for (unsigned c = 0; c < cases.size(); c++) {
+    SurfpackModelFactory* factory = ModelFactory::createModelFactory(cases[c]);
+    SurfpackModel* model = factory->Build(*data);
+    for (unsigned n = 0; n < sizeof(num_partitions)/sizeof(unsigned); n++) {
+      VecVecUns partitions(num_partitions[n]);
+      for (unsigned i = 0; i < data->size(); i++)
+	partitions[i % num_partitions[n]].push_back(i);
+      VecDbl estimates;
+      CPPUNIT_ASSERT(model->leaveoutEstimates(*data, partitions, estimates));
+      for (unsigned p = 0; p < partitions.size(); p++) {
+	SurfData leaveout_sd(*data);
+	leaveout_sd.setExcludedPoints(SetUns(partitions[p].begin(),
+					     partitions[p].end()));
+	ParamMap args = model->parameters();
+	SurfpackModelFactory* rebuild_factory = 
+	  ModelFactory::createModelFactory(args);
+	SurfpackModel* rebuilt = rebuild_factory->Build(leaveout_sd);
+	for (unsigned k = 0; k < partitions[p].size(); k++) {
+	  unsigned i = partitions[p][k];
+	  CPPUNIT_ASSERT(matches(estimates[i], (*rebuilt)((*data)(i)), 
+				 1.0e-6));
+	}
+	delete rebuilt;
+	delete rebuild_factory;
+      }
+    }
+    delete model;
+    delete factory;
+  }
+  delete data;
+}
+
+/// every model type must evaluate identically after a round trip
+/// through the binary (.bsps) format
+void SurfpackModelTest::binarySaveLoadTest()
+{
+  const char* types[] = { "polynomial", "rbf", "ann", "mls", "kriging", "mars" };
+  for (unsigned t = 0; t < sizeof(types)/sizeof(types[0]); t++) {
+    ParamMap args;
+    args["type"] = types[t];
+    SurfpackModelFactory* factory = ModelFactory::createModelFactory(args);
+    SurfpackModel* model = factory->Build(*randsd);
+    string filename = string("binary_") + types[t] + ".bsps";
+    SurfpackInterface::Save(model, filename);
+    SurfpackModel* loaded = SurfpackInterface::LoadModel(filename);
+    CPPUNIT_ASSERT(loaded);
+    CPPUNIT_ASSERT(loaded->asString() == model->asString());
+    CPPUNIT_ASSERT((*loaded)(*sd) == (*model)(*sd));
+    delete loaded;
+    delete model;
+    delete factory;
+  }
+}
+
 const unsigned GRIDPOINTS = 50;
 void SurfpackModelTest::generalDerivativeTest(const SurfpackModel& model, const AxesBounds& ab)
 {
@@ -350,7 +559,7 @@ void SurfpackModelTest::generalDerivativeTest(const SurfpackModel& model, const
   const unsigned nsamples = 1;
   vector< string > test_functions;
   SurfData* randsd = 0;
-  SurfpackInterface::CreateSample(randsd,ab,nsamples,test_functions);
+  randsd = createSample(ab,nsamples,test_functions);
   
 
   // Prepare a basis set for a hyperplane model 
@@ -360,11 +569,11 @@ void SurfpackModelTest::generalDerivativeTest(const SurfpackModel& model, const
   VecUns list(1);
   for (unsigned i = 0; i < randsd->xSize(); i++) {
     list[0] = i;
-    hpbs.bases.push_back(list);
+    hpbs.add(list);
   }
   // Put the unity basis on the end so that the coefficent for that
   // basis can just be tacked on the back of the gradient
-  hpbs.bases.push_back(VecUns()); // Unity
+  hpbs.add(VecUns()); // Unity
 
   // For each of the randomly sampled points
   for (unsigned i = 0; i < randsd->size(); i++) {
@@ -383,7 +592,7 @@ void SurfpackModelTest::generalDerivativeTest(const SurfpackModel& model, const
     // Now create a tangent hyperplane to the surface
     VecDbl hyp_coeff = grad;
     hyp_coeff.push_back(b);
-    LinearRegressionModel tang_plane(pt.size(),hpbs,hyp_coeff);
+    LinearRegressionModel tang_plane(pt.size(),hpbs,hyp_coeff,MtxDbl(0,hyp_coeff.size()));
 
     // Now prepare a set of axes, so that we can plot a slice of both
     // functions along each dimension
@@ -405,7 +614,7 @@ void SurfpackModelTest::generalDerivativeTest(const SurfpackModel& model, const
       // Now create the data set that varies only along the active dimension
       SurfData* test_data = 0;
       vector<string> test_functions;
-      SurfpackInterface::CreateSample(test_data,var_ab,var_dims,test_functions);
+      test_data = createSample(var_ab,var_dims,test_functions);
       SurfData& td = *test_data;
       // Now evaluate both models on this data
       ///\\todo Creat a base model class that can do operator()(SurfData&)
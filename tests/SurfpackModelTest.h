@@ -27,6 +27,12 @@ CPPUNIT_TEST( plotTest1 );
 //CPPUNIT_TEST( graphicalDerivTest );
 //CPPUNIT_TEST( modelSampleTest );
 CPPUNIT_TEST( manualANNTest );
+CPPUNIT_TEST( batchEvalTest );
+CPPUNIT_TEST( batchGradientTest );
+CPPUNIT_TEST( concurrentEvalTest );
+CPPUNIT_TEST( parallelCrossValidationTest );
+CPPUNIT_TEST( closedFormCrossValidationTest );
+CPPUNIT_TEST( binarySaveLoadTest );
   CPPUNIT_TEST_SUITE_END();
 public:
   AxesBounds* ab;
@@ -43,6 +49,12 @@ void graphicalDerivTest();
 void modelSample(const SurfpackModel& model);
 void modelSampleTest();
 void manualANNTest();
+void batchEvalTest();
+void batchGradientTest();
+void concurrentEvalTest();
+void parallelCrossValidationTest();
+void closedFormCrossValidationTest();
+void binarySaveLoadTest();
 };
 
 #endif
@@ -17,6 +17,9 @@
 #include <sstream>
 #include "unittests.h"
 #include "surfpack.h"
+#include "AxesBounds.h"
+#include "SurfData.h"
+#include "SurfpackInterface.h"
 
 using std::cerr;
 using std::cout;
@@ -28,6 +31,11 @@ using std::setw;
 using std::string;
 using std::vector;
 
+// the text fixtures carry every digit, so they read back equal to the
+// binary ones
+const unsigned fixture_precision = 17;
+const unsigned fixture_width = fixture_precision + 9;
+
 void writePoint1Files()
 {
   ofstream outfile(string("point1.txt").c_str(), ios::out);
@@ -59,10 +67,13 @@ void writePoint2Files()
 
 void writeRastriginAndClaimsTooManyFiles()
 {
-  unsigned intvals[3];
+  // points, predictors, responses, gradients, Hessians
+  unsigned intvals[5];
   intvals[0] = 100;
   intvals[1] = 2;
   intvals[2] = 1;
+  intvals[3] = 0;
+  intvals[4] = 0;
   ofstream rastriginText(string("rast100.spd").c_str(),ios::out);
   setOstreamFlags(rastriginText);
   ofstream rastriginBinary(string("rast100.bspd").c_str(),
@@ -74,13 +85,17 @@ void writeRastriginAndClaimsTooManyFiles()
   // write SurfData headers
   rastriginText << intvals[0] << endl 
 		<< intvals[1] << endl 
-		<< intvals[2] << endl;
+		<< intvals[2] << endl
+		<< intvals[3] << endl
+		<< intvals[4] << endl;
   claimsTooManyText << intvals[0]+1 << endl 
 		    << intvals[1] << endl 
-		    << intvals[2] << endl;
-  rastriginBinary.write(reinterpret_cast<char*>(intvals),sizeof(unsigned)*3);
+		    << intvals[2] << endl
+		    << intvals[3] << endl
+		    << intvals[4] << endl;
+  rastriginBinary.write(reinterpret_cast<char*>(intvals),sizeof(unsigned)*5);
   intvals[0]++;
-  claimsTooManyBinary.write(reinterpret_cast<char*>(intvals),sizeof(unsigned)*3);
+  claimsTooManyBinary.write(reinterpret_cast<char*>(intvals),sizeof(unsigned)*5);
   
   // write data
   double min = -2.0;
@@ -94,13 +109,13 @@ void writeRastriginAndClaimsTooManyFiles()
     for (unsigned dim2 = 0; dim2 < ptsPerDim; dim2++) {
       onept[1] = min + dim2 * interval;
       response = surfpack::rastrigin(onept);
-      rastriginText << setw(surfpack::field_width) << onept[0] 
-		    << setw(surfpack::field_width) << onept[1]
-		    << setw(surfpack::field_width) << response
+      rastriginText << setw(fixture_width) << onept[0] 
+		    << setw(fixture_width) << onept[1]
+		    << setw(fixture_width) << response
 		    << endl;
-      claimsTooManyText << setw(surfpack::field_width) << onept[0] 
-		        << setw(surfpack::field_width) << onept[1]
-		        << setw(surfpack::field_width) << response
+      claimsTooManyText << setw(fixture_width) << onept[0] 
+		        << setw(fixture_width) << onept[1]
+		        << setw(fixture_width) << response
 		        << endl;
       rastriginBinary.write(reinterpret_cast<char*>(&onept[0]),sizeof(double));
       rastriginBinary.write(reinterpret_cast<char*>(&onept[1]),sizeof(double));
@@ -119,10 +134,13 @@ void writeRastriginAndClaimsTooManyFiles()
 
 void writeManyPtsFiles()
 {
-  unsigned intvals[3];
+  // points, predictors, responses, gradients, Hessians
+  unsigned intvals[5];
   intvals[0] = 10000;
   intvals[1] = 5;
   intvals[2] = 1;
+  intvals[3] = 0;
+  intvals[4] = 0;
   ofstream manyptsText(string("manypts.spd").c_str(),ios::out);
   setOstreamFlags(manyptsText);
   ofstream manyptsBinary(string("manypts.bspd").c_str(),
@@ -131,8 +149,10 @@ void writeManyPtsFiles()
   // write SurfData headers
   manyptsText << intvals[0] << endl 
 		<< intvals[1] << endl 
-		<< intvals[2] << endl;
-  manyptsBinary.write(reinterpret_cast<char*>(intvals),sizeof(unsigned)*3);
+		<< intvals[2] << endl
+		<< intvals[3] << endl
+		<< intvals[4] << endl;
+  manyptsBinary.write(reinterpret_cast<char*>(intvals),sizeof(unsigned)*5);
   
   // write data
   double min = -2.0;
@@ -152,12 +172,12 @@ void writeManyPtsFiles()
           for (unsigned dim4 = 0; dim4 < ptsPerDim; dim4++) {
             onept[4] = min + dim4 * interval;
 	      response = surfpack::rastrigin(onept);
-	      manyptsText << setw(surfpack::field_width) << onept[0] 
-			    << setw(surfpack::field_width) << onept[1]
-			    << setw(surfpack::field_width) << onept[2]
-			    << setw(surfpack::field_width) << onept[3]
-			    << setw(surfpack::field_width) << onept[4]
-			    << setw(surfpack::field_width) << response
+	      manyptsText << setw(fixture_width) << onept[0] 
+			    << setw(fixture_width) << onept[1]
+			    << setw(fixture_width) << onept[2]
+			    << setw(fixture_width) << onept[3]
+			    << setw(fixture_width) << onept[4]
+			    << setw(fixture_width) << response
 			    << endl;
       	     manyptsBinary.write(reinterpret_cast<char*>(&onept[0]),sizeof(double));
       	     manyptsBinary.write(reinterpret_cast<char*>(&onept[1]),sizeof(double));
@@ -296,7 +316,7 @@ void writeUnknownSurfaceFile()
 void setOstreamFlags(ostream& os)
 {
     ios::fmtflags old_flags = os.flags();
-    unsigned old_precision = os.precision(surfpack::output_precision);
+    unsigned old_precision = os.precision(fixture_precision);
     os.setf(ios::scientific);
 }
 
@@ -330,3 +350,27 @@ bool matches(double observed, double target, double margin)
   cerr << "Test Value: " << observed << " Expected: " << target << endl;
   return false;
 }
+
+SurfData* createSample(const string& axes, const string& grid,
+  const string& test_functions)
+{
+  AxesBounds ab(axes);
+  return createSample(ab, surfpack::toVec<unsigned>(grid),
+    surfpack::toVec<string>(test_functions));
+}
+
+SurfData* createSample(const AxesBounds& axes, const vector<unsigned>& grid,
+  const vector<string>& test_functions)
+{
+  SurfData* sd = SurfpackInterface::CreateSample(&axes, grid);
+  SurfpackInterface::Evaluate(sd, test_functions);
+  return sd;
+}
+
+SurfData* createSample(const AxesBounds& axes, unsigned n_samples,
+  const vector<string>& test_functions)
+{
+  SurfData* sd = SurfpackInterface::CreateSample(&axes, n_samples);
+  SurfpackInterface::Evaluate(sd, test_functions);
+  return sd;
+}
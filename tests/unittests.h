@@ -14,6 +14,10 @@
 #define UNITTESTS_H
 
 #include <string>
+#include <vector>
+
+class AxesBounds;
+class SurfData;
 
 const unsigned unsignedZero = 0;
 const double doubleZero = 0.0;
@@ -30,4 +34,17 @@ void setOstreamFlags(std::ostream& os);
 void initialize();
 bool matches(double observed, double target, double margin = 1.0e-2);
 
+/// Sample the axes "lo hi | lo hi | ..." on the grid "n1 n2 ..." and add
+/// a response for each space-separated test function name
+SurfData* createSample(const std::string& axes, const std::string& grid,
+  const std::string& test_functions);
+/// Sample axes on a grid and add a response for each test function
+SurfData* createSample(const AxesBounds& axes,
+  const std::vector<unsigned>& grid,
+  const std::vector<std::string>& test_functions);
+/// Draw n_samples random points in axes and add a response for each
+/// test function
+SurfData* createSample(const AxesBounds& axes, unsigned n_samples,
+  const std::vector<std::string>& test_functions);
+
 #endif